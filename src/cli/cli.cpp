@@ -1,5 +1,7 @@
 #include "cli.h"
 #include "common/rendering.h"
+#include "common/job_store.h"
+#include "common/watch_folder.h"
 
 bool cli::run(
 	std::vector<std::filesystem::path> inputs,
@@ -7,7 +9,11 @@ bool cli::run(
 	std::vector<std::filesystem::path> config_paths,
 	bool preview,
 	bool verbose,
-	bool disable_update_check
+	bool disable_update_check,
+	bool background,
+	bool estimate,
+	std::optional<std::chrono::seconds> live,
+	std::optional<stream_output::Settings> stream
 ) {
 	auto init_res = blur.initialise(verbose, preview);
 	if (!init_res) { // todo: preview in cli
@@ -61,7 +67,10 @@ bool cli::run(
 		input_path = std::filesystem::canonical(input_path);
 
 		auto video_info = u::get_video_info(input_path);
-		if (!video_info.has_video_stream) {
+
+		// a recording in progress usually doesn't have a duration yet, it just needs a readable video stream
+		bool readable = live ? video_info.fps_num > 0 && video_info.width > 0 : video_info.has_video_stream;
+		if (!readable) {
 			u::log("Video '{}' is not a valid video or is unreadable", input_path);
 			continue;
 		}
@@ -81,7 +90,40 @@ bool cli::run(
 		}
 
 		// set up render
-		auto render = rendering.queue_render(Render(input_path, video_info, output_path, config_path));
+		Render new_render(input_path, video_info, output_path, config_path);
+
+		if (estimate) {
+			auto render_estimate = new_render.get_estimate();
+			if (!render_estimate) {
+				u::log("'{}': no comparable renders in the history to estimate from yet", new_render.get_video_name());
+				continue;
+			}
+
+			u::log(
+				"'{}' ({}x{}, {:.1f}s): ~{}, peak memory ~{} MB (based on {} past render{}{})",
+				new_render.get_video_name(),
+				video_info.width,
+				video_info.height,
+				video_info.duration,
+				render_history::format_duration(render_estimate->wall_time),
+				render_estimate->peak_memory / (1024 * 1024),
+				render_estimate->samples,
+				render_estimate->samples != 1 ? "s" : "",
+				render_estimate->exact_settings ? " with the same settings" : ""
+			);
+			continue;
+		}
+
+		if (background)
+			new_render.set_background(true);
+
+		if (live)
+			new_render.set_live(*live);
+
+		if (stream)
+			new_render.set_stream(*stream);
+
+		auto render = rendering.queue_render(std::move(new_render));
 
 		if (blur.verbose) {
 			u::log(
@@ -90,6 +132,9 @@ bool cli::run(
 		}
 	}
 
+	if (estimate)
+		return true;
+
 	// render videos
 	while (!blur.exiting && rendering.render_next_video())
 		;
@@ -98,3 +143,128 @@ bool cli::run(
 
 	return true;
 }
+
+bool cli::fan_out(
+	const std::filesystem::path& input,
+	const std::vector<std::filesystem::path>& outputs,
+	const std::vector<std::filesystem::path>& config_paths,
+	bool verbose,
+	bool background
+) {
+	auto init_res = blur.initialise(verbose, false);
+	if (!init_res) {
+		u::log("Blur failed to initialise");
+		u::log("Reason: {}", init_res.error());
+		return false;
+	}
+
+	if (config_paths.empty()) {
+		u::log("Rendering multiple outputs needs a config path for each of them.");
+		return false;
+	}
+
+	if (!outputs.empty() && outputs.size() != config_paths.size()) {
+		u::log("Config/output count mismatch ({} configs, {} outputs).", config_paths.size(), outputs.size());
+		return false;
+	}
+
+	auto output_path = [&](size_t i) -> std::optional<std::filesystem::path> {
+		if (outputs.empty())
+			return {};
+
+		return outputs[i];
+	};
+
+	Job job{
+		.input = input,
+		.output = output_path(0),
+		.config = config_paths[0],
+	};
+
+	for (size_t i = 1; i < config_paths.size(); i++)
+		job.branches.push_back({ .config = config_paths[i], .output = output_path(i) });
+
+	auto error = rendering.render_job(job, [&](Render& render) {
+		if (background)
+			render.set_background(true);
+
+		if (blur.verbose) {
+			for (const auto& path : render.get_output_paths())
+				u::log("Queued '{}' for render, outputting to '{}'", render.get_video_name(), path);
+		}
+	});
+
+	u::log("Finished rendering");
+
+	return !error;
+}
+
+bool cli::watch(
+	const std::filesystem::path& folder, std::optional<std::filesystem::path> config_path, bool verbose, bool background
+) {
+	auto init_res = blur.initialise(verbose, false);
+	if (!init_res) {
+		u::log("Blur failed to initialise");
+		u::log("Reason: {}", init_res.error());
+		return false;
+	}
+
+	if (config_path) {
+		if (!std::filesystem::exists(*config_path)) {
+			u::log("Specified config file path '{}' not found.", *config_path);
+			return false;
+		}
+
+		config_path = std::filesystem::canonical(*config_path);
+	}
+
+	JobStore store;
+	auto store_res = store.open(blur.settings_path / WatchFolder::QUEUE_FILENAME);
+	if (!store_res) {
+		u::log(store_res.error());
+		return false;
+	}
+
+	WatchFolder watcher;
+	auto watch_res = watcher.start(folder, true, [&](const std::filesystem::path& path) {
+		auto job = store.add({ .input = path, .config = config_path });
+		u::log("Queued '{}' (job {})", path, job.id);
+	});
+	if (!watch_res) {
+		u::log(watch_res.error());
+		return false;
+	}
+
+	u::log("Watching {} for new videos ({} queued jobs)", watcher.get_folder(), store.get_pending_count());
+
+	while (!blur.exiting) {
+		auto job = store.take_next();
+		if (!job) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+			continue;
+		}
+
+		// a bad file or output path fails that job, watching carries on
+		std::optional<std::string> error;
+		try {
+			error = rendering.render_job(*job, [&](Render& render) {
+				if (background)
+					render.set_background(true);
+			});
+		}
+		catch (const std::exception& e) {
+			error = e.what();
+		}
+
+		if (error) {
+			u::log("'{}' failed: {}", job->input, *error);
+			store.set_state(job->id, JobState::FAILED, *error);
+		}
+		else
+			store.set_state(job->id, JobState::DONE);
+	}
+
+	watcher.stop();
+
+	return true;
+}
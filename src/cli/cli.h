@@ -1,5 +1,7 @@
 #pragma once
 
+#include "common/stream_output.h"
+
 namespace cli {
 	bool run(
 		std::vector<std::filesystem::path> inputs,
@@ -7,6 +9,29 @@ namespace cli {
 		std::vector<std::filesystem::path> config_paths,
 		bool preview,
 		bool verbose,
-		bool disable_update_check = false
+		bool disable_update_check = false,
+		bool background = false,
+		bool estimate = false,
+		std::optional<std::chrono::seconds> live = {}, // follow inputs that are still being recorded
+		std::optional<stream_output::Settings> stream = {}
+	);
+
+	// render one input with several configs at once, sharing the decode, deduplication and interpolation between
+	// them. outputs are optional, one per config when given
+	bool fan_out(
+		const std::filesystem::path& input,
+		const std::vector<std::filesystem::path>& outputs,
+		const std::vector<std::filesystem::path>& config_paths,
+		bool verbose,
+		bool background = false
+	);
+
+	// keep rendering new videos as they show up in a folder until interrupted. the queue is journaled so jobs
+	// found before a restart are still rendered after it
+	bool watch(
+		const std::filesystem::path& folder,
+		std::optional<std::filesystem::path> config_path,
+		bool verbose,
+		bool background = false
 	);
 }
@@ -0,0 +1,573 @@
+#include "job_server.h"
+#include "common/rendering.h"
+#include "common/event_sink.h"
+#include "common/job_store.h"
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+namespace {
+	using local_protocol = boost::asio::local::stream_protocol;
+
+	bool is_terminal_event(const std::string& event) {
+		return event == "finished" || event == "failed" || event == "stopped";
+	}
+
+	class Server;
+
+	class Session : public std::enable_shared_from_this<Session> {
+	public:
+		Session(local_protocol::socket socket, Server& server) : m_socket(std::move(socket)), m_server(server) {}
+
+		void start() {
+			read();
+		}
+
+		void send(std::string line);
+
+		void watch(uint64_t job_id) {
+			m_watched_jobs.insert(job_id);
+		}
+
+		bool unwatch(uint64_t job_id) {
+			return m_watched_jobs.erase(job_id) > 0;
+		}
+
+		[[nodiscard]] bool is_watching(uint64_t job_id) const {
+			return m_watched_jobs.contains(job_id);
+		}
+
+	private:
+		local_protocol::socket m_socket;
+		Server& m_server;
+
+		boost::asio::streambuf m_read_buffer;
+		std::deque<std::string> m_write_queue;
+		std::set<uint64_t> m_watched_jobs;
+
+		void read();
+		void write();
+	};
+
+	// everything in here runs on the io thread, apart from the bits guarded by m_mutex
+	class Server {
+	public:
+		Server(boost::asio::io_context& io_context, const std::filesystem::path& socket_path, JobStore& store)
+			: m_acceptor(io_context, local_protocol::endpoint(socket_path.string())), m_store(store) {}
+
+		void accept() {
+			m_acceptor.async_accept([this](boost::system::error_code ec, local_protocol::socket socket) {
+				if (ec)
+					return; // acceptor closed
+
+				auto session = std::make_shared<Session>(std::move(socket), *this);
+				m_sessions.insert(session);
+				session->start();
+
+				accept();
+			});
+		}
+
+		void close() {
+			boost::system::error_code ec;
+			m_acceptor.close(ec);
+			m_sessions.clear();
+		}
+
+		void remove_session(const std::shared_ptr<Session>& session) {
+			m_sessions.erase(session);
+		}
+
+		void handle(const std::shared_ptr<Session>& session, const std::string& line) {
+			auto request = nlohmann::json::parse(line, nullptr, false);
+			if (request.is_discarded() || !request.is_object()) {
+				send_error(session, "invalid json");
+				return;
+			}
+
+			auto type = request.value("type", "");
+
+			if (type == "submit") {
+				handle_submit(session, request);
+			}
+			else if (type == "status") {
+				nlohmann::json jobs = nlohmann::json::array();
+				for (const auto& job : m_store.get_jobs()) {
+					jobs.push_back({
+						{ "job_id", job.id },
+						{ "input", std::format("{}", job.input) },
+						{ "priority", job.priority },
+						{ "state", JobStore::state_to_string(job.state) },
+					});
+				}
+
+				session->send(nlohmann::json{ { "type", "status" }, { "jobs", jobs } }.dump());
+			}
+			else if (type == "shutdown") {
+				u::log("Daemon shutdown requested, finishing current render");
+				request_shutdown();
+			}
+			else {
+				send_error(session, std::format("unknown request type '{}'", type));
+			}
+		}
+
+		// called on the io thread with a line from the event sink
+		void forward_event(uint64_t job_id, const std::string& event, const std::string& line) {
+			bool terminal = is_terminal_event(event);
+
+			for (const auto& session : m_sessions) {
+				if (!session->is_watching(job_id))
+					continue;
+
+				session->send(line);
+
+				if (terminal)
+					session->unwatch(job_id);
+			}
+		}
+
+		void map_render(uint32_t render_id, uint64_t job_id) {
+			std::lock_guard lock(m_mutex);
+			m_render_jobs[render_id] = job_id;
+		}
+
+		std::optional<uint64_t> get_render_job(uint32_t render_id) {
+			std::lock_guard lock(m_mutex);
+
+			auto it = m_render_jobs.find(render_id);
+			if (it == m_render_jobs.end())
+				return {};
+
+			return it->second;
+		}
+
+		void unmap_render(uint32_t render_id) {
+			std::lock_guard lock(m_mutex);
+			m_render_jobs.erase(render_id);
+		}
+
+		// blocks the render loop until a job is submitted, shutdown is requested, or the timeout passes
+		void wait_for_job(std::chrono::milliseconds timeout) {
+			std::unique_lock lock(m_mutex);
+			m_job_condition.wait_for(lock, timeout, [this] {
+				return m_job_submitted || m_shutdown_requested;
+			});
+			m_job_submitted = false;
+		}
+
+		void request_shutdown() {
+			{
+				std::lock_guard lock(m_mutex);
+				m_shutdown_requested = true;
+			}
+			m_job_condition.notify_all();
+		}
+
+		bool is_shutdown_requested() {
+			std::lock_guard lock(m_mutex);
+			return m_shutdown_requested;
+		}
+
+	private:
+		local_protocol::acceptor m_acceptor;
+		JobStore& m_store;
+
+		std::set<std::shared_ptr<Session>> m_sessions;
+
+		std::mutex m_mutex;
+		std::condition_variable m_job_condition;
+		bool m_job_submitted = false;
+		bool m_shutdown_requested = false;
+		std::unordered_map<uint32_t, uint64_t> m_render_jobs;
+
+		static void send_error(const std::shared_ptr<Session>& session, const std::string& message) {
+			session->send(nlohmann::json{ { "type", "error" }, { "message", message } }.dump());
+		}
+
+		void handle_submit(const std::shared_ptr<Session>& session, const nlohmann::json& request) {
+			if (is_shutdown_requested()) {
+				send_error(session, "daemon is shutting down");
+				return;
+			}
+
+			if (!request.contains("input") || !request["input"].is_string()) {
+				send_error(session, "submit needs an input path");
+				return;
+			}
+
+			Job job{
+				.input = u::string_to_path(request["input"].get<std::string>()),
+				.priority = request.value("priority", 0),
+			};
+
+			if (request.contains("output") && request["output"].is_string())
+				job.output = u::string_to_path(request["output"].get<std::string>());
+
+			if (request.contains("config") && request["config"].is_string())
+				job.config = u::string_to_path(request["config"].get<std::string>());
+
+			if (request.contains("branches") && request["branches"].is_array()) {
+				for (const auto& branch_json : request["branches"]) {
+					if (!branch_json.contains("config") || !branch_json["config"].is_string()) {
+						send_error(session, "branches need a config path");
+						return;
+					}
+
+					JobBranch branch{ .config = u::string_to_path(branch_json["config"].get<std::string>()) };
+					if (branch_json.contains("output") && branch_json["output"].is_string())
+						branch.output = u::string_to_path(branch_json["output"].get<std::string>());
+
+					job.branches.push_back(std::move(branch));
+				}
+			}
+
+			bool relative_branch = std::ranges::any_of(job.branches, [](const JobBranch& branch) {
+				return branch.config.is_relative() || (branch.output && branch.output->is_relative());
+			});
+
+			// the daemon's working directory is nothing to do with the client's
+			if (job.input.is_relative() || (job.output && job.output->is_relative()) ||
+			    (job.config && job.config->is_relative()) || relative_branch)
+			{
+				send_error(session, "paths must be absolute");
+				return;
+			}
+
+			job = m_store.add(std::move(job));
+
+			if (request.value("wait", false))
+				session->watch(job.id);
+
+			session->send(nlohmann::json{ { "type", "accepted" }, { "job_id", job.id } }.dump());
+
+			{
+				std::lock_guard lock(m_mutex);
+				m_job_submitted = true;
+			}
+			m_job_condition.notify_all();
+		}
+	};
+
+	void Session::send(std::string line) {
+		line += '\n';
+
+		bool idle = m_write_queue.empty();
+		m_write_queue.push_back(std::move(line));
+
+		if (idle)
+			write();
+	}
+
+	void Session::read() {
+		boost::asio::async_read_until(
+			m_socket,
+			m_read_buffer,
+			'\n',
+			[self = shared_from_this()](boost::system::error_code ec, size_t /*bytes*/) {
+				if (ec) {
+					self->m_server.remove_session(self);
+					return;
+				}
+
+				std::istream stream(&self->m_read_buffer);
+				std::string line;
+				std::getline(stream, line);
+
+				if (!line.empty())
+					self->m_server.handle(self, line);
+
+				self->read();
+			}
+		);
+	}
+
+	void Session::write() {
+		boost::asio::async_write(
+			m_socket,
+			boost::asio::buffer(m_write_queue.front()),
+			[self = shared_from_this()](boost::system::error_code ec, size_t /*bytes*/) {
+				if (ec) {
+					self->m_server.remove_session(self);
+					return;
+				}
+
+				self->m_write_queue.pop_front();
+				if (!self->m_write_queue.empty())
+					self->write();
+			}
+		);
+	}
+
+	// returns an error if another daemon is listening, otherwise clears out a stale socket from a crashed one
+	tl::expected<void, std::string> claim_socket_path(const std::filesystem::path& socket_path) {
+		if (!std::filesystem::exists(socket_path))
+			return {};
+
+		boost::asio::io_context io_context;
+		local_protocol::socket probe(io_context);
+		boost::system::error_code ec;
+		probe.connect(local_protocol::endpoint(socket_path.string()), ec);
+
+		if (!ec)
+			return tl::unexpected(std::format("A daemon is already listening on {}", socket_path));
+
+		std::error_code remove_ec;
+		std::filesystem::remove(socket_path, remove_ec);
+		return {};
+	}
+}
+#endif
+
+std::filesystem::path job_server::get_default_socket_path() {
+	return u::get_settings_path() / SOCKET_FILENAME;
+}
+
+bool job_server::run(const std::filesystem::path& socket_path, bool verbose) {
+#ifndef BOOST_ASIO_HAS_LOCAL_SOCKETS
+	u::log("Daemon mode isn't supported on this platform");
+	return false;
+#else
+	auto init_res = blur.initialise(verbose, false);
+	if (!init_res) {
+		u::log("Blur failed to initialise");
+		u::log("Reason: {}", init_res.error());
+		return false;
+	}
+
+	auto socket_res = claim_socket_path(socket_path);
+	if (!socket_res) {
+		u::log(socket_res.error());
+		return false;
+	}
+
+	JobStore store;
+	auto store_res = store.open(blur.settings_path / QUEUE_FILENAME);
+	if (!store_res) {
+		u::log(store_res.error());
+		return false;
+	}
+
+	boost::asio::io_context io_context;
+	std::optional<Server> server;
+
+	try {
+		server.emplace(io_context, socket_path, store);
+	}
+	catch (const boost::system::system_error& e) {
+		u::log("Failed to listen on {}: {}", socket_path, e.what());
+		return false;
+	}
+
+	// tag render events with the job they belong to and hand them to whoever's waiting on it
+	event_sink.open([&](const std::string& line) {
+		auto event = nlohmann::json::parse(line, nullptr, false);
+		if (event.is_discarded())
+			return;
+
+		auto type = event.value("event", "");
+
+		std::optional<uint64_t> job_id;
+		if (event.contains("job_id")) {
+			job_id = event["job_id"].get<uint64_t>();
+		}
+		else if (event.contains("render_id")) {
+			auto render_id = event["render_id"].get<uint32_t>();
+			job_id = server->get_render_job(render_id);
+
+			if (is_terminal_event(type))
+				server->unmap_render(render_id);
+		}
+
+		if (!job_id)
+			return;
+
+		event["job_id"] = *job_id;
+
+		boost::asio::post(
+			io_context,
+			[&server,
+		     job_id = *job_id,
+		     type,
+		     tagged = event.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace)] {
+				server->forward_event(job_id, type, tagged);
+			}
+		);
+	});
+
+	server->accept();
+	std::thread io_thread([&] {
+		io_context.run();
+	});
+
+	u::log("Daemon listening on {} ({} queued jobs)", socket_path, store.get_pending_count());
+
+	while (!blur.exiting && !server->is_shutdown_requested()) {
+		auto job = store.take_next();
+		if (!job) {
+			server->wait_for_job(std::chrono::seconds(1));
+			continue;
+		}
+
+		if (verbose)
+			u::log("Starting job {} ({})", job->id, job->input);
+
+		// one bad job (an output path the filesystem rejects etc.) mustn't take the daemon and its queue down
+		std::optional<std::string> error;
+		try {
+			error = rendering.render_job(*job, [&](Render& render) {
+				server->map_render(render.get_render_id(), job->id);
+			});
+		}
+		catch (const std::exception& e) {
+			error = std::format("Job failed: {}", e.what());
+			u::log_error("{}", *error);
+
+			// whoever submitted it is still waiting on a terminal event. a second one after the render's own is
+			// harmless, sessions stop watching the job at the first
+			event_sink.emit("failed", { { "job_id", job->id }, { "error", *error } });
+		}
+
+		if (error)
+			store.set_state(job->id, JobState::FAILED, *error);
+		else
+			store.set_state(job->id, JobState::DONE);
+	}
+
+	// let the last events reach their clients before the sockets go away
+	event_sink.close();
+
+	io_context.stop();
+	if (io_thread.joinable())
+		io_thread.join();
+
+	server->close();
+
+	std::error_code ec;
+	std::filesystem::remove(socket_path, ec);
+
+	u::log("Daemon stopped");
+
+	return true;
+#endif
+}
+
+bool job_server::submit(
+	const std::filesystem::path& socket_path, const std::vector<Submission>& submissions, bool jsonl
+) {
+#ifndef BOOST_ASIO_HAS_LOCAL_SOCKETS
+	u::log("Daemon mode isn't supported on this platform");
+	return false;
+#else
+	boost::asio::io_context io_context;
+	local_protocol::socket socket(io_context);
+
+	boost::system::error_code ec;
+	socket.connect(local_protocol::endpoint(socket_path.string()), ec);
+	if (ec) {
+		u::log("Couldn't connect to a daemon at {} ({}), is blur-cli --daemon running?", socket_path, ec.message());
+		return false;
+	}
+
+	try {
+		for (const auto& submission : submissions) {
+			nlohmann::json request = {
+				{ "type", "submit" },
+				{ "input", std::format("{}", std::filesystem::absolute(submission.input)) },
+				{ "priority", submission.priority },
+				{ "wait", true },
+			};
+
+			if (submission.output)
+				request["output"] = std::format("{}", std::filesystem::absolute(*submission.output));
+
+			if (submission.config)
+				request["config"] = std::format("{}", std::filesystem::absolute(*submission.config));
+
+			for (const auto& branch : submission.branches) {
+				nlohmann::json branch_json = {
+					{ "config", std::format("{}", std::filesystem::absolute(branch.config)) },
+				};
+				if (branch.output)
+					branch_json["output"] = std::format("{}", std::filesystem::absolute(*branch.output));
+
+				request["branches"].push_back(std::move(branch_json));
+			}
+
+			boost::asio::write(socket, boost::asio::buffer(request.dump() + "\n"));
+		}
+
+		boost::asio::streambuf buffer;
+		size_t responses = 0;
+		std::set<uint64_t> waiting;
+		bool success = true;
+
+		while (responses < submissions.size() || !waiting.empty()) {
+			boost::asio::read_until(socket, buffer, '\n');
+
+			std::istream stream(&buffer);
+			std::string line;
+			std::getline(stream, line);
+
+			auto message = nlohmann::json::parse(line, nullptr, false);
+			if (message.is_discarded())
+				continue;
+
+			if (jsonl)
+				std::cout << line << std::endl;
+
+			auto type = message.value("type", "");
+			if (type == "accepted") {
+				responses++;
+				waiting.insert(message["job_id"].get<uint64_t>());
+				continue;
+			}
+
+			if (type == "error") {
+				responses++;
+				success = false;
+				if (!jsonl)
+					u::log("Daemon error: {}", message.value("message", ""));
+				continue;
+			}
+
+			auto event = message.value("event", "");
+			uint64_t job_id = message.value("job_id", uint64_t(0));
+
+			if (!jsonl) {
+				if (event == "progress") {
+					int frame = message.value("frame", 0);
+					int total_frames = message.value("total_frames", 0);
+					u::log(
+						"[job {}] {:.1f}% complete ({}/{}, {:.2f} fps)",
+						job_id,
+						total_frames > 0 ? frame * 100.f / total_frames : 0.f,
+						frame,
+						total_frames,
+						message.value("fps", 0.f)
+					);
+				}
+				else if (event == "finished") {
+					u::log("[job {}] finished: {}", job_id, message.value("output", ""));
+				}
+				else if (event == "failed") {
+					u::log("[job {}] failed: {}", job_id, message.value("error", ""));
+				}
+				else if (event == "stopped") {
+					u::log("[job {}] stopped", job_id);
+				}
+			}
+
+			if (is_terminal_event(event)) {
+				waiting.erase(job_id);
+				if (event != "finished")
+					success = false;
+			}
+		}
+
+		return success;
+	}
+	catch (const boost::system::system_error& e) {
+		u::log("Lost connection to the daemon: {}", e.what());
+		return false;
+	}
+#endif
+}
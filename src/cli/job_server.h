@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common/job_store.h"
+
+// long-lived render daemon. keeps blur initialised and takes jobs over a unix domain socket so submitting a clip
+// doesn't pay for startup every time. messages are newline-delimited json in both directions:
+//
+//   -> { "type": "submit", "input": "...", "output": "...", "config": "...", "priority": 0, "wait": true }
+//        (optionally "branches": [ { "config": "...", "output": "..." } ] to render more configs off the same pass)
+//   <- { "type": "accepted", "job_id": 1 }
+//   <- render events for the job (see EventSink) with a job_id field, until finished/failed/stopped (if waiting)
+//
+//   -> { "type": "status" }
+//   <- { "type": "status", "jobs": [ ... ] }
+//
+//   -> { "type": "shutdown" }   (stops taking jobs once the current render is done)
+//
+// the queue is kept in a JobStore so jobs survive the daemon going down
+namespace job_server {
+	const std::string SOCKET_FILENAME = "blur-daemon.sock";
+	const std::string QUEUE_FILENAME = "daemon_queue.jsonl";
+
+	std::filesystem::path get_default_socket_path();
+
+	bool run(const std::filesystem::path& socket_path, bool verbose);
+
+	struct Submission {
+		std::filesystem::path input;
+		std::optional<std::filesystem::path> output;
+		std::optional<std::filesystem::path> config;
+		std::vector<JobBranch> branches;
+		int priority = 0;
+	};
+
+	// thin client: submits to a running daemon and waits for every job to finish. events are printed as json lines
+	// if jsonl is set, otherwise as readable progress
+	bool submit(const std::filesystem::path& socket_path, const std::vector<Submission>& submissions, bool jsonl);
+}
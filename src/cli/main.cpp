@@ -1,4 +1,8 @@
 #include "cli.h"
+#include "job_server.h"
+#include "render_cluster.h"
+#include "common/event_sink.h"
+#include "common/live_input.h"
 
 #ifdef _WIN32
 using PathStr = std::wstring;
@@ -32,20 +36,252 @@ int main(int argc, char* argv[]) {
 	std::vector<PathStr> config_path_strs;
 	bool preview = false;
 	bool verbose = false;
+	bool background = false;
+	bool estimate = false;
+	std::string progress_format = "human";
+	std::string progress_output = "-";
+	std::chrono::milliseconds::rep progress_interval_ms = EventSink::DEFAULT_PROGRESS_INTERVAL.count();
+	bool daemon_mode = false;
+	bool client = false;
+	PathStr socket_path_str;
+	int priority = 0;
+	PathStr watch_folder_str;
+	bool worker_mode = false;
+	uint16_t worker_port = render_cluster::DEFAULT_PORT;
+	std::string worker_bind_address = render_cluster::DEFAULT_BIND_ADDRESS;
+	std::string cluster_token;
+	std::vector<std::string> worker_addresses;
+	bool fan_out = false;
+	bool live = false;
+	std::string stream_url;
+	std::chrono::milliseconds::rep latency_budget_ms = stream_output::DEFAULT_LATENCY_BUDGET.count();
+	std::chrono::seconds::rep live_timeout = LiveInput::DEFAULT_TIMEOUT.count();
 
-	app.add_option("-i,--input", input_strs, "Input file name(s)")->required();
+	app.add_option("-i,--input", input_strs, "Input file name(s)");
 	app.add_option("-o,--output", output_strs, "Output file name(s) (optional)");
 	app.add_option("-c,--config-path", config_path_strs, "Manual configuration file path(s) (optional)");
 	app.add_flag("-p,--preview", preview, "Enable preview");
 	app.add_flag("-v,--verbose", verbose, "Verbose mode");
+	app.add_flag(
+		"-b,--background", background, "Render at low priority and throttle when the system is busy (optional)"
+	);
+	app.add_flag("-e,--estimate", estimate, "Predict render time and memory use from past renders without rendering");
+
+	app.add_option("--progress-format", progress_format, "Progress output format")
+		->check(CLI::IsMember({ "human", "jsonl" }));
+	app.add_option(
+		"--progress-output", progress_output, "Where jsonl events go: - for stdout, fd:N, or a file path (default -)"
+	);
+	app.add_option("--progress-interval", progress_interval_ms, "Minimum milliseconds between jsonl progress events")
+		->check(CLI::NonNegativeNumber);
+
+	auto* daemon_flag = app.add_flag("--daemon", daemon_mode, "Run as a daemon taking render jobs over a local socket");
+	app.add_flag("--client", client, "Submit the inputs to a running daemon and wait for them")->excludes(daemon_flag);
+	app.add_option("--socket", socket_path_str, "Daemon socket path (optional)");
+	app.add_option("--priority", priority, "Job priority when submitting to a daemon, higher renders first (optional)");
+
+	app.add_option(
+		"--watch", watch_folder_str, "Render new videos as they appear in a folder, using -c as the config (optional)"
+	);
+
+	app.add_flag("--worker", worker_mode, "Run as a worker rendering segments for distributed renders")
+		->excludes(daemon_flag);
+	app.add_option("--port", worker_port, "Port the worker listens on (optional)");
+	app.add_option(
+		"--bind", worker_bind_address, "Address the worker listens on, 0.0.0.0 or :: for every interface (optional)"
+	);
+	app.add_option(
+		"--token",
+		cluster_token,
+		std::format(
+			"Shared secret coordinators have to send workers (optional, or set {})", render_cluster::TOKEN_ENV_VAR
+		)
+	);
+	app.add_option("--workers", worker_addresses, "Split each render across these workers (host:port, comma separated)")
+		->delimiter(',');
+
+	app.add_flag("--fan-out", fan_out, "Render one input with every -c config in a single pass, outputs matching them");
+
+	app.add_flag("--live", live, "Render inputs that are still being recorded, finishing once recording stops");
+	app.add_option("--live-timeout", live_timeout, "Seconds a live input can stop growing before it ends (optional)")
+		->check(CLI::PositiveNumber);
+
+	app.add_option("--stream", stream_url, "Stream mpeg-ts to a url (udp://..., a named pipe, or - for stdout)");
+	app.add_option("--latency-budget", latency_budget_ms, "Target milliseconds of delay when streaming (optional)")
+		->check(CLI::PositiveNumber);
 
 	CLI11_PARSE(app, argc, argv);
 
+	std::filesystem::path socket_path =
+		socket_path_str.empty() ? job_server::get_default_socket_path() : std::filesystem::path(socket_path_str);
+
+	if (daemon_mode)
+		return job_server::run(socket_path, verbose) ? 0 : 1;
+
+	if (cluster_token.empty()) {
+		if (const char* token = std::getenv(render_cluster::TOKEN_ENV_VAR.c_str()))
+			cluster_token = token;
+	}
+
+	if (worker_mode)
+		return render_cluster::run_worker(worker_bind_address, worker_port, cluster_token, verbose) ? 0 : 1;
+
+	if (input_strs.empty() && watch_folder_str.empty()) {
+		std::cerr << "--input is required\n";
+		return 1;
+	}
+
+	if (stream_url == "-" && progress_format == "jsonl" && progress_output == "-") {
+		std::cerr << "Can't stream to stdout and write progress to it too, use --progress-output\n";
+		return 1;
+	}
+
+	if (progress_format == "jsonl" && !client) {
+		auto open_res = event_sink.open(progress_output, std::chrono::milliseconds(progress_interval_ms));
+		if (!open_res) {
+			std::cerr << open_res.error() << "\n";
+			return 1;
+		}
+
+		if (event_sink.is_stdout())
+			u::redirect_logs_to_stderr();
+	}
+
+	if (!watch_folder_str.empty()) {
+		if (config_path_strs.size() > 1) {
+			std::cerr << "Watch mode takes at most one config path\n";
+			return 1;
+		}
+
+		std::optional<std::filesystem::path> watch_config;
+		if (!config_path_strs.empty())
+			watch_config = std::filesystem::path(config_path_strs.front());
+
+		bool watch_res = cli::watch(std::filesystem::path(watch_folder_str), watch_config, verbose, background);
+		event_sink.close();
+
+		return watch_res ? 0 : 1;
+	}
+
 	auto inputs = to_paths(input_strs);
 	auto outputs = to_paths(output_strs);
 	auto config_paths = to_paths(config_path_strs);
 
-	cli::run(inputs, outputs, config_paths, preview, verbose);
+	if (fan_out) {
+		bool output_count_ok = outputs.empty() || outputs.size() == config_paths.size();
+		if (inputs.size() != 1 || config_paths.size() < 2 || !output_count_ok) {
+			std::cerr << "--fan-out takes one input, two or more configs and either no outputs or one per config\n";
+			return 1;
+		}
+
+		if (client) {
+			job_server::Submission submission{
+				.input = inputs[0],
+				.output = outputs.empty() ? std::nullopt : std::optional(outputs[0]),
+				.config = config_paths[0],
+				.priority = priority,
+			};
+
+			for (size_t i = 1; i < config_paths.size(); i++) {
+				submission.branches.push_back({
+					.config = config_paths[i],
+					.output = outputs.empty() ? std::nullopt : std::optional(outputs[i]),
+				});
+			}
+
+			if (progress_format == "jsonl")
+				u::redirect_logs_to_stderr();
+
+			return job_server::submit(socket_path, { submission }, progress_format == "jsonl") ? 0 : 1;
+		}
+
+		bool success = cli::fan_out(inputs[0], outputs, config_paths, verbose, background);
+
+		event_sink.close();
+
+		return success ? 0 : 1;
+	}
+
+	if (!worker_addresses.empty()) {
+		if ((!outputs.empty() && outputs.size() != inputs.size()) ||
+		    (!config_paths.empty() && config_paths.size() != inputs.size()))
+		{
+			std::cerr << "Output and config path counts have to match the input count\n";
+			return 1;
+		}
+
+		bool success = true;
+		for (size_t i = 0; i < inputs.size() && !blur.exiting; i++) {
+			success &= render_cluster::run_coordinator(
+				inputs[i],
+				outputs.empty() ? std::nullopt : std::optional(outputs[i]),
+				config_paths.empty() ? std::nullopt : std::optional(config_paths[i]),
+				worker_addresses,
+				cluster_token,
+				verbose
+			);
+		}
+
+		event_sink.close();
+
+		return success ? 0 : 1;
+	}
+
+	if (client) {
+		if ((!outputs.empty() && outputs.size() != inputs.size()) ||
+		    (!config_paths.empty() && config_paths.size() != inputs.size()))
+		{
+			std::cerr << "Output and config path counts have to match the input count\n";
+			return 1;
+		}
+
+		std::vector<job_server::Submission> submissions;
+		for (size_t i = 0; i < inputs.size(); i++) {
+			submissions.push_back({
+				.input = inputs[i],
+				.output = outputs.empty() ? std::nullopt : std::optional(outputs[i]),
+				.config = config_paths.empty() ? std::nullopt : std::optional(config_paths[i]),
+				.priority = priority,
+			});
+		}
+
+		if (progress_format == "jsonl")
+			u::redirect_logs_to_stderr();
+
+		return job_server::submit(socket_path, submissions, progress_format == "jsonl") ? 0 : 1;
+	}
+
+	std::optional<stream_output::Settings> stream;
+	if (!stream_url.empty()) {
+		if (inputs.size() != 1) {
+			std::cerr << "Streaming takes exactly one input\n";
+			return 1;
+		}
+
+		stream = stream_output::Settings{
+			.url = stream_url,
+			.latency_budget = std::chrono::milliseconds(latency_budget_ms),
+		};
+
+		// the stream itself goes to stdout
+		if (stream->to_stdout())
+			u::redirect_logs_to_stderr();
+	}
+
+	cli::run(
+		inputs,
+		outputs,
+		config_paths,
+		preview,
+		verbose,
+		false,
+		background,
+		estimate,
+		live ? std::optional(std::chrono::seconds(live_timeout)) : std::nullopt,
+		stream
+	);
+
+	event_sink.close();
 
 	return 0;
 }
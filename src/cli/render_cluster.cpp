@@ -0,0 +1,1211 @@
+#include "render_cluster.h"
+#include "common/rendering.h"
+#include "common/event_sink.h"
+
+namespace {
+	using tcp = boost::asio::ip::tcp;
+
+	// a worker has to say something at least this often, it sends progress every second while rendering
+	constexpr auto MESSAGE_TIMEOUT = std::chrono::seconds(60);
+	constexpr auto CONNECT_TIMEOUT = std::chrono::seconds(10);
+	constexpr auto PROGRESS_INTERVAL = std::chrono::seconds(1);
+
+	constexpr double MIN_SEGMENT_SECONDS = 10.0;
+	constexpr double CONTEXT_SECONDS = 1.0;
+	constexpr size_t SEGMENTS_PER_WORKER = 3; // a few each so faster workers pick up the slack
+	constexpr size_t MAX_ATTEMPTS = 3;
+	constexpr size_t TRANSFER_CHUNK_SIZE = 1024 * 1024;
+
+	// header lines are small, anything longer without a newline isn't a message
+	constexpr size_t MAX_HEADER_SIZE = TRANSFER_CHUNK_SIZE;
+
+	// input chunks and rendered segments are seconds to minutes of video
+	constexpr uintmax_t MAX_TRANSFER_SIZE = 16ULL * 1024 * 1024 * 1024;
+
+	// input to output frame ratios with a bigger gap than this aren't going to have keyframes that line up
+	constexpr int MAX_FRAME_GAP = 1000;
+
+	// output frame counts can be a frame or two off the exact ratio at the end of the video
+	constexpr int FRAME_COUNT_SLACK = 2;
+
+	// blocking messages over tcp, every operation times out so a dead peer can't hang us
+	class Connection {
+	public:
+		Connection(boost::asio::io_context& io_context, tcp::socket socket)
+			: m_io_context(io_context), m_socket(std::move(socket)) {}
+
+		explicit Connection(boost::asio::io_context& io_context)
+			: m_io_context(io_context), m_socket(io_context) {}
+
+		tl::expected<void, std::string> connect(const std::string& host, const std::string& port) {
+			boost::system::error_code ec;
+			tcp::resolver resolver(m_io_context);
+			auto endpoints = resolver.resolve(host, port, ec);
+			if (ec)
+				return tl::unexpected(ec.message());
+
+			ec = run(CONNECT_TIMEOUT, [&](auto handler) {
+				boost::asio::async_connect(m_socket, endpoints, handler);
+			});
+			if (ec)
+				return tl::unexpected(ec.message());
+
+			m_socket.set_option(tcp::no_delay(true), ec);
+
+			return {};
+		}
+
+		tl::expected<void, std::string> send(
+			nlohmann::json header, const std::optional<std::filesystem::path>& payload = {}
+		) {
+			std::lock_guard lock(m_send_mutex);
+
+			std::ifstream file;
+			uintmax_t size = 0;
+
+			if (payload) {
+				std::error_code fs_ec;
+				size = std::filesystem::file_size(*payload, fs_ec);
+				if (fs_ec)
+					return tl::unexpected(std::format("Failed to read {}: {}", *payload, fs_ec.message()));
+
+				file.open(*payload, std::ios::binary);
+				if (!file)
+					return tl::unexpected(std::format("Failed to open {}", *payload));
+
+				header["size"] = size;
+			}
+
+			auto line = header.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + "\n";
+
+			auto ec = run(MESSAGE_TIMEOUT, [&](auto handler) {
+				boost::asio::async_write(m_socket, boost::asio::buffer(line), handler);
+			});
+			if (ec)
+				return tl::unexpected(ec.message());
+
+			std::vector<char> chunk(TRANSFER_CHUNK_SIZE);
+			while (size > 0) {
+				auto to_read = static_cast<std::streamsize>(std::min<uintmax_t>(chunk.size(), size));
+				if (!file.read(chunk.data(), to_read))
+					return tl::unexpected(std::format("Failed to read {}", *payload));
+
+				ec = run(MESSAGE_TIMEOUT, [&](auto handler) {
+					boost::asio::async_write(m_socket, boost::asio::buffer(chunk.data(), to_read), handler);
+				});
+				if (ec)
+					return tl::unexpected(ec.message());
+
+				size -= to_read;
+			}
+
+			return {};
+		}
+
+		// payload data is written to payload_path, or discarded if there isn't one. messages with more than max_size
+		// bytes of it are refused before any is read
+		tl::expected<nlohmann::json, std::string> receive(
+			const std::optional<std::filesystem::path>& payload_path = {}, uintmax_t max_size = MAX_TRANSFER_SIZE
+		) {
+			auto ec = run(MESSAGE_TIMEOUT, [&](auto handler) {
+				boost::asio::async_read_until(m_socket, m_buffer, '\n', handler);
+			});
+			if (ec)
+				return tl::unexpected(ec.message());
+
+			std::string line;
+			std::istream stream(&m_buffer);
+			std::getline(stream, line);
+
+			auto header = nlohmann::json::parse(line, nullptr, false);
+			if (header.is_discarded() || !header.is_object())
+				return tl::unexpected("Received a malformed message");
+
+			if (header.contains("size") && !header["size"].is_number_unsigned())
+				return tl::unexpected("Received a malformed message");
+
+			uintmax_t size = header.value("size", uintmax_t(0));
+			if (size == 0)
+				return header;
+
+			if (size > max_size)
+				return tl::unexpected(std::format("Message is too large ({} bytes, at most {})", size, max_size));
+
+			std::ofstream file;
+			if (payload_path) {
+				file.open(*payload_path, std::ios::binary | std::ios::trunc);
+				if (!file)
+					return tl::unexpected(std::format("Failed to write {}", *payload_path));
+			}
+
+			auto write_buffered = [&] {
+				auto buffered = std::min<uintmax_t>(m_buffer.size(), size);
+				if (buffered == 0)
+					return;
+
+				if (file.is_open()) {
+					file.write(
+						static_cast<const char*>(m_buffer.data().data()), static_cast<std::streamsize>(buffered)
+					);
+				}
+
+				m_buffer.consume(buffered);
+				size -= buffered;
+			};
+
+			// read_until may have pulled in the start of the payload already
+			write_buffered();
+
+			while (size > 0) {
+				auto to_read = std::min<uintmax_t>(TRANSFER_CHUNK_SIZE, size);
+
+				ec = run(MESSAGE_TIMEOUT, [&](auto handler) {
+					boost::asio::async_read(m_socket, m_buffer, boost::asio::transfer_exactly(to_read), handler);
+				});
+				if (ec)
+					return tl::unexpected(ec.message());
+
+				write_buffered();
+			}
+
+			if (file.is_open() && !file)
+				return tl::unexpected(std::format("Failed to write {}", *payload_path));
+
+			return header;
+		}
+
+		void close() {
+			boost::system::error_code ec;
+			m_socket.shutdown(tcp::socket::shutdown_both, ec);
+			m_socket.close(ec);
+		}
+
+		[[nodiscard]] std::string get_remote_address() const {
+			boost::system::error_code ec;
+			auto endpoint = m_socket.remote_endpoint(ec);
+			if (ec)
+				return "unknown";
+
+			return std::format("{}:{}", endpoint.address().to_string(), endpoint.port());
+		}
+
+	private:
+		boost::asio::io_context& m_io_context;
+		tcp::socket m_socket;
+		boost::asio::streambuf m_buffer{ MAX_HEADER_SIZE };
+		std::mutex m_send_mutex;
+
+		template <typename Operation>
+		boost::system::error_code run(std::chrono::seconds timeout, Operation&& operation) {
+			boost::system::error_code result = boost::asio::error::would_block;
+
+			operation([&](const boost::system::error_code& ec, auto&&...) {
+				result = ec;
+			});
+
+			m_io_context.restart();
+			m_io_context.run_for(timeout);
+
+			if (result == boost::asio::error::would_block) {
+				// cancel it and let the handler run before anything it references goes away
+				boost::system::error_code close_ec;
+				m_socket.close(close_ec);
+
+				m_io_context.restart();
+				m_io_context.run();
+
+				return boost::asio::error::timed_out;
+			}
+
+			return result;
+		}
+	};
+
+	// looks at every byte whatever it finds, so timing doesn't give away how much of a guess was right
+	bool tokens_match(const std::string& received, const std::string& token) {
+		if (received.size() != token.size())
+			return false;
+
+		unsigned char difference = 0;
+		for (size_t i = 0; i < token.size(); i++)
+			difference |= static_cast<unsigned char>(received[i] ^ token[i]);
+
+		return difference == 0;
+	}
+
+	// coordinator side of the handshake
+	tl::expected<void, std::string> authenticate(Connection& connection, const std::string& token) {
+		auto send_res = connection.send({ { "type", "hello" }, { "token", token } });
+		if (!send_res)
+			return tl::unexpected(send_res.error());
+
+		auto response = connection.receive({}, 0);
+		if (!response)
+			return tl::unexpected(response.error());
+
+		if (response->value("type", "") != "welcome")
+			return tl::unexpected(response->value("error", "Worker refused the connection"));
+
+		return {};
+	}
+
+	// worker side. nothing else is read from a connection until this passes
+	bool accept_coordinator(Connection& connection, const std::string& token) {
+		auto hello = connection.receive({}, 0);
+		if (!hello)
+			return false;
+
+		auto received = hello->find("token");
+		if (hello->value("type", "") != "hello" || received == hello->end() || !received->is_string() ||
+		    !tokens_match(received->get<std::string>(), token))
+		{
+			(void)connection.send({ { "type", "failed" }, { "error", "Wrong token" } });
+			return false;
+		}
+
+		return connection.send({ { "type", "welcome" } }).has_value();
+	}
+
+	// the rendered segment is usually no bigger than its input chunk, it needs room too
+	uintmax_t get_max_chunk_size(const std::filesystem::path& temp_path) {
+		std::error_code ec;
+		auto space = std::filesystem::space(temp_path, ec);
+		if (ec)
+			return MAX_TRANSFER_SIZE;
+
+		return std::min(MAX_TRANSFER_SIZE, space.available / 2);
+	}
+
+	std::pair<std::string, std::string> split_address(const std::string& address) {
+		auto colon = address.rfind(':');
+		if (colon == std::string::npos || address.find(']', colon) != std::string::npos)
+			return { address, std::to_string(render_cluster::DEFAULT_PORT) };
+
+		auto host = address.substr(0, colon);
+		if (host.starts_with('[') && host.ends_with(']'))
+			host = host.substr(1, host.size() - 2);
+
+		return { host, address.substr(colon + 1) };
+	}
+
+	// keyframe packets are flagged in the container, so this doesn't need to decode anything
+	std::vector<render_cluster::Keyframe> get_keyframes(const std::filesystem::path& path, int fps_num, int fps_den) {
+		namespace bp = boost::process;
+
+		bp::ipstream pipe_stream;
+		bp::child c(
+			boost::filesystem::path{ blur.ffprobe_path },
+			"-v",
+			"error",
+			"-select_streams",
+			"v:0",
+			"-show_entries",
+			"packet=pts_time,flags",
+			"-of",
+			"csv=p=0",
+			boost::filesystem::path{ path },
+			bp::std_out > pipe_stream,
+			bp::std_err.null()
+#ifdef _WIN32
+				,
+			bp::windows::create_no_window
+#endif
+		);
+
+		std::optional<double> first_time;
+		std::vector<double> keyframe_times;
+
+		std::string line;
+		while (pipe_stream && std::getline(pipe_stream, line)) {
+			boost::algorithm::trim(line);
+
+			auto fields = u::split_string(line, ",");
+			if (fields.size() < 2)
+				continue;
+
+			double time = 0.0;
+			try {
+				time = std::stod(fields[0]);
+			}
+			catch (...) {
+				continue; // N/A
+			}
+
+			first_time = std::min(first_time.value_or(time), time);
+
+			if (u::contains(fields[1], "K"))
+				keyframe_times.push_back(time);
+		}
+
+		c.wait();
+
+		std::vector<render_cluster::Keyframe> keyframes;
+		if (!first_time)
+			return keyframes;
+
+		std::ranges::sort(keyframe_times);
+
+		for (double time : keyframe_times) {
+			double relative_time = time - *first_time;
+			int frame = static_cast<int>(std::lround(relative_time * fps_num / fps_den));
+
+			if (!keyframes.empty() && keyframes.back().frame == frame)
+				continue;
+
+			keyframes.push_back({ .frame = frame, .time = relative_time });
+		}
+
+		return keyframes;
+	}
+
+	tl::expected<void, std::string> run_ffmpeg(const std::vector<std::wstring>& args) {
+		namespace bp = boost::process;
+
+		try {
+			bp::ipstream ffmpeg_stderr;
+			bp::child ffmpeg_process(
+				boost::filesystem::path{ blur.ffmpeg_path },
+				bp::args(args),
+				bp::std_out.null(),
+				bp::std_err > ffmpeg_stderr
+#ifdef _WIN32
+				,
+				bp::windows::create_no_window
+#endif
+			);
+
+			std::string errors((std::istreambuf_iterator<char>(ffmpeg_stderr)), std::istreambuf_iterator<char>());
+
+			ffmpeg_process.wait();
+
+			if (ffmpeg_process.exit_code() != 0)
+				return tl::unexpected(errors);
+
+			return {};
+		}
+		catch (const boost::system::system_error& e) {
+			return tl::unexpected(e.what());
+		}
+	}
+
+	tl::expected<void, std::string> extract_chunk(
+		const std::filesystem::path& input, const render_cluster::Segment& segment, const std::filesystem::path& output
+	) {
+		std::vector<std::wstring> args = { L"-loglevel", L"error", L"-hide_banner", L"-y" };
+
+		if (segment.chunk_start > 0) {
+			// nudged forward a little so rounding can't land it on the keyframe before
+			args.insert(args.end(), { L"-ss", std::format(L"{:.6f}", segment.chunk_start_time + 0.0005) });
+		}
+
+		args.insert(args.end(), { L"-i", input.wstring() });
+
+		if (segment.chunk_end_time) {
+			args.insert(
+				args.end(), { L"-t", std::format(L"{:.6f}", *segment.chunk_end_time - segment.chunk_start_time) }
+			);
+		}
+
+		// cut to a partial name first, the chunk is reused if it exists so a failed cut mustn't leave one behind.
+		// keeps the extension so ffmpeg still picks the muxer from it
+		auto partial_path = output;
+		partial_path.replace_extension(".partial" + output.extension().string());
+
+		args.insert(
+			args.end(), { L"-map", L"0:v:0", L"-c", L"copy", L"-an", L"-sn", L"-dn", partial_path.wstring() }
+		);
+
+		auto res = run_ffmpeg(args);
+
+		std::error_code ec;
+		if (res) {
+			std::filesystem::rename(partial_path, output, ec);
+			if (ec)
+				res = tl::unexpected(std::format("Failed to save chunk: {}", ec.message()));
+		}
+
+		if (!res)
+			std::filesystem::remove(partial_path, ec);
+
+		return res;
+	}
+
+	// coordinator side bookkeeping, shared by the thread driving each worker
+	class SegmentQueue {
+	public:
+		SegmentQueue(std::vector<render_cluster::Segment> segments, size_t workers)
+			: m_segments(std::move(segments)), m_states(m_segments.size()), m_live_workers(workers),
+			  m_remaining(m_segments.size()) {}
+
+		// blocks until there's a segment this worker should take, or returns nothing once there's no more work
+		std::optional<render_cluster::Segment> take(size_t worker) {
+			std::unique_lock lock(m_mutex);
+
+			while (true) {
+				if (m_error || m_remaining == 0)
+					return {};
+
+				for (size_t i = 0; i < m_segments.size(); i++) {
+					auto& state = m_states[i];
+					if (state.status != Status::PENDING)
+						continue;
+
+					// give failures to somebody else first, unless everyone left has already had a go
+					if (state.tried.contains(worker) && state.tried.size() < m_live_workers)
+						continue;
+
+					state.status = Status::RUNNING;
+					state.tried.insert(worker);
+					state.attempts++;
+					return m_segments[i];
+				}
+
+				m_cv.wait(lock);
+			}
+		}
+
+		void finish(size_t index) {
+			std::lock_guard lock(m_mutex);
+
+			m_states[index].status = Status::DONE;
+			m_remaining--;
+			m_cv.notify_all();
+		}
+
+		void retry(size_t index, const std::string& error) {
+			std::lock_guard lock(m_mutex);
+
+			auto& state = m_states[index];
+			if (state.attempts >= MAX_ATTEMPTS) {
+				m_error = std::format("Segment {} failed {} times, last error: {}", index, state.attempts, error);
+			}
+			else {
+				state.status = Status::PENDING;
+			}
+
+			m_cv.notify_all();
+		}
+
+		void remove_worker() {
+			std::lock_guard lock(m_mutex);
+
+			m_live_workers--;
+			if (m_live_workers == 0 && m_remaining > 0 && !m_error)
+				m_error = "No workers left";
+
+			m_cv.notify_all();
+		}
+
+		std::optional<std::string> get_error() {
+			std::lock_guard lock(m_mutex);
+			return m_error;
+		}
+
+		size_t get_remaining() {
+			std::lock_guard lock(m_mutex);
+			return m_remaining;
+		}
+
+	private:
+		enum class Status : uint8_t {
+			PENDING,
+			RUNNING,
+			DONE
+		};
+
+		struct State {
+			Status status = Status::PENDING;
+			std::set<size_t> tried;
+			size_t attempts = 0;
+		};
+
+		std::vector<render_cluster::Segment> m_segments;
+		std::vector<State> m_states;
+		size_t m_live_workers;
+		size_t m_remaining;
+		std::optional<std::string> m_error;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+	};
+
+	std::filesystem::path get_segment_path(const std::filesystem::path& temp_path, size_t index) {
+		return temp_path / std::format("segment_{:05}.mp4", index);
+	}
+
+	tl::expected<void, std::string> render_segment_on(
+		Connection& connection,
+		const render_cluster::Segment& segment,
+		const std::filesystem::path& input,
+		const std::filesystem::path& temp_path,
+		const std::string& config,
+		const u::VideoInfo& video_info,
+		bool& connection_lost
+	) {
+		auto chunk_path = temp_path / std::format("chunk_{:05}.mkv", segment.index);
+		if (!std::filesystem::exists(chunk_path)) {
+			auto extract_res = extract_chunk(input, segment, chunk_path);
+			if (!extract_res)
+				return tl::unexpected(std::format("Failed to cut input chunk: {}", extract_res.error()));
+		}
+
+		nlohmann::json request = {
+			{ "type", "segment" },
+			{ "id", segment.index },
+			{ "version", BLUR_VERSION },
+			{ "config", config },
+			{ "fps_num", video_info.fps_num },
+			{ "fps_den", video_info.fps_den },
+			{ "output_start", segment.output_skip },
+			{ "output_frames", segment.output_end - segment.output_start },
+		};
+
+		auto send_res = connection.send(request, chunk_path);
+		if (!send_res) {
+			connection_lost = true;
+			return tl::unexpected(send_res.error());
+		}
+
+		auto segment_path = get_segment_path(temp_path, segment.index);
+
+		while (true) {
+			auto response = connection.receive(segment_path);
+			if (!response) {
+				connection_lost = true;
+				return tl::unexpected(response.error());
+			}
+
+			auto type = response->value("type", "");
+
+			if (type == "progress")
+				continue;
+
+			if (type == "failed")
+				return tl::unexpected(response->value("error", "unknown error"));
+
+			if (type == "done") {
+				int frames = response->value("frames", 0);
+				if (frames != segment.output_end - segment.output_start) {
+					u::log(
+						"Segment {} came back with {} frames instead of {}",
+						segment.index,
+						frames,
+						segment.output_end - segment.output_start
+					);
+				}
+
+				return {};
+			}
+		}
+	}
+
+	tl::expected<void, std::string> join_segments(
+		Render& render, size_t segment_count, const std::filesystem::path& temp_path
+	) {
+		auto list_path = temp_path / "segments.txt";
+
+		{
+			std::ofstream list(list_path);
+			for (size_t i = 0; i < segment_count; i++) {
+				auto path = std::format("{}", get_segment_path(temp_path, i));
+				boost::algorithm::replace_all(path, "'", "'\\''");
+				list << "file '" << path << "'\n";
+			}
+		}
+
+		std::vector<std::wstring> args = { L"-loglevel",
+			                               L"error",
+			                               L"-hide_banner",
+			                               L"-y",
+			                               L"-f",
+			                               L"concat",
+			                               L"-safe",
+			                               L"0",
+			                               L"-i",
+			                               list_path.wstring(),
+			                               L"-fflags",
+			                               L"+genpts",
+			                               L"-i",
+			                               render.get_input_video_path().wstring(),
+			                               L"-map",
+			                               L"0:v",
+			                               L"-map",
+			                               L"1:a?",
+			                               L"-c:v",
+			                               L"copy" };
+
+		auto audio_filter_args = render.build_audio_filter_args();
+		args.insert(args.end(), audio_filter_args.begin(), audio_filter_args.end());
+
+		args.insert(
+			args.end(),
+			{ L"-c:a", L"aac", L"-b:a", L"320k", L"-movflags", L"+faststart", render.get_output_video_path().wstring() }
+		);
+
+		return run_ffmpeg(args);
+	}
+
+	// worker side
+	void handle_segment(
+		Connection& connection, const nlohmann::json& request, const std::filesystem::path& chunk_path, bool verbose
+	) {
+		auto id = request.value("id", uint64_t(0));
+
+		auto fail = [&](const std::string& error) {
+			u::log("Segment {} failed: {}", id, error);
+			(void)connection.send({ { "type", "failed" }, { "id", id }, { "error", error } });
+		};
+
+		if (request.value("version", "") != BLUR_VERSION) {
+			fail(std::format("Version mismatch (worker is on {})", BLUR_VERSION));
+			return;
+		}
+
+		auto temp_path = chunk_path.parent_path();
+		auto config_path = temp_path / "segment.cfg";
+		auto segment_path = temp_path / "segment.mp4";
+
+		{
+			std::ofstream config_file(config_path);
+			config_file << request.value("config", "");
+		}
+
+		auto video_info = u::get_video_info(chunk_path);
+		if (!video_info.has_video_stream) {
+			fail("Received an unreadable input chunk");
+			return;
+		}
+
+		// containers don't always keep the exact rate through a stream copy
+		video_info.fps_num = request.value("fps_num", video_info.fps_num);
+		video_info.fps_den = request.value("fps_den", video_info.fps_den);
+
+		Render render(chunk_path, video_info, segment_path, config_path);
+
+		// custom ffmpeg arguments can read and write anything the worker can, they're not run for other machines
+		if (!render.get_settings().advanced.ffmpeg_override.empty()) {
+			fail("Workers don't accept configs with custom ffmpeg filters");
+			return;
+		}
+
+		std::atomic<bool> rendering_segment = true;
+		std::atomic<bool> coordinator_lost = false;
+
+		// keep the coordinator from timing us out, and notice if it's gone
+		std::thread progress_thread([&] {
+			while (rendering_segment) {
+				auto status = render.get_status();
+				auto res = connection.send({
+					{ "type", "progress" },
+					{ "id", id },
+					{ "frame", status.current_frame },
+					{ "total", status.total_frames },
+				});
+				if (!res) {
+					coordinator_lost = true;
+					render.stop();
+					return;
+				}
+
+				for (int i = 0; i < 10 && rendering_segment; i++)
+					std::this_thread::sleep_for(PROGRESS_INTERVAL / 10);
+			}
+		});
+
+		auto finish_progress = [&] {
+			rendering_segment = false;
+			if (progress_thread.joinable())
+				progress_thread.join();
+		};
+
+		auto frame_count = render.get_output_frame_count();
+		if (!frame_count) {
+			finish_progress();
+			fail(frame_count.error());
+			return;
+		}
+
+		int start = request.value("output_start", 0);
+		int end = std::min(start + request.value("output_frames", 0), *frame_count) - 1;
+		if (start >= *frame_count || end < start) {
+			finish_progress();
+			fail(std::format("Output range starts at {} but the chunk only has {} frames", start, *frame_count));
+			return;
+		}
+
+		render.set_frame_range({ .start = start, .end = end });
+
+		if (verbose)
+			u::log("Rendering segment {} (output frames {}-{} of the chunk)", id, start, end);
+
+		auto render_res = render.render();
+
+		finish_progress();
+
+		if (coordinator_lost)
+			return;
+
+		if (!render_res) {
+			fail(render_res.error());
+			return;
+		}
+
+		if (render_res->stopped) {
+			fail("Render was stopped");
+			return;
+		}
+
+		auto send_res = connection.send(
+			{ { "type", "done" }, { "id", id }, { "frames", end - start + 1 } }, segment_path
+		);
+		if (!send_res)
+			u::log("Failed to send segment {} back: {}", id, send_res.error());
+		else if (verbose)
+			u::log("Sent segment {} back", id);
+	}
+}
+
+std::optional<int> render_cluster::get_frame_gap(int input_frames, int output_frames) {
+	if (input_frames <= 0 || output_frames <= 0)
+		return {};
+
+	for (int gap = 1; gap <= MAX_FRAME_GAP; gap++) {
+		auto gap_output = std::llround(static_cast<double>(output_frames) * gap / input_frames);
+
+		// this many output frames per gap has to account for the whole video
+		auto difference = std::abs(static_cast<int64_t>(input_frames) * gap_output - int64_t(output_frames) * gap);
+		if (difference <= static_cast<int64_t>(FRAME_COUNT_SLACK) * gap)
+			return gap;
+	}
+
+	return {};
+}
+
+std::vector<render_cluster::Segment> render_cluster::plan_segments(
+	const std::vector<Keyframe>& keyframes,
+	int input_frames,
+	int output_frames,
+	int target_frames,
+	int context_frames,
+	int frame_gap
+) {
+	std::vector<Segment> segments;
+	if (keyframes.empty() || input_frames <= 0 || output_frames <= 0 || frame_gap <= 0)
+		return segments;
+
+	double ratio = output_frames / static_cast<double>(input_frames);
+	auto to_output = [&](int frame) {
+		return std::clamp(static_cast<int>(std::lround(frame * ratio)), 0, output_frames);
+	};
+
+	// keyframe a chunk for the segment starting at keyframes[index] can start on. far enough back to give the
+	// filters some history, not so far it doubles the chunk, and lined up with the output frames. the start of the
+	// video always is
+	auto find_chunk_start = [&](size_t index) -> std::optional<size_t> {
+		int start = keyframes[index].frame;
+
+		for (size_t i = index; i > 0; i--) {
+			int context = start - keyframes[i].frame;
+			if (context > context_frames + target_frames)
+				return {};
+
+			if (context >= context_frames && keyframes[i].frame % frame_gap == 0)
+				return i;
+		}
+
+		if (start > context_frames + target_frames)
+			return {};
+
+		return 0;
+	};
+
+	// keyframes segments start on. don't leave a tiny segment at the end, it'd cost more in overhead than it saves
+	std::vector<size_t> boundaries = { 0 };
+	for (size_t i = 1; i < keyframes.size(); i++) {
+		int frame = keyframes[i].frame;
+		if (frame >= input_frames - (target_frames / 2))
+			break;
+
+		if (frame - keyframes[boundaries.back()].frame >= target_frames && find_chunk_start(i))
+			boundaries.push_back(i);
+	}
+
+	for (size_t b = 0; b < boundaries.size(); b++) {
+		bool first = b == 0;
+		bool last = b + 1 == boundaries.size();
+
+		int start = first ? 0 : keyframes[boundaries[b]].frame;
+		int end = last ? input_frames : keyframes[boundaries[b + 1]].frame;
+
+		size_t chunk_start_index = first ? 0 : *find_chunk_start(boundaries[b]);
+
+		// step forward past the end to give the filters some lookahead
+		std::optional<size_t> chunk_end_index;
+		if (!last) {
+			size_t i = boundaries[b + 1];
+			while (i < keyframes.size() && keyframes[i].frame - end < context_frames)
+				i++;
+
+			if (i < keyframes.size() && keyframes[i].frame < input_frames)
+				chunk_end_index = i;
+		}
+
+		int chunk_start = chunk_start_index == 0 ? 0 : keyframes[chunk_start_index].frame;
+
+		Segment segment{
+			.index = b,
+			.start = start,
+			.end = end,
+			.chunk_start = chunk_start,
+			.chunk_end = chunk_end_index ? keyframes[*chunk_end_index].frame : input_frames,
+			.chunk_start_time = chunk_start_index == 0 ? 0.0 : keyframes[chunk_start_index].time,
+			.chunk_end_time = chunk_end_index ? std::optional(keyframes[*chunk_end_index].time) : std::nullopt,
+			.output_start = to_output(start),
+			.output_end = last ? output_frames : to_output(end),
+			.output_skip = 0,
+		};
+
+		// the chunk's first output frame is exactly the single pass render's to_output(chunk_start)th since it
+		// starts on the frame gap
+		segment.output_skip = segment.output_start - to_output(chunk_start);
+
+		if (segment.output_end > segment.output_start)
+			segments.push_back(segment);
+	}
+
+	// indexes are used to name the segment files, keep them contiguous
+	for (size_t i = 0; i < segments.size(); i++)
+		segments[i].index = i;
+
+	return segments;
+}
+
+bool render_cluster::run_worker(
+	const std::string& bind_address, uint16_t port, const std::string& token, bool verbose
+) {
+	if (token.empty()) {
+		u::log("Workers need a token for coordinators to connect with, pass --token or set {}", TOKEN_ENV_VAR);
+		return false;
+	}
+
+	boost::system::error_code address_ec;
+	auto address = boost::asio::ip::make_address(bind_address, address_ec);
+	if (address_ec) {
+		u::log("Invalid bind address '{}': {}", bind_address, address_ec.message());
+		return false;
+	}
+
+	auto init_res = blur.initialise(verbose, false);
+	if (!init_res) {
+		u::log("Blur failed to initialise");
+		u::log("Reason: {}", init_res.error());
+		return false;
+	}
+
+	boost::asio::io_context io_context;
+	tcp::acceptor acceptor(io_context);
+
+	try {
+		tcp::endpoint endpoint(address, port);
+		acceptor.open(endpoint.protocol());
+
+		// :: takes ipv4 connections as well
+		if (address.is_v6() && address.is_unspecified())
+			acceptor.set_option(boost::asio::ip::v6_only(false));
+
+		acceptor.set_option(tcp::acceptor::reuse_address(true));
+		acceptor.bind(endpoint);
+		acceptor.listen();
+	}
+	catch (const boost::system::system_error& e) {
+		u::log("Failed to listen on {} port {}: {}", bind_address, port, e.what());
+		return false;
+	}
+
+	u::log("Worker listening on {} port {}", bind_address, port);
+
+	// one coordinator at a time, each segment already uses the whole machine
+	while (!blur.exiting) {
+		tcp::socket socket(io_context);
+		boost::system::error_code accept_ec = boost::asio::error::would_block;
+
+		acceptor.async_accept(socket, [&](const boost::system::error_code& ec) {
+			accept_ec = ec;
+		});
+
+		while (!blur.exiting && accept_ec == boost::asio::error::would_block) {
+			io_context.restart();
+			io_context.run_for(std::chrono::seconds(1));
+		}
+
+		if (accept_ec == boost::asio::error::would_block) {
+			acceptor.cancel();
+			io_context.restart();
+			io_context.run();
+			break;
+		}
+
+		if (accept_ec)
+			continue;
+
+		Connection connection(io_context, std::move(socket));
+		auto coordinator = connection.get_remote_address();
+
+		if (!accept_coordinator(connection, token)) {
+			u::log("Refused connection from {}", coordinator);
+			connection.close();
+			continue;
+		}
+
+		u::log("Coordinator {} connected", coordinator);
+
+		auto temp_path = blur.create_temp_path(std::format("worker_{}", port));
+		if (!temp_path) {
+			u::log("Failed to create a temp directory");
+			connection.close();
+			continue;
+		}
+
+		while (!blur.exiting) {
+			auto chunk_path = *temp_path / "chunk.mkv";
+
+			auto request = connection.receive(chunk_path, get_max_chunk_size(*temp_path));
+			if (!request) {
+				if (verbose)
+					u::log("Stopped reading from {}: {}", coordinator, request.error());
+
+				break; // coordinator went away (or is done with us)
+			}
+
+			// fields of the wrong type throw
+			try {
+				if (request->value("type", "") != "segment")
+					continue;
+
+				handle_segment(connection, *request, chunk_path, verbose);
+			}
+			catch (const nlohmann::json::exception& e) {
+				u::log("Received a malformed request from {}: {}", coordinator, e.what());
+				break;
+			}
+		}
+
+		connection.close();
+		Blur::remove_temp_path(*temp_path);
+
+		u::log("Coordinator {} disconnected", coordinator);
+	}
+
+	return true;
+}
+
+bool render_cluster::run_coordinator(
+	const std::filesystem::path& input,
+	const std::optional<std::filesystem::path>& output,
+	const std::optional<std::filesystem::path>& config,
+	const std::vector<std::string>& workers,
+	const std::string& token,
+	bool verbose
+) {
+	if (token.empty()) {
+		u::log("Workers need a token to accept segments, pass --token or set {}", TOKEN_ENV_VAR);
+		return false;
+	}
+
+	auto init_res = blur.initialise(verbose, false);
+	if (!init_res) {
+		u::log("Blur failed to initialise");
+		u::log("Reason: {}", init_res.error());
+		return false;
+	}
+
+	if (workers.empty()) {
+		u::log("No workers specified");
+		return false;
+	}
+
+	if (!std::filesystem::exists(input)) {
+		u::log("Video '{}' was not found (wrong path?)", input);
+		return false;
+	}
+
+	if (config && !std::filesystem::exists(*config)) {
+		u::log("Specified config file path '{}' not found.", *config);
+		return false;
+	}
+
+	auto input_path = std::filesystem::canonical(input);
+
+	auto video_info = u::get_video_info(input_path);
+	if (!video_info.has_video_stream || video_info.fps_num <= 0 || video_info.fps_den <= 0) {
+		u::log("Video '{}' is not a valid video or is unreadable", input_path);
+		return false;
+	}
+
+	if (output && !output->parent_path().empty() && !std::filesystem::exists(output->parent_path()))
+		std::filesystem::create_directories(output->parent_path());
+
+	Render render(input_path, video_info, output, config);
+
+	if (!render.get_settings().advanced.ffmpeg_override.empty()) {
+		u::log("Custom ffmpeg filters can't be used in distributed renders, workers refuse them");
+		return false;
+	}
+
+	auto output_frames = render.get_output_frame_count();
+	if (!output_frames) {
+		u::log(output_frames.error());
+		return false;
+	}
+
+	double fps = video_info.fps_num / static_cast<double>(video_info.fps_den);
+	int input_frames = video_info.get_frame_count();
+
+	int target_frames = std::max(
+		static_cast<int>(MIN_SEGMENT_SECONDS * fps),
+		static_cast<int>(std::ceil(input_frames / static_cast<double>(workers.size() * SEGMENTS_PER_WORKER)))
+	);
+	int context_frames = std::max(static_cast<int>(CONTEXT_SECONDS * fps), 1);
+
+	auto frame_gap = render_cluster::get_frame_gap(input_frames, *output_frames);
+	if (!frame_gap) {
+		u::log(
+			"'{}' can't be split up, {} input frames to {} output frames isn't a ratio segments can be joined at "
+			"without repeating or skipping frames",
+			input_path,
+			input_frames,
+			*output_frames
+		);
+		return false;
+	}
+
+	auto segments = render_cluster::plan_segments(
+		get_keyframes(input_path, video_info.fps_num, video_info.fps_den),
+		input_frames,
+		*output_frames,
+		target_frames,
+		context_frames,
+		*frame_gap
+	);
+	if (segments.empty()) {
+		u::log("Couldn't split '{}' into segments", input_path);
+		return false;
+	}
+
+	auto temp_path = blur.create_temp_path(
+		std::format("cluster_{}", std::hash<std::filesystem::path>()(render.get_output_video_path()))
+	);
+	if (!temp_path) {
+		u::log("Failed to create a temp directory");
+		return false;
+	}
+
+	u::log(
+		"Rendering '{}' as {} segment{} across {} worker{}",
+		render.get_video_name(),
+		segments.size(),
+		segments.size() != 1 ? "s" : "",
+		workers.size(),
+		workers.size() != 1 ? "s" : ""
+	);
+
+	auto config_string = config_blur::generate_config_string(render.get_settings(), false);
+
+	SegmentQueue queue(segments, workers.size());
+	std::atomic<int> frames_done = 0;
+	auto start_time = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (size_t worker = 0; worker < workers.size(); worker++) {
+		threads.emplace_back([&, worker] {
+			const auto& address = workers[worker];
+			auto [host, port] = split_address(address);
+
+			boost::asio::io_context io_context;
+			std::optional<Connection> connection;
+
+			while (auto segment = queue.take(worker)) {
+				if (!connection) {
+					connection.emplace(io_context);
+
+					auto connect_res = connection->connect(host, port).and_then([&] {
+						return authenticate(*connection, token);
+					});
+					if (!connect_res) {
+						u::log("Couldn't connect to worker {}: {}", address, connect_res.error());
+						queue.retry(segment->index, connect_res.error());
+						queue.remove_worker();
+						return;
+					}
+				}
+
+				if (verbose)
+					u::log("Sending segment {} to {}", segment->index, address);
+
+				bool connection_lost = false;
+				auto res = render_segment_on(
+					*connection, *segment, input_path, *temp_path, config_string, video_info, connection_lost
+				);
+
+				if (!res) {
+					u::log("Segment {} failed on {}: {}", segment->index, address, res.error());
+					queue.retry(segment->index, res.error());
+
+					if (connection_lost) {
+						u::log("Lost worker {}", address);
+						queue.remove_worker();
+						return;
+					}
+
+					continue;
+				}
+
+				queue.finish(segment->index);
+
+				frames_done += segment->output_end - segment->output_start;
+
+				std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start_time;
+				float render_fps = elapsed.count() > 0 ? frames_done / elapsed.count() : 0.f;
+
+				if (event_sink.is_enabled())
+					event_sink.emit_progress(render.get_render_id(), frames_done, *output_frames, render_fps);
+				else
+					u::log(
+						"Segment {} done by {} ({}/{} frames, {:.2f} fps)",
+						segment->index,
+						address,
+						frames_done.load(),
+						*output_frames,
+						render_fps
+					);
+			}
+
+			if (connection)
+				connection->close();
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	bool success = false;
+
+	if (auto error = queue.get_error()) {
+		u::log("Distributed render failed: {}", *error);
+	}
+	else {
+		auto join_res = join_segments(render, segments.size(), *temp_path);
+		if (!join_res) {
+			u::log("Failed to join segments: {}", join_res.error());
+		}
+		else {
+			std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start_time;
+			u::log("Finished rendering '{}' in {:.2f}s", render.get_video_name(), elapsed.count());
+			success = true;
+		}
+	}
+
+	Blur::remove_temp_path(*temp_path);
+
+	return success;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// spreads one render over several machines. the coordinator cuts the input into segments on keyframes, sends each
+// worker a stream copy of its segment (plus a bit of context either side so temporal filters see the same frames
+// they would in a full render) along with the settings, and joins the encoded segments back together with the
+// original audio. segments that fail are retried on a different worker.
+//
+// workers render whatever config they're sent, so they only listen on loopback unless told otherwise and every
+// connection has to start by proving it knows the shared token. configs with custom ffmpeg arguments are refused.
+//
+// messages are a line of json, optionally followed by `size` bytes of file data:
+//
+//   -> { "type": "hello", "token": "..." }
+//   <- { "type": "welcome" }   (or failed, and the connection is closed)
+//   -> { "type": "segment", "id": 3, "version": "...", "config": "...", "fps_num": 60, "fps_den": 1,
+//        "output_start": 12, "output_frames": 600, "size": ... } + input chunk
+//   <- { "type": "progress", "id": 3, "frame": 100, "total": 600 }   (at least every few seconds while rendering)
+//   <- { "type": "done", "id": 3, "frames": 600, "size": ... } + encoded segment
+//   <- { "type": "failed", "id": 3, "error": "..." }
+namespace render_cluster {
+	const uint16_t DEFAULT_PORT = 47610;
+	const std::string DEFAULT_BIND_ADDRESS = "127.0.0.1";
+
+	// read when no token is passed on the command line, so it doesn't have to show up in process lists
+	const std::string TOKEN_ENV_VAR = "BLUR_CLUSTER_TOKEN";
+
+	// renders segments for coordinators until interrupted. bind to 0.0.0.0 or :: to take them from other machines
+	bool run_worker(const std::string& bind_address, uint16_t port, const std::string& token, bool verbose);
+
+	// workers are "host:port" (or just "host" for the default port)
+	bool run_coordinator(
+		const std::filesystem::path& input,
+		const std::optional<std::filesystem::path>& output,
+		const std::optional<std::filesystem::path>& config,
+		const std::vector<std::string>& workers,
+		const std::string& token,
+		bool verbose
+	);
+
+	struct Keyframe {
+		int frame;
+		double time; // seconds from the start of the video
+	};
+
+	struct Segment {
+		size_t index;
+
+		// input frames this segment is responsible for, [start, end)
+		int start;
+		int end;
+
+		// input frames sent to the worker, includes context. cut on keyframes so it can be stream copied
+		int chunk_start;
+		int chunk_end;
+		double chunk_start_time;
+		std::optional<double> chunk_end_time; // to the end of the video if empty
+
+		// output frames this segment produces, [start, end)
+		int output_start;
+		int output_end;
+
+		// output frames the chunk's context produces before the segment's own frames start
+		int output_skip;
+	};
+
+	// smallest number of input frames that always makes a whole number of output frames (12 for 144 -> 60 fps). a
+	// chunk has to start on a multiple of it or its output frames are sampled at a different phase to a single
+	// pass render, and segments repeat or skip a frame where they're joined. empty if the rates aren't a simple ratio
+	std::optional<int> get_frame_gap(int input_frames, int output_frames);
+
+	// output frames are mapped to input frames linearly, which holds for everything blur does to the frame rate.
+	// chunks only start on keyframes that are a multiple of frame_gap
+	std::vector<Segment> plan_segments(
+		const std::vector<Keyframe>& keyframes,
+		int input_frames,
+		int output_frames,
+		int target_frames,
+		int context_frames,
+		int frame_gap = 1
+	);
+}
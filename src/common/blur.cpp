@@ -229,5 +229,8 @@ void Blur::setup_signal_handlers() {
 	std::signal(SIGTERM, cleanup_handler);
 #ifndef _WIN32
 	std::signal(SIGHUP, cleanup_handler);
+
+	// writing to a child that's gone should just fail, not take us down with it
+	std::signal(SIGPIPE, SIG_IGN);
 #endif
 }
@@ -23,6 +23,8 @@
 #include <ranges>
 #include <cfloat>
 #include <csignal>
+#include <deque>
+#include <condition_variable>
 
 // libs
 #include <nlohmann/json.hpp>
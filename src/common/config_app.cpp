@@ -30,6 +30,23 @@ void config_app::create(const std::filesystem::path& filepath, const GlobalAppSe
 	output << "- misc" << "\n";
 	output << "notify about config overrides: " << (settings.notify_about_config_override ? "true" : "false") << "\n";
 
+	output << "\n";
+	output << "- performance" << "\n";
+	output << "balance cpu between vapoursynth and ffmpeg: " << (settings.balance_render_cpu ? "true" : "false")
+		   << "\n";
+	output << "background rendering: " << (settings.background_rendering ? "true" : "false") << "\n";
+	output << "background throttle load threshold: " << settings.background_load_threshold << "\n";
+
+	output << "\n";
+	output << "- interpolation cache" << "\n";
+	output << "interpolation cache: " << (settings.interpolation_cache ? "true" : "false") << "\n";
+	output << "interpolation cache size (gb): " << settings.interpolation_cache_size << "\n";
+
+	output << "\n";
+	output << "- watch folder" << "\n";
+	output << "watch folder enabled: " << (settings.watch_folder_enabled ? "true" : "false") << "\n";
+	output << "watch folder: " << settings.watch_folder << "\n";
+
 #ifdef __linux__
 	output << "\n";
 	output << "- linux" << "\n";
@@ -63,6 +80,22 @@ GlobalAppSettings config_app::parse(const std::filesystem::path& config_filepath
 		config_map, "notify about config overrides", settings.notify_about_config_override
 	);
 
+	config_base::extract_config_value(
+		config_map, "balance cpu between vapoursynth and ffmpeg", settings.balance_render_cpu
+	);
+	config_base::extract_config_value(config_map, "background rendering", settings.background_rendering);
+	config_base::extract_config_value(
+		config_map, "background throttle load threshold", settings.background_load_threshold
+	);
+
+	config_base::extract_config_value(config_map, "interpolation cache", settings.interpolation_cache);
+	config_base::extract_config_value(
+		config_map, "interpolation cache size (gb)", settings.interpolation_cache_size
+	);
+
+	config_base::extract_config_value(config_map, "watch folder enabled", settings.watch_folder_enabled);
+	config_base::extract_config_string(config_map, "watch folder", settings.watch_folder);
+
 #ifdef __linux__
 	config_base::extract_config_value(config_map, "vapoursynth lib path", settings.vapoursynth_lib_path);
 #endif
@@ -16,6 +16,20 @@ struct GlobalAppSettings {
 
 	bool notify_about_config_override = true;
 
+	bool balance_render_cpu = true;
+	bool background_rendering = false;
+	float background_load_threshold = 0.5f; // foreground cpu use (0-1) above which background renders get throttled
+
+	bool interpolation_cache = false;
+	float interpolation_cache_size = 20.f; // gb
+
+	[[nodiscard]] uint64_t get_interpolation_cache_bytes() const {
+		return static_cast<uint64_t>(std::max(0.f, interpolation_cache_size) * 1024.f * 1024.f * 1024.f);
+	}
+
+	bool watch_folder_enabled = false;
+	std::string watch_folder;
+
 #ifdef __linux__
 	std::string vapoursynth_lib_path;
 #endif
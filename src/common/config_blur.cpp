@@ -27,6 +27,9 @@ std::string config_blur::generate_config_string(const BlurSettings& settings, bo
 		if (!concise || settings.interpolate) {
 			output << "interpolated fps: " << settings.interpolated_fps << "\n";
 			output << "interpolation method: " << settings.interpolation_method << "\n";
+			if (!concise || settings.adaptive_interpolation) {
+				output << "adaptive interpolation: " << (settings.adaptive_interpolation ? "true" : "false") << "\n";
+			}
 		}
 	}
 
@@ -55,6 +58,12 @@ std::string config_blur::generate_config_string(const BlurSettings& settings, bo
 	output << "- rendering" << "\n";
 	output << "encode preset: " << settings.encode_preset << "\n";
 	output << "quality: " << settings.quality << "\n";
+	if (!concise || settings.output_resolution != DEFAULT_CONFIG.output_resolution) {
+		output << "output resolution: " << settings.output_resolution << "\n";
+	}
+	if (!concise || !settings.renditions.empty()) {
+		output << "renditions: " << settings.renditions << "\n";
+	}
 	if (!concise || settings.preview) {
 		output << "preview: " << (settings.preview ? "true" : "false") << "\n";
 	}
@@ -122,6 +131,13 @@ std::string config_blur::generate_config_string(const BlurSettings& settings, bo
 			if (!concise || settings.advanced.debug) {
 				output << "debug: " << (settings.advanced.debug ? "true" : "false") << "\n";
 			}
+			if (!concise || settings.advanced.half_precision) {
+				output << "half precision: " << (settings.advanced.half_precision ? "true" : "false") << "\n";
+			}
+			if (!concise || settings.advanced.skip_static_regions) {
+				output << "skip static regions: " << (settings.advanced.skip_static_regions ? "true" : "false")
+				       << "\n";
+			}
 
 			output << "\n";
 			output << "- advanced blur" << "\n";
@@ -135,6 +151,8 @@ std::string config_blur::generate_config_string(const BlurSettings& settings, bo
 			output << "svp interpolation algorithm: " << settings.advanced.svp_interpolation_algorithm << "\n";
 			output << "interpolation block size: " << settings.advanced.interpolation_blocksize << "\n";
 			output << "interpolation mask area: " << settings.advanced.interpolation_mask_area << "\n";
+			output << "adaptive interpolation threshold: " << settings.advanced.adaptive_interpolation_threshold
+				   << "\n";
 			output << "rife model: " << settings.advanced.rife_model << "\n";
 
 			if (!concise || settings.advanced.manual_svp) {
@@ -200,12 +218,143 @@ tl::expected<void, std::string> config_blur::validate(BlurSettings& config, bool
 			config.advanced.interpolation_blocksize = DEFAULT_CONFIG.advanced.interpolation_blocksize;
 	}
 
+	if (!parse_size(config.output_resolution)) {
+		errors.insert(
+			std::format("Output resolution ({}) should be like 720p, 1280x720 or source", config.output_resolution)
+		);
+
+		if (fix)
+			config.output_resolution = DEFAULT_CONFIG.output_resolution;
+	}
+
+	if (auto renditions = parse_renditions(config); !renditions) {
+		errors.insert(renditions.error());
+
+		if (fix)
+			config.renditions = DEFAULT_CONFIG.renditions;
+	}
+
 	if (!errors.empty())
 		return tl::unexpected(u::join(errors, " "));
 
 	return {};
 }
 
+BlurSettings config_blur::get_source_pass_settings(BlurSettings settings) {
+	settings.blur = DEFAULT_CONFIG.blur;
+	settings.blur_amount = DEFAULT_CONFIG.blur_amount;
+	settings.blur_output_fps = DEFAULT_CONFIG.blur_output_fps;
+	settings.blur_weighting = DEFAULT_CONFIG.blur_weighting;
+	settings.blur_gamma = DEFAULT_CONFIG.blur_gamma;
+	settings.filters = DEFAULT_CONFIG.filters;
+	settings.brightness = DEFAULT_CONFIG.brightness;
+	settings.saturation = DEFAULT_CONFIG.saturation;
+	settings.contrast = DEFAULT_CONFIG.contrast;
+	settings.encode_preset = DEFAULT_CONFIG.encode_preset;
+	settings.quality = DEFAULT_CONFIG.quality;
+	settings.renditions = DEFAULT_CONFIG.renditions;
+	settings.gpu_encoding = DEFAULT_CONFIG.gpu_encoding;
+	settings.preview = DEFAULT_CONFIG.preview;
+	settings.detailed_filenames = DEFAULT_CONFIG.detailed_filenames;
+	settings.copy_dates = DEFAULT_CONFIG.copy_dates;
+	settings.advanced.video_container = DEFAULT_CONFIG.advanced.video_container;
+	settings.advanced.ffmpeg_override = DEFAULT_CONFIG.advanced.ffmpeg_override;
+	settings.advanced.debug = DEFAULT_CONFIG.advanced.debug;
+	settings.advanced.blur_weighting_gaussian_std_dev = DEFAULT_CONFIG.advanced.blur_weighting_gaussian_std_dev;
+	settings.advanced.blur_weighting_gaussian_mean = DEFAULT_CONFIG.advanced.blur_weighting_gaussian_mean;
+	settings.advanced.blur_weighting_gaussian_bound = DEFAULT_CONFIG.advanced.blur_weighting_gaussian_bound;
+
+	return settings;
+}
+
+std::string OutputRendition::get_label() const {
+	std::string size = "source";
+	if (width > 0)
+		size = std::format("{}x{}", width, height);
+	else if (height > 0)
+		size = std::format("{}p", height);
+
+	return std::format("{} {}", size, encode_preset);
+}
+
+std::optional<std::pair<int, int>> config_blur::parse_size(const std::string& size) {
+	static std::regex size_regex(R"((\d+)x(\d+)|(\d+)p|source)");
+
+	std::smatch match;
+	if (!std::regex_match(size, match, size_regex))
+		return {};
+
+	if (match[1].matched)
+		return std::pair{ std::stoi(match[1]), std::stoi(match[2]) };
+
+	if (match[3].matched)
+		return std::pair{ 0, std::stoi(match[3]) };
+
+	return std::pair{ 0, 0 };
+}
+
+std::pair<int, int> config_blur::get_working_size(const BlurSettings& settings, int width, int height) {
+	auto size = parse_size(settings.output_resolution);
+	if (!size || size->second <= 0 || height <= 0)
+		return { width, height };
+
+	// even like ffmpeg's -2, same as formats.resize in blur.py
+	int output_width = size->first;
+	if (output_width <= 0)
+		output_width = static_cast<int>(std::round(width * size->second / static_cast<double>(height) / 2)) * 2;
+
+	return { output_width, size->second };
+}
+
+tl::expected<std::vector<OutputRendition>, std::string> config_blur::parse_renditions(const BlurSettings& settings) {
+	std::vector<OutputRendition> renditions;
+
+	for (auto entry : u::split_string(settings.renditions, ",")) {
+		entry = u::trim(entry);
+		if (entry.empty())
+			continue;
+
+		std::vector<std::string> parts;
+		std::istringstream stream(entry);
+		for (std::string part; stream >> part;)
+			parts.push_back(part);
+
+		OutputRendition rendition{
+			.encode_preset = settings.encode_preset.empty() ? "h264" : u::to_lower(settings.encode_preset),
+			.quality = settings.quality,
+			.container = settings.advanced.video_container,
+		};
+
+		auto size = parse_size(parts[0]);
+		if (!size)
+			return tl::unexpected(std::format("Rendition size ({}) should be like 720p, 1280x720 or source", parts[0]));
+
+		std::tie(rendition.width, rendition.height) = *size;
+
+		if (parts.size() > 1)
+			rendition.encode_preset = u::to_lower(parts[1]);
+
+		if (parts.size() > 2) {
+			try {
+				rendition.quality = std::stoi(parts[2]);
+			}
+			catch (...) {
+				return tl::unexpected(std::format("Rendition quality ({}) isn't a number", parts[2]));
+			}
+		}
+
+		if (parts.size() > 3)
+			rendition.container = parts[3];
+
+		if (parts.size() > 4)
+			return tl::unexpected(std::format("Rendition '{}' has too many parts", entry));
+
+		renditions.push_back(std::move(rendition));
+	}
+
+	return renditions;
+}
+
 BlurSettings config_blur::parse(const std::string& config_content) {
 	std::istringstream stream(config_content);
 	auto config_map = config_base::read_config_map(stream);
@@ -233,6 +382,8 @@ BlurSettings config_blur::parse_from_map(
 	config_base::extract_config_string(config_map, "interpolated fps", settings.interpolated_fps);
 	config_base::extract_config_string(config_map, "interpolation method", settings.interpolation_method);
 
+	config_base::extract_config_value(config_map, "adaptive interpolation", settings.adaptive_interpolation);
+
 	config_base::extract_config_value(config_map, "pre-interpolate", settings.pre_interpolate);
 	config_base::extract_config_string(config_map, "pre-interpolated fps", settings.pre_interpolated_fps);
 
@@ -241,6 +392,8 @@ BlurSettings config_blur::parse_from_map(
 
 	config_base::extract_config_value(config_map, "encode preset", settings.encode_preset);
 	config_base::extract_config_value(config_map, "quality", settings.quality);
+	config_base::extract_config_string(config_map, "output resolution", settings.output_resolution);
+	config_base::extract_config_string(config_map, "renditions", settings.renditions);
 	config_base::extract_config_value(config_map, "preview", settings.preview);
 	config_base::extract_config_value(config_map, "detailed filenames", settings.detailed_filenames);
 	config_base::extract_config_value(config_map, "copy dates", settings.copy_dates);
@@ -272,6 +425,8 @@ BlurSettings config_blur::parse_from_map(
 		config_base::extract_config_value(config_map, "video container", settings.advanced.video_container);
 		config_base::extract_config_string(config_map, "custom ffmpeg filters", settings.advanced.ffmpeg_override);
 		config_base::extract_config_value(config_map, "debug", settings.advanced.debug);
+		config_base::extract_config_value(config_map, "half precision", settings.advanced.half_precision);
+		config_base::extract_config_value(config_map, "skip static regions", settings.advanced.skip_static_regions);
 
 		config_base::extract_config_value(
 			config_map, "blur weighting gaussian std dev", settings.advanced.blur_weighting_gaussian_std_dev
@@ -295,6 +450,9 @@ BlurSettings config_blur::parse_from_map(
 		config_base::extract_config_value(
 			config_map, "interpolation mask area", settings.advanced.interpolation_mask_area
 		);
+		config_base::extract_config_string(
+			config_map, "adaptive interpolation threshold", settings.advanced.adaptive_interpolation_threshold
+		);
 		config_base::extract_config_string(config_map, "rife model", settings.advanced.rife_model);
 		config_base::extract_config_value(config_map, "manual svp", settings.advanced.manual_svp);
 		config_base::extract_config_string(config_map, "super string", settings.advanced.super_string);
@@ -374,6 +532,8 @@ tl::expected<nlohmann::json, std::string> BlurSettings::to_json() const {
 	j["interpolated_fps"] = this->interpolated_fps;
 	j["interpolation_method"] = this->interpolation_method;
 
+	j["adaptive_interpolation"] = this->adaptive_interpolation;
+
 	j["pre_interpolate"] = this->pre_interpolate;
 	j["pre_interpolated_fps"] = this->pre_interpolated_fps;
 
@@ -393,6 +553,12 @@ tl::expected<nlohmann::json, std::string> BlurSettings::to_json() const {
 	j["encode preset"] = this->encode_preset;
 	j["quality"] = this->quality;
 	j["preview"] = this->preview;
+
+	// blur.py works the width out from the source when it's 0
+	auto [output_width, output_height] = config_blur::parse_size(this->output_resolution).value_or(std::pair{ 0, 0 });
+	j["output_width"] = output_width;
+	j["output_height"] = output_height;
+
 	j["detailed_filenames"] = this->detailed_filenames;
 	// j["copy_dates"] = this->copy_dates;
 
@@ -412,6 +578,8 @@ tl::expected<nlohmann::json, std::string> BlurSettings::to_json() const {
 	// j["video_container"] = this->advanced.video_container;
 	// j["ffmpeg_override"] = this->advanced.ffmpeg_override;
 	j["debug"] = this->advanced.debug;
+	j["half_precision"] = this->advanced.half_precision;
+	j["skip_static_regions"] = this->advanced.skip_static_regions;
 
 	j["blur_weighting_gaussian_std_dev"] = this->advanced.blur_weighting_gaussian_std_dev;
 	j["blur_weighting_gaussian_mean"] = this->advanced.blur_weighting_gaussian_mean;
@@ -421,6 +589,7 @@ tl::expected<nlohmann::json, std::string> BlurSettings::to_json() const {
 	j["svp_interpolation_algorithm"] = this->advanced.svp_interpolation_algorithm;
 	j["interpolation_blocksize"] = this->advanced.interpolation_blocksize;
 	j["interpolation_mask_area"] = this->advanced.interpolation_mask_area;
+	j["adaptive_interpolation_threshold"] = this->advanced.adaptive_interpolation_threshold;
 
 	auto rife_model_path = get_rife_model_path();
 	if (!rife_model_path)
@@ -6,6 +6,8 @@ struct AdvancedSettings {
 	std::string deduplicate_threshold = "0.001";
 	std::string ffmpeg_override;
 	bool debug = false;
+	bool half_precision = false;
+	bool skip_static_regions = false; // parts of the frame that never change are copied instead of processed
 
 	float blur_weighting_gaussian_std_dev = 1.f;
 	float blur_weighting_gaussian_mean = 2.f;
@@ -15,6 +17,7 @@ struct AdvancedSettings {
 	std::string svp_interpolation_algorithm = "13";
 	std::string interpolation_blocksize = "8";
 	int interpolation_mask_area = 0;
+	std::string adaptive_interpolation_threshold = "0.01"; // frame difference at which interpolation is at full rate
 	std::string rife_model = "rife-v4.26_ensembleFalse";
 
 	bool manual_svp = false;
@@ -25,6 +28,19 @@ struct AdvancedSettings {
 	bool operator==(const AdvancedSettings& other) const = default;
 };
 
+// another encode of the output at its own size, preset, quality and container
+struct OutputRendition {
+	// 0 keeps the output size. height alone keeps the aspect ratio
+	int width = 0;
+	int height = 0;
+
+	std::string encode_preset;
+	int quality = 0;
+	std::string container;
+
+	[[nodiscard]] std::string get_label() const;
+};
+
 struct BlurSettings {
 	bool blur = true;
 	float blur_amount = 1.f;
@@ -41,6 +57,8 @@ struct BlurSettings {
 	std::string interpolation_method = "svp";
 #endif
 
+	bool adaptive_interpolation = false; // fewer interpolated frames where there's little motion
+
 	bool pre_interpolate = false;
 	std::string pre_interpolated_fps = "360";
 
@@ -56,6 +74,8 @@ struct BlurSettings {
 
 	std::string encode_preset = "h264";
 	int quality = 16;
+	std::string renditions; // extra encodes of the output, see config_blur::parse_renditions
+	std::string output_resolution = "source"; // frames are scaled to this before anything else, see parse_size
 
 	bool deduplicate = true;
 #ifdef __APPLE__
@@ -110,6 +130,20 @@ namespace config_blur {
 
 	tl::expected<void, std::string> validate(BlurSettings& config, bool fix);
 
+	// settings with everything from the blur on reset to defaults. what's left decides the decoded, deduplicated and
+	// interpolated frames, so renders with equal ones can share them
+	BlurSettings get_source_pass_settings(BlurSettings settings);
+
+	// 720p, 1280x720 or source as (width, height). (0, 0) for source, width is 0 when only the height is given
+	std::optional<std::pair<int, int>> parse_size(const std::string& size);
+
+	// size the frames are processed and output at for a width x height source
+	std::pair<int, int> get_working_size(const BlurSettings& settings, int width, int height);
+
+	// comma separated, each "<size> [preset] [quality] [container]" with the size as 720p, 1280x720 or source. anything
+	// left out comes from the main output's settings, e.g. "1080p, 720p h265 24 mkv"
+	tl::expected<std::vector<OutputRendition>, std::string> parse_renditions(const BlurSettings& settings);
+
 	BlurSettings parse(const std::string& config_content);
 	BlurSettings parse(const std::filesystem::path& config_filepath);
 	BlurSettings parse_from_map(
@@ -0,0 +1,188 @@
+#include "cpu_balancer.h"
+#include "processes.h"
+
+bool CpuBalancer::can_rebalance() {
+#ifdef __linux__
+	return processes::get_core_count() > 1;
+#else
+	return false;
+#endif
+}
+
+CpuBalancer::Split CpuBalancer::get_initial_split(bool gpu_encoding) {
+	int cores = processes::get_core_count();
+	if (cores == 1)
+		return { .producer_cores = 1, .encoder_cores = 1 }; // nothing to split, they'll have to share
+
+	// interpolating and blending is almost always the expensive side, cpu encoding at veryfast rarely needs more
+	// than a quarter of the machine. gpu encoding barely touches the cpu at all
+	int encoder_cores = std::max(1, gpu_encoding ? cores / 8 : cores / 4);
+
+	return {
+		.producer_cores = cores - encoder_cores,
+		.encoder_cores = encoder_cores,
+	};
+}
+
+CpuBalancer::ThreadCounts CpuBalancer::get_thread_counts(bool gpu_encoding, bool rebalancing) {
+	if (rebalancing) {
+		// affinity decides who gets which cores, so let both sides spin up enough threads to fill whatever they're
+		// given (each side always leaves at least one core for the other)
+		int max_cores = std::max(1, processes::get_core_count() - 1);
+		return { .vapoursynth = max_cores, .ffmpeg = max_cores };
+	}
+
+	auto split = get_initial_split(gpu_encoding);
+	return { .vapoursynth = split.producer_cores, .ffmpeg = split.encoder_cores };
+}
+
+CpuBalancer::CpuBalancer(bool gpu_encoding, bool rebalancing)
+	: m_split(get_initial_split(gpu_encoding)), m_cores(processes::get_allowed_cores()),
+	  m_core_count(static_cast<int>(m_cores.size())), m_rebalancing(rebalancing && can_rebalance()) {}
+
+void CpuBalancer::attach(int vspipe_pid, int ffmpeg_pid, int pipe_fd) {
+	m_vspipe_pid = vspipe_pid;
+	m_ffmpeg_pid = ffmpeg_pid;
+	m_pipe_fd = pipe_fd;
+	m_pipe_capacity = processes::get_pipe_capacity(pipe_fd);
+
+	m_last_update = std::chrono::steady_clock::now();
+	start_window();
+
+	if (m_rebalancing)
+		apply_split();
+}
+
+void CpuBalancer::start_window() {
+	m_window_start = std::chrono::steady_clock::now();
+	m_fill_ratio_sum = 0.0;
+	m_fill_samples = 0;
+	m_window_vspipe_cpu = processes::get_cpu_time(m_vspipe_pid);
+	m_window_ffmpeg_cpu = processes::get_cpu_time(m_ffmpeg_pid);
+}
+
+void CpuBalancer::update(bool paused) {
+	if (m_vspipe_pid <= 0 || m_ffmpeg_pid <= 0)
+		return;
+
+	// cpu use while suspended says nothing about where the bottleneck is, and the time shouldn't count towards
+	// any state. start fresh once it's running again
+	if (paused) {
+		m_paused = true;
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+
+	if (m_paused) {
+		m_paused = false;
+		m_last_update = now;
+		start_window();
+		return;
+	}
+
+	// attribute time since the last update to whatever state we were last in
+	auto since_last = now - m_last_update;
+	m_last_update = now;
+
+	switch (m_bottleneck) {
+		case Bottleneck::PRODUCER:
+			m_producer_bound_time += since_last;
+			break;
+		case Bottleneck::ENCODER:
+			m_encoder_bound_time += since_last;
+			break;
+		case Bottleneck::NONE:
+			m_balanced_time += since_last;
+			break;
+	}
+
+	if (m_pipe_capacity) {
+		if (auto fill = processes::get_pipe_fill(m_pipe_fd)) {
+			m_fill_ratio_sum += std::min(1.0, static_cast<double>(*fill) / *m_pipe_capacity);
+			m_fill_samples++;
+		}
+	}
+
+	if (now - m_window_start >= REBALANCE_INTERVAL) {
+		rebalance();
+		start_window();
+	}
+}
+
+void CpuBalancer::rebalance() {
+	if (m_fill_samples == 0)
+		return;
+
+	std::chrono::duration<double> window = std::chrono::steady_clock::now() - m_window_start;
+
+	auto vspipe_cpu = processes::get_cpu_time(m_vspipe_pid);
+	auto ffmpeg_cpu = processes::get_cpu_time(m_ffmpeg_pid);
+	if (!vspipe_cpu || !ffmpeg_cpu || !m_window_vspipe_cpu || !m_window_ffmpeg_cpu)
+		return;
+
+	// cores' worth of cpu each side used over the window
+	double vspipe_usage = (*vspipe_cpu - *m_window_vspipe_cpu) / window.count();
+	double ffmpeg_usage = (*ffmpeg_cpu - *m_window_ffmpeg_cpu) / window.count();
+
+	double fill_ratio = m_fill_ratio_sum / m_fill_samples;
+
+	// full pipe = vspipe is waiting on ffmpeg, empty pipe = ffmpeg is waiting on vspipe. only count a side as the
+	// bottleneck if it's actually saturating its cores, otherwise it's waiting on something else (gpu, disk)
+	m_bottleneck = Bottleneck::NONE;
+	if (fill_ratio >= FULL_PIPE_RATIO && ffmpeg_usage >= m_split.encoder_cores * BUSY_CORE_RATIO)
+		m_bottleneck = Bottleneck::ENCODER;
+	else if (fill_ratio <= EMPTY_PIPE_RATIO && vspipe_usage >= m_split.producer_cores * BUSY_CORE_RATIO)
+		m_bottleneck = Bottleneck::PRODUCER;
+
+	if (!m_rebalancing || m_core_count < 2)
+		return;
+
+	Split old_split = m_split;
+
+	if (m_bottleneck == Bottleneck::ENCODER && m_split.producer_cores > 1) {
+		m_split.producer_cores--;
+		m_split.encoder_cores++;
+	}
+	else if (m_bottleneck == Bottleneck::PRODUCER && m_split.encoder_cores > 1) {
+		m_split.producer_cores++;
+		m_split.encoder_cores--;
+	}
+
+	if (m_split.producer_cores == old_split.producer_cores)
+		return;
+
+	DEBUG_LOG(
+		"cpu balancer: pipe {:.0f}% full, vspipe using {:.1f} cores, ffmpeg using {:.1f} cores -> {}/{} split",
+		fill_ratio * 100,
+		vspipe_usage,
+		ffmpeg_usage,
+		m_split.producer_cores,
+		m_split.encoder_cores
+	);
+
+	apply_split();
+}
+
+void CpuBalancer::apply_split() {
+	// the split is over the cores we're allowed, which aren't necessarily 0..n under a cpuset or taskset
+	auto producer_end = m_cores.begin() + std::min(m_split.producer_cores, m_core_count);
+	std::vector<int> producer_cores(m_cores.begin(), producer_end);
+	std::vector<int> encoder_cores(producer_end, m_cores.end());
+
+	processes::set_affinity(m_vspipe_pid, producer_cores);
+	processes::set_affinity(m_ffmpeg_pid, encoder_cores);
+}
+
+std::string CpuBalancer::get_summary() const {
+	return std::format(
+		"cpu split: vapoursynth {} cores, ffmpeg {} cores{} (vapoursynth-bound {:.1f}s, ffmpeg-bound {:.1f}s, "
+		"balanced {:.1f}s)",
+		m_split.producer_cores,
+		m_split.encoder_cores,
+		m_rebalancing ? "" : " (fixed)",
+		m_producer_bound_time.count(),
+		m_encoder_bound_time.count(),
+		m_balanced_time.count()
+	);
+}
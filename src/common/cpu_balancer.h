@@ -0,0 +1,72 @@
+#pragma once
+
+// splits cpu cores between vspipe (frame producer) and ffmpeg (encoder). on linux the split is enforced with
+// affinity masks and shifted at runtime towards whichever side is holding the render back, judged by how full
+// the pipe between them is and how much cpu each side is actually using
+class CpuBalancer {
+public:
+	struct Split {
+		int producer_cores;
+		int encoder_cores;
+	};
+
+	struct ThreadCounts {
+		int vapoursynth;
+		int ffmpeg;
+	};
+
+	static bool can_rebalance();
+
+	static Split get_initial_split(bool gpu_encoding);
+	static ThreadCounts get_thread_counts(bool gpu_encoding, bool rebalancing);
+
+	CpuBalancer(bool gpu_encoding, bool rebalancing);
+
+	void attach(int vspipe_pid, int ffmpeg_pid, int pipe_fd);
+	void update(bool paused);
+
+	[[nodiscard]] Split get_split() const {
+		return m_split;
+	}
+
+	[[nodiscard]] std::string get_summary() const;
+
+private:
+	enum class Bottleneck : uint8_t {
+		NONE,
+		PRODUCER,
+		ENCODER,
+	};
+
+	static constexpr auto REBALANCE_INTERVAL = std::chrono::seconds(2);
+	static constexpr float FULL_PIPE_RATIO = 0.75f;
+	static constexpr float EMPTY_PIPE_RATIO = 0.25f;
+	static constexpr float BUSY_CORE_RATIO = 0.8f; // side has to be using this much of its cores to count as bound
+
+	Split m_split;
+	std::vector<int> m_cores; // the ones we're allowed to use, split in order
+	int m_core_count;
+	bool m_rebalancing;
+
+	int m_vspipe_pid = -1;
+	int m_ffmpeg_pid = -1;
+	int m_pipe_fd = -1;
+	std::optional<int> m_pipe_capacity;
+
+	std::chrono::steady_clock::time_point m_window_start;
+	double m_fill_ratio_sum = 0.0;
+	int m_fill_samples = 0;
+	std::optional<double> m_window_vspipe_cpu;
+	std::optional<double> m_window_ffmpeg_cpu;
+
+	Bottleneck m_bottleneck = Bottleneck::NONE;
+	bool m_paused = false;
+	std::chrono::steady_clock::time_point m_last_update;
+	std::chrono::duration<double> m_producer_bound_time{};
+	std::chrono::duration<double> m_encoder_bound_time{};
+	std::chrono::duration<double> m_balanced_time{};
+
+	void start_window();
+	void rebalance();
+	void apply_split();
+};
@@ -0,0 +1,195 @@
+#include "event_sink.h"
+
+#ifdef _WIN32
+#	include <io.h>
+#else
+#	include <unistd.h>
+#endif
+
+EventSink::~EventSink() {
+	close();
+}
+
+tl::expected<void, std::string> EventSink::open(
+	const std::string& target, std::chrono::milliseconds progress_interval
+) {
+	close();
+
+	if (target == "-" || target == "stdout") {
+		m_file = stdout;
+		m_owns_file = false;
+	}
+	else if (target.starts_with("fd:")) {
+		int fd = -1;
+		try {
+			fd = std::stoi(target.substr(3));
+		}
+		catch (const std::exception&) {
+			return tl::unexpected(std::format("Invalid file descriptor '{}'", target));
+		}
+
+		// dup so closing our end doesn't close the caller's
+#ifdef _WIN32
+		int dup_fd = _dup(fd);
+		m_file = dup_fd != -1 ? _fdopen(dup_fd, "w") : nullptr;
+#else
+		int dup_fd = dup(fd);
+		m_file = dup_fd != -1 ? fdopen(dup_fd, "w") : nullptr;
+#endif
+		if (!m_file)
+			return tl::unexpected(std::format("Failed to open file descriptor {}", fd));
+
+		m_owns_file = true;
+	}
+	else {
+#ifdef _WIN32
+		m_file = _wfopen(u::towstring(target).c_str(), L"w");
+#else
+		m_file = std::fopen(target.c_str(), "w");
+#endif
+		if (!m_file)
+			return tl::unexpected(std::format("Failed to open '{}' for writing", target));
+
+		m_owns_file = true;
+	}
+
+	start(progress_interval);
+
+	return {};
+}
+
+void EventSink::open(
+	std::function<void(const std::string& line)> listener, std::chrono::milliseconds progress_interval
+) {
+	close();
+
+	m_listener = std::move(listener);
+
+	start(progress_interval);
+}
+
+void EventSink::start(std::chrono::milliseconds progress_interval) {
+	m_progress_interval = progress_interval;
+	m_last_progress = {};
+	m_last_progress_render_id = 0;
+	m_stopping = false;
+
+	m_thread = std::thread(&EventSink::run, this);
+	m_enabled = true;
+}
+
+void EventSink::close() {
+	if (!m_enabled)
+		return;
+
+	m_enabled = false;
+
+	{
+		std::lock_guard lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_one();
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	if (m_file) {
+		if (m_owns_file)
+			std::fclose(m_file);
+		else
+			std::fflush(m_file);
+	}
+
+	m_file = nullptr;
+	m_listener = nullptr;
+}
+
+std::string EventSink::make_line(const std::string& event, nlohmann::json data) {
+	auto now = std::chrono::system_clock::now().time_since_epoch();
+
+	data["event"] = event;
+	data["time"] = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+
+	// stderr captures can contain anything, don't let invalid utf-8 throw
+	return data.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
+
+void EventSink::emit(const std::string& event, nlohmann::json data) {
+	if (!m_enabled)
+		return;
+
+	push(make_line(event, std::move(data)), false);
+}
+
+void EventSink::emit_progress(uint32_t render_id, int current_frame, int total_frames, float fps) {
+	if (!m_enabled)
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+	bool final_frame = total_frames > 0 && current_frame >= total_frames; // live renders don't know their end
+
+	{
+		std::lock_guard lock(m_mutex);
+
+		bool new_render = render_id != m_last_progress_render_id;
+		if (!new_render && !final_frame && now - m_last_progress < m_progress_interval)
+			return;
+
+		m_last_progress = now;
+		m_last_progress_render_id = render_id;
+	}
+
+	nlohmann::json data = {
+		{ "render_id", render_id },
+		{ "frame", current_frame },
+		{ "total_frames", total_frames },
+		{ "fps", fps },
+	};
+
+	push(make_line("progress", std::move(data)), !final_frame);
+}
+
+void EventSink::push(std::string line, bool droppable) {
+	{
+		std::lock_guard lock(m_mutex);
+
+		if (droppable && m_lines.size() >= MAX_QUEUED_LINES)
+			return;
+
+		m_lines.push_back(std::move(line));
+	}
+	m_condition.notify_one();
+}
+
+void EventSink::run() {
+	std::unique_lock lock(m_mutex);
+
+	while (true) {
+		m_condition.wait(lock, [this] {
+			return m_stopping || !m_lines.empty();
+		});
+
+		if (m_lines.empty() && m_stopping)
+			break;
+
+		// write outside the lock so emitters never wait on a slow reader
+		std::deque<std::string> lines;
+		lines.swap(m_lines);
+
+		lock.unlock();
+
+		if (m_listener) {
+			for (const auto& line : lines)
+				m_listener(line);
+		}
+		else {
+			for (const auto& line : lines) {
+				std::fputs(line.c_str(), m_file);
+				std::fputc('\n', m_file);
+			}
+			std::fflush(m_file);
+		}
+
+		lock.lock();
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// machine-readable render events as json lines (one object per line, `event` + `time` + event fields) for whatever
+// is driving blur-cli. lines are queued and written by a background thread so rendering never waits on the output,
+// and frame progress is rate-limited
+class EventSink {
+public:
+	static constexpr auto DEFAULT_PROGRESS_INTERVAL = std::chrono::milliseconds(500);
+
+	~EventSink();
+
+	// target is "-" for stdout, "fd:N" for an already open file descriptor, anything else is a file path
+	tl::expected<void, std::string> open(
+		const std::string& target, std::chrono::milliseconds progress_interval = DEFAULT_PROGRESS_INTERVAL
+	);
+
+	// hands every line to a callback (on the writer thread) instead of writing it out
+	void open(
+		std::function<void(const std::string& line)> listener,
+		std::chrono::milliseconds progress_interval = DEFAULT_PROGRESS_INTERVAL
+	);
+
+	// flushes everything queued and stops the writer
+	void close();
+
+	[[nodiscard]] bool is_enabled() const {
+		return m_enabled;
+	}
+
+	[[nodiscard]] bool is_stdout() const {
+		return m_file == stdout;
+	}
+
+	void emit(const std::string& event, nlohmann::json data = nlohmann::json::object());
+
+	// dropped unless progress_interval has passed since the last one (or it's the final frame)
+	void emit_progress(uint32_t render_id, int current_frame, int total_frames, float fps);
+
+private:
+	// lifecycle events are always queued, progress gets dropped past this if the writer can't keep up
+	static constexpr size_t MAX_QUEUED_LINES = 1024;
+
+	std::atomic<bool> m_enabled = false;
+
+	std::FILE* m_file = nullptr;
+	bool m_owns_file = false;
+	std::function<void(const std::string& line)> m_listener;
+
+	std::chrono::milliseconds m_progress_interval = DEFAULT_PROGRESS_INTERVAL;
+	std::chrono::steady_clock::time_point m_last_progress;
+	uint32_t m_last_progress_render_id = 0;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<std::string> m_lines;
+	bool m_stopping = false;
+	std::thread m_thread;
+
+	static std::string make_line(const std::string& event, nlohmann::json data);
+	void start(std::chrono::milliseconds progress_interval);
+	void push(std::string line, bool droppable);
+	void run();
+};
+
+inline EventSink event_sink;
@@ -0,0 +1,183 @@
+#include "interpolation_cache.h"
+#include "source_analysis.h"
+
+namespace {
+	const std::string VIDEO_EXTENSION = ".mkv";
+	const std::string META_EXTENSION = ".json";
+	const std::string PENDING_SUFFIX = ".pending";
+
+	uint64_t hash_string(const std::string& str, uint64_t hash = 14695981039346656037ULL) {
+		for (unsigned char ch : str) {
+			hash ^= ch;
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	interpolation_cache::Entry get_entry(const std::string& name) {
+		auto folder = interpolation_cache::get_folder();
+		return {
+			.video_path = folder / (name + VIDEO_EXTENSION),
+			.meta_path = folder / (name + META_EXTENSION),
+		};
+	}
+}
+
+std::filesystem::path interpolation_cache::get_folder() {
+	return blur.settings_path / FOLDER_NAME;
+}
+
+std::optional<uint64_t> interpolation_cache::estimate_size(
+	const BlurSettings& settings, const u::VideoInfo& video_info
+) {
+	if (video_info.fps_num <= 0 || video_info.fps_den <= 0 || video_info.duration <= 0.0)
+		return {};
+
+	double fps = static_cast<double>(video_info.fps_num) / video_info.fps_den;
+	double duration = video_info.duration;
+
+	if (settings.timescale) {
+		double speed = settings.output_timescale / settings.input_timescale;
+		fps *= speed;
+		duration /= speed;
+	}
+
+	// same as parse_fps_setting in blur.py
+	double interpolated_fps = 0.0;
+	try {
+		const auto& setting = settings.interpolated_fps;
+		if (setting.ends_with('x'))
+			interpolated_fps = fps * std::stod(setting.substr(0, setting.size() - 1));
+		else
+			interpolated_fps = std::stod(setting);
+	}
+	catch (const std::exception&) {
+		return {};
+	}
+
+	// frames are cached in the source's format. 4:2:0 unless it says otherwise, two bytes a sample above 8-bit
+	auto [width, height] = config_blur::get_working_size(settings, video_info.width, video_info.height);
+	auto pix_fmt = video_info.pix_fmt.value_or("yuv420p");
+
+	double samples_per_pixel = 1.5;
+	if (pix_fmt.find("444") != std::string::npos)
+		samples_per_pixel = 3.0;
+	else if (pix_fmt.find("422") != std::string::npos)
+		samples_per_pixel = 2.0;
+
+	double bytes_per_sample = pix_fmt.ends_with("le") || pix_fmt.ends_with("be") ? 2.0 : 1.0;
+	double frame_bytes = static_cast<double>(width) * height * samples_per_pixel * bytes_per_sample;
+
+	return static_cast<uint64_t>(duration * interpolated_fps * frame_bytes * FFV1_RATIO);
+}
+
+std::optional<std::string> interpolation_cache::get_key(
+	const std::filesystem::path& source, const BlurSettings& settings
+) {
+	auto source_hash = source_analysis::get_source_hash(source);
+	if (!source_hash)
+		return {};
+
+	uint64_t settings_hash =
+		hash_string(config_blur::generate_config_string(config_blur::get_source_pass_settings(settings), false));
+
+	return std::format("{}-{:016x}", *source_hash, settings_hash);
+}
+
+std::optional<interpolation_cache::Entry> interpolation_cache::find(const std::string& key) {
+	auto entry = get_entry(key);
+
+	std::error_code ec;
+	if (!std::filesystem::exists(entry.video_path, ec) || !std::filesystem::exists(entry.meta_path, ec))
+		return {};
+
+	// modified time doubles as last use for eviction, access times aren't reliable (noatime etc.)
+	std::filesystem::last_write_time(entry.meta_path, std::filesystem::file_time_type::clock::now(), ec);
+
+	return entry;
+}
+
+interpolation_cache::Entry interpolation_cache::get_pending(const std::string& key) {
+	std::filesystem::create_directories(get_folder());
+
+	return get_entry(key + PENDING_SUFFIX);
+}
+
+tl::expected<interpolation_cache::Entry, std::string> interpolation_cache::commit(const std::string& key) {
+	auto pending = get_entry(key + PENDING_SUFFIX);
+	auto entry = get_entry(key);
+
+	std::error_code ec;
+	std::filesystem::rename(pending.video_path, entry.video_path, ec);
+	if (!ec)
+		std::filesystem::rename(pending.meta_path, entry.meta_path, ec);
+
+	if (ec) {
+		discard_pending(key);
+		std::filesystem::remove(entry.video_path, ec);
+		return tl::unexpected(std::format("Failed to save interpolation cache entry: {}", ec.message()));
+	}
+
+	return entry;
+}
+
+void interpolation_cache::discard_pending(const std::string& key) {
+	auto pending = get_entry(key + PENDING_SUFFIX);
+
+	std::error_code ec;
+	std::filesystem::remove(pending.video_path, ec);
+	std::filesystem::remove(pending.meta_path, ec);
+}
+
+void interpolation_cache::evict(uint64_t max_bytes, const std::optional<std::string>& keep) {
+	struct CachedEntry {
+		std::string key;
+		uint64_t size = 0;
+		std::filesystem::file_time_type last_used;
+	};
+
+	std::vector<CachedEntry> entries;
+	uint64_t total_size = 0;
+
+	std::error_code ec;
+	for (const auto& file : std::filesystem::directory_iterator(get_folder(), ec)) {
+		if (file.path().extension() != VIDEO_EXTENSION)
+			continue;
+
+		auto key = file.path().stem().string();
+		if (key.ends_with(PENDING_SUFFIX))
+			continue; // being written right now
+
+		auto entry = get_entry(key);
+
+		CachedEntry cached{ .key = key };
+		cached.size = std::filesystem::file_size(entry.video_path, ec);
+		if (ec)
+			continue;
+
+		cached.last_used = std::filesystem::last_write_time(entry.meta_path, ec);
+		if (ec)
+			cached.last_used = {}; // no metadata, it's broken anyway so it goes first
+
+		total_size += cached.size;
+		entries.push_back(std::move(cached));
+	}
+
+	std::ranges::sort(entries, {}, &CachedEntry::last_used);
+
+	for (const auto& cached : entries) {
+		if (total_size <= max_bytes)
+			break;
+
+		if (keep && cached.key == *keep)
+			continue;
+
+		auto entry = get_entry(cached.key);
+		std::filesystem::remove(entry.video_path, ec);
+		std::filesystem::remove(entry.meta_path, ec);
+
+		total_size -= cached.size;
+
+		DEBUG_LOG("interpolation cache: evicted {} ({} MB)", cached.key, cached.size / (1024 * 1024));
+	}
+}
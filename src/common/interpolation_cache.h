@@ -0,0 +1,41 @@
+#pragma once
+
+#include "config_blur.h"
+
+// on-disk cache of the deduplicated and interpolated frames (ffv1 in matroska), so renders that only change the blur,
+// filters or encoding skip straight to blending. entries are keyed by the source file and every setting that affects
+// the interpolated frames. a miss costs an extra pass that writes the entry before the render reads it back. the
+// folder is kept under the size limit in the app config by evicting the least recently used entries, and entries that
+// wouldn't fit in it on their own aren't written at all
+namespace interpolation_cache {
+	const std::string FOLDER_NAME = "interpolation_cache";
+
+	struct Entry {
+		std::filesystem::path video_path;
+		std::filesystem::path meta_path; // fps and frame count, written by blur.py alongside the frames
+	};
+
+	// ffv1 gets interpolated frames down to roughly this much of their raw size
+	constexpr double FFV1_RATIO = 0.6;
+
+	std::filesystem::path get_folder();
+
+	// roughly how big the entry for a video would be. empty if the interpolated frame rate can't be worked out
+	std::optional<uint64_t> estimate_size(const BlurSettings& settings, const u::VideoInfo& video_info);
+
+	// empty if the source can't be read
+	std::optional<std::string> get_key(const std::filesystem::path& source, const BlurSettings& settings);
+
+	// a complete entry for the key, marked as just used
+	std::optional<Entry> find(const std::string& key);
+
+	// where a new entry is written before it's committed, so a failed or stopped pass never leaves a partial entry
+	Entry get_pending(const std::string& key);
+
+	tl::expected<Entry, std::string> commit(const std::string& key);
+
+	void discard_pending(const std::string& key);
+
+	// removes the least recently used entries until the folder fits in max_bytes. keep is never removed
+	void evict(uint64_t max_bytes, const std::optional<std::string>& keep = {});
+}
@@ -0,0 +1,370 @@
+#include "job_store.h"
+
+#ifdef _WIN32
+#	include <io.h>
+#	include <share.h>
+#else
+#	include <sys/file.h>
+#	include <unistd.h>
+#endif
+
+namespace {
+	const std::vector<std::string> STATE_NAMES = { "pending", "running", "done", "failed" };
+
+	std::optional<JobState> state_from_string(const std::string& str) {
+		auto it = std::ranges::find(STATE_NAMES, str);
+		if (it == STATE_NAMES.end())
+			return {};
+
+		return static_cast<JobState>(std::distance(STATE_NAMES.begin(), it));
+	}
+
+	nlohmann::json job_to_json(const Job& job) {
+		nlohmann::json json = {
+			{ "id", job.id },
+			{ "input", std::format("{}", job.input) },
+			{ "priority", job.priority },
+			{ "state", JobStore::state_to_string(job.state) },
+			{ "submitted", job.submitted },
+		};
+
+		if (job.output)
+			json["output"] = std::format("{}", *job.output);
+
+		if (job.config)
+			json["config"] = std::format("{}", *job.config);
+
+		for (const auto& branch : job.branches) {
+			nlohmann::json branch_json = { { "config", std::format("{}", branch.config) } };
+			if (branch.output)
+				branch_json["output"] = std::format("{}", *branch.output);
+
+			json["branches"].push_back(std::move(branch_json));
+		}
+
+		if (!job.error.empty())
+			json["error"] = job.error;
+
+		return json;
+	}
+
+	Job job_from_json(const nlohmann::json& json) {
+		Job job{
+			.id = json.at("id").get<uint64_t>(),
+			.input = u::string_to_path(json.at("input").get<std::string>()),
+			.priority = json.value("priority", 0),
+			.state = state_from_string(json.value("state", "pending")).value_or(JobState::PENDING),
+			.submitted = json.value("submitted", int64_t(0)),
+			.error = json.value("error", ""),
+		};
+
+		if (json.contains("output"))
+			job.output = u::string_to_path(json.at("output").get<std::string>());
+
+		if (json.contains("config"))
+			job.config = u::string_to_path(json.at("config").get<std::string>());
+
+		for (const auto& branch_json : json.value("branches", nlohmann::json::array())) {
+			JobBranch branch{ .config = u::string_to_path(branch_json.at("config").get<std::string>()) };
+			if (branch_json.contains("output"))
+				branch.output = u::string_to_path(branch_json.at("output").get<std::string>());
+
+			job.branches.push_back(std::move(branch));
+		}
+
+		return job;
+	}
+
+	// flush our buffer and the os's, otherwise a power cut can still lose the last ops
+	void sync_file(std::FILE* file) {
+		std::fflush(file);
+#ifdef _WIN32
+		_commit(_fileno(file));
+#else
+		fsync(fileno(file));
+#endif
+	}
+
+	std::FILE* open_file(const std::filesystem::path& path, bool append) {
+#ifdef _WIN32
+		return _wfopen(path.c_str(), append ? L"ab" : L"wb");
+#else
+		return std::fopen(path.c_str(), append ? "ab" : "wb");
+#endif
+	}
+
+	// nothing if another process already holds it. let go of it by closing the file (the os does if we crash)
+	std::FILE* lock_file(const std::filesystem::path& path) {
+#ifdef _WIN32
+		// windows refuses to open a file another handle has open without sharing
+		return _wfsopen(path.c_str(), L"ab", _SH_DENYRW);
+#else
+		std::FILE* file = std::fopen(path.c_str(), "ab");
+		if (!file)
+			return nullptr;
+
+		if (flock(fileno(file), LOCK_EX | LOCK_NB) != 0) {
+			std::fclose(file);
+			return nullptr;
+		}
+
+		return file;
+#endif
+	}
+}
+
+JobStore::~JobStore() {
+	close();
+}
+
+std::string JobStore::state_to_string(JobState state) {
+	return STATE_NAMES[static_cast<size_t>(state)];
+}
+
+tl::expected<void, std::string> JobStore::open(const std::filesystem::path& path) {
+	close();
+
+	std::lock_guard lock(m_mutex);
+
+	// two processes appending to and compacting the same journal would lose each other's jobs
+	auto lock_path = path;
+	lock_path += ".lock";
+
+	m_lock = lock_file(lock_path);
+	if (!m_lock)
+		return tl::unexpected(std::format("Job queue {} is in use by another blur process", path));
+
+	m_path = path;
+	m_jobs.clear();
+	m_next_id = 1;
+
+	std::ifstream journal(path);
+	std::string line;
+	while (std::getline(journal, line)) {
+		// a crash mid-write leaves a torn last line, skip anything that doesn't parse
+		auto op = nlohmann::json::parse(line, nullptr, false);
+		if (op.is_discarded())
+			continue;
+
+		try {
+			apply(op);
+		}
+		catch (const std::exception& e) {
+			DEBUG_LOG("job store: skipping bad journal op: {}", e.what());
+		}
+	}
+	journal.close();
+
+	// nothing is running yet, whatever was running when we went down has to start over. jobs that finished before
+	// then were already reported to whoever was waiting on them
+	for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+		auto& job = it->second;
+
+		if (job.state == JobState::DONE || job.state == JobState::FAILED) {
+			it = m_jobs.erase(it);
+			continue;
+		}
+
+		if (job.state == JobState::RUNNING)
+			job.state = JobState::PENDING;
+
+		++it;
+	}
+
+	return compact();
+}
+
+void JobStore::close() {
+	std::lock_guard lock(m_mutex);
+
+	if (m_journal) {
+		std::fclose(m_journal);
+		m_journal = nullptr;
+	}
+
+	if (m_lock) {
+		std::fclose(m_lock);
+		m_lock = nullptr;
+	}
+}
+
+void JobStore::apply(const nlohmann::json& op) {
+	const auto type = op.at("op").get<std::string>();
+
+	if (type == "next_id") {
+		m_next_id = std::max(m_next_id, op.at("value").get<uint64_t>());
+	}
+	else if (type == "add") {
+		auto job = job_from_json(op.at("job"));
+		m_next_id = std::max(m_next_id, job.id + 1);
+		m_jobs[job.id] = std::move(job);
+	}
+	else if (type == "state") {
+		auto it = m_jobs.find(op.at("id").get<uint64_t>());
+		if (it == m_jobs.end())
+			return;
+
+		it->second.state = state_from_string(op.at("state").get<std::string>()).value_or(JobState::PENDING);
+		it->second.error = op.value("error", "");
+	}
+}
+
+void JobStore::append(const nlohmann::json& op) {
+	if (!m_journal)
+		return;
+
+	auto line = op.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+	line += '\n';
+
+	std::fwrite(line.data(), 1, line.size(), m_journal);
+	sync_file(m_journal);
+
+	m_journal_lines++;
+}
+
+tl::expected<void, std::string> JobStore::compact() {
+	auto temp_path = m_path;
+	temp_path += ".tmp";
+
+	std::FILE* temp_file = open_file(temp_path, false);
+	if (!temp_file)
+		return tl::unexpected(std::format("Failed to write job queue to {}", temp_path));
+
+	// finished jobs are left out of the journal, only the newest stay in memory
+	size_t finished = 0;
+	for (auto it = m_jobs.rbegin(); it != m_jobs.rend();) {
+		auto state = it->second.state;
+		if ((state == JobState::DONE || state == JobState::FAILED) && ++finished > MAX_FINISHED_JOBS)
+			it = std::make_reverse_iterator(m_jobs.erase(std::next(it).base()));
+		else
+			++it;
+	}
+
+	std::string contents = nlohmann::json{ { "op", "next_id" }, { "value", m_next_id } }.dump() + "\n";
+	size_t lines = 1;
+
+	for (const auto& job : m_jobs | std::views::values) {
+		if (job.state == JobState::DONE || job.state == JobState::FAILED)
+			continue;
+
+		contents += nlohmann::json{ { "op", "add" }, { "job", job_to_json(job) } }.dump(
+			-1, ' ', false, nlohmann::json::error_handler_t::replace
+		);
+		contents += '\n';
+		lines++;
+	}
+
+	std::fwrite(contents.data(), 1, contents.size(), temp_file);
+	sync_file(temp_file);
+	std::fclose(temp_file);
+
+	if (m_journal) {
+		std::fclose(m_journal);
+		m_journal = nullptr;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temp_path, m_path, ec);
+	if (ec)
+		return tl::unexpected(std::format("Failed to replace job queue {}: {}", m_path, ec.message()));
+
+	m_journal = open_file(m_path, true);
+	if (!m_journal)
+		return tl::unexpected(std::format("Failed to open job queue {}", m_path));
+
+	m_journal_lines = lines;
+	m_compacted_lines = lines;
+
+	return {};
+}
+
+void JobStore::compact_if_needed() {
+	// once the journal's doubled since it was last rewritten. finished jobs held in memory aren't in it
+	if (m_journal_lines < std::max(MIN_COMPACT_LINES, m_compacted_lines * 2))
+		return;
+
+	auto res = compact();
+	if (!res)
+		u::log_error("Job queue compaction failed: {}", res.error());
+}
+
+Job JobStore::add(Job job) {
+	std::lock_guard lock(m_mutex);
+
+	job.id = m_next_id++;
+	job.state = JobState::PENDING;
+	job.submitted =
+		std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+			.count();
+
+	m_jobs[job.id] = job;
+	append({ { "op", "add" }, { "job", job_to_json(job) } });
+	compact_if_needed();
+
+	return job;
+}
+
+void JobStore::set_state(uint64_t id, JobState state, const std::string& error) {
+	std::lock_guard lock(m_mutex);
+
+	auto it = m_jobs.find(id);
+	if (it == m_jobs.end())
+		return;
+
+	it->second.state = state;
+	it->second.error = error;
+
+	nlohmann::json op = { { "op", "state" }, { "id", id }, { "state", state_to_string(state) } };
+	if (!error.empty())
+		op["error"] = error;
+
+	append(op);
+	compact_if_needed();
+}
+
+std::optional<Job> JobStore::take_next() {
+	std::lock_guard lock(m_mutex);
+
+	Job* best = nullptr;
+	for (auto& job : m_jobs | std::views::values) {
+		if (job.state != JobState::PENDING)
+			continue;
+
+		// ids increase with submit order, so the map already iterates oldest first
+		if (!best || job.priority > best->priority)
+			best = &job;
+	}
+
+	if (!best)
+		return {};
+
+	best->state = JobState::RUNNING;
+	append({ { "op", "state" }, { "id", best->id }, { "state", state_to_string(JobState::RUNNING) } });
+
+	return *best;
+}
+
+std::optional<Job> JobStore::get(uint64_t id) {
+	std::lock_guard lock(m_mutex);
+
+	auto it = m_jobs.find(id);
+	if (it == m_jobs.end())
+		return {};
+
+	return it->second;
+}
+
+std::vector<Job> JobStore::get_jobs() {
+	std::lock_guard lock(m_mutex);
+
+	auto view = m_jobs | std::views::values;
+	return { view.begin(), view.end() };
+}
+
+size_t JobStore::get_pending_count() {
+	std::lock_guard lock(m_mutex);
+
+	return std::ranges::count_if(m_jobs | std::views::values, [](const Job& job) {
+		return job.state == JobState::PENDING;
+	});
+}
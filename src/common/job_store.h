@@ -0,0 +1,76 @@
+#pragma once
+
+// persistent render queue. every change is appended to a journal (one json op per line, flushed to disk) so a crash
+// loses nothing, and the journal is periodically rewritten to just the live jobs via temp file + rename. on open,
+// jobs that were running when the process died go back to pending. finished jobs stay queryable in memory (the most
+// recent few) until the store is reopened. only one process can have a journal open at a time
+enum class JobState : uint8_t {
+	PENDING,
+	RUNNING,
+	DONE,
+	FAILED,
+};
+
+// another config rendered off the same decode and interpolation pass as the job's main one
+struct JobBranch {
+	std::filesystem::path config;
+	std::optional<std::filesystem::path> output;
+};
+
+struct Job {
+	uint64_t id = 0;
+	std::filesystem::path input;
+	std::optional<std::filesystem::path> output;
+	std::optional<std::filesystem::path> config;
+	std::vector<JobBranch> branches;
+	int priority = 0; // higher renders first
+	JobState state = JobState::PENDING;
+	int64_t submitted = 0; // unix ms
+	std::string error;
+};
+
+class JobStore {
+public:
+	JobStore() = default;
+	~JobStore();
+
+	JobStore(const JobStore&) = delete;
+	JobStore& operator=(const JobStore&) = delete;
+
+	tl::expected<void, std::string> open(const std::filesystem::path& path);
+	void close();
+
+	// assigns the id and submit time
+	Job add(Job job);
+	void set_state(uint64_t id, JobState state, const std::string& error = "");
+
+	// highest priority pending job (oldest first within a priority), marked as running
+	std::optional<Job> take_next();
+
+	[[nodiscard]] std::optional<Job> get(uint64_t id);
+	[[nodiscard]] std::vector<Job> get_jobs();
+	[[nodiscard]] size_t get_pending_count();
+
+	static std::string state_to_string(JobState state);
+
+private:
+	static constexpr size_t MIN_COMPACT_LINES = 256;
+	// finished jobs kept in memory so status right after a job ends still finds it. they never go back in the journal
+	static constexpr size_t MAX_FINISHED_JOBS = 64;
+
+	std::filesystem::path m_path;
+	std::FILE* m_journal = nullptr;
+	std::FILE* m_lock = nullptr; // held open while the store is, next to the journal since that gets replaced
+	size_t m_journal_lines = 0;
+	size_t m_compacted_lines = 0; // journal lines right after the last rewrite
+
+	std::map<uint64_t, Job> m_jobs;
+	uint64_t m_next_id = 1;
+
+	std::mutex m_mutex;
+
+	void append(const nlohmann::json& op);
+	void apply(const nlohmann::json& op);
+	tl::expected<void, std::string> compact();
+	void compact_if_needed();
+};
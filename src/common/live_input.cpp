@@ -0,0 +1,177 @@
+#include "live_input.h"
+#include "watch_folder.h"
+
+LiveInput::LiveInput(std::filesystem::path path, std::chrono::seconds timeout)
+	: m_path(std::move(path)), m_timeout(timeout) {}
+
+LiveInput::~LiveInput() {
+	stop();
+}
+
+bool LiveInput::has_audio_stream(const std::filesystem::path& path) {
+	namespace bp = boost::process;
+
+	bp::ipstream pipe_stream;
+	bp::child c(
+		boost::filesystem::path{ blur.ffprobe_path },
+		"-v",
+		"error",
+		"-select_streams",
+		"a",
+		"-show_entries",
+		"stream=index",
+		"-of",
+		"csv=p=0",
+		boost::filesystem::path{ path },
+		bp::std_out > pipe_stream,
+		bp::std_err.null()
+#ifdef _WIN32
+			,
+		bp::windows::create_no_window
+#endif
+	);
+
+	bool has_audio = false;
+
+	std::string line;
+	while (pipe_stream && std::getline(pipe_stream, line)) {
+		boost::algorithm::trim(line);
+		if (!line.empty())
+			has_audio = true;
+	}
+
+	c.wait();
+
+	return has_audio;
+}
+
+tl::expected<void, std::string> LiveInput::start(
+	boost::process::pipe& output,
+	const std::optional<std::filesystem::path>& audio_path,
+	const boost::process::environment& env
+) {
+	namespace bp = boost::process;
+
+	std::vector<std::wstring> args = {
+		L"-loglevel", L"error", L"-hide_banner", L"-i", L"-", L"-map", L"0:v:0", L"-f", L"yuv4mpegpipe",
+		L"-strict",   L"-1",    L"pipe:1",
+	};
+
+	if (audio_path) {
+		args.insert(
+			args.end(), { L"-map", L"0:a:0", L"-c:a", L"copy", L"-f", L"matroska", L"-y", audio_path->wstring() }
+		);
+	}
+
+	try {
+		m_process.emplace(
+			boost::filesystem::path{ blur.ffmpeg_path },
+			bp::args(args),
+			bp::std_in < m_stdin,
+			bp::std_out > output,
+			bp::std_err > m_stderr,
+			env
+#ifdef _WIN32
+			,
+			bp::windows::create_no_window
+#endif
+		);
+	}
+	catch (const boost::system::system_error& e) {
+		return tl::unexpected(std::format("Failed to start live decoder: {}", e.what()));
+	}
+
+	m_pid = m_process->id();
+
+	m_stderr_reader = std::thread([this] {
+		std::string line;
+		while (std::getline(m_stderr, line)) {
+			std::lock_guard lock(m_stderr_mutex);
+			m_stderr_output += line + '\n';
+		}
+	});
+
+	m_feeder = std::thread(&LiveInput::feed, this);
+
+	return {};
+}
+
+void LiveInput::feed() {
+	std::ifstream file(m_path, std::ios::binary);
+	if (!file) {
+		u::log_error("Failed to open live input {}", m_path);
+		m_stdin.pipe().close();
+		return;
+	}
+
+	std::vector<char> buffer(READ_CHUNK_SIZE);
+	auto last_growth = std::chrono::steady_clock::now();
+
+	while (!m_stopping) {
+		file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		auto read = file.gcount();
+
+		if (read > 0) {
+			m_stdin.write(buffer.data(), read);
+			if (!m_stdin) {
+				DEBUG_LOG("live input: decoder stopped taking data");
+				break;
+			}
+
+			last_growth = std::chrono::steady_clock::now();
+
+			if (file)
+				continue; // read a full chunk, there's probably more waiting
+		}
+
+		// caught up with the writer. clear eof so the next read picks up whatever gets appended
+		file.clear();
+
+		auto idle_time = std::chrono::steady_clock::now() - last_growth;
+
+		if (idle_time >= SETTLE_TIME && !WatchFolder::is_open_for_writing(m_path)) {
+			u::log("Live input finished recording");
+			break;
+		}
+
+		if (idle_time >= m_timeout) {
+			u::log("Live input hasn't grown for {}s, treating it as finished", m_timeout.count());
+			break;
+		}
+
+		std::this_thread::sleep_for(POLL_INTERVAL);
+	}
+
+	// eof for the decoder, it'll flush what it has and exit which ends the render
+	m_stdin.flush();
+	m_stdin.pipe().close();
+}
+
+void LiveInput::stop() {
+	m_stopping = true;
+
+	// normally it's already exited by now. if not, killing it also unblocks a feeder stuck writing to it
+	if (m_process && m_process->running()) {
+		std::error_code ec;
+		m_process->terminate(ec);
+	}
+
+	if (m_feeder.joinable())
+		m_feeder.join();
+
+	if (m_process) {
+		std::error_code ec;
+		m_process->wait(ec);
+	}
+
+	if (m_stderr_reader.joinable())
+		m_stderr_reader.join();
+
+	m_process.reset();
+	m_pid = -1;
+}
+
+std::string LiveInput::get_stderr() {
+	std::lock_guard lock(m_stderr_mutex);
+	return m_stderr_output;
+}
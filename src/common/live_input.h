@@ -0,0 +1,60 @@
+#pragma once
+
+// follows an input that's still being recorded. a feeder thread tails the file and pipes what's been written so far
+// into an ffmpeg that decodes it to y4m for vspipe (blur.py's live source reads that from stdin), splitting any audio
+// off to its own file so it can be muxed back in at the end. the input is over once the writer has closed the file,
+// or once it's stopped growing for the timeout when that can't be told. the recording has to be in a format that
+// can be read while it's being written (mkv, fragmented mp4, ts...)
+class LiveInput {
+public:
+	static constexpr auto DEFAULT_TIMEOUT = std::chrono::seconds(30);
+
+	// printed by blur.py when it runs out of frames, a render that ends with it finished normally
+	static constexpr std::string_view END_OF_INPUT_MESSAGE = "live input ended";
+
+	LiveInput(std::filesystem::path path, std::chrono::seconds timeout);
+	~LiveInput();
+
+	LiveInput(const LiveInput&) = delete;
+	LiveInput& operator=(const LiveInput&) = delete;
+
+	// decoded frames are written to output, which should be what vspipe reads as stdin
+	tl::expected<void, std::string> start(
+		boost::process::pipe& output,
+		const std::optional<std::filesystem::path>& audio_path,
+		const boost::process::environment& env
+	);
+
+	// stops following the input and waits for the decoder to go away
+	void stop();
+
+	[[nodiscard]] int get_pid() const {
+		return m_pid;
+	}
+
+	[[nodiscard]] std::string get_stderr();
+
+	static bool has_audio_stream(const std::filesystem::path& path);
+
+private:
+	static constexpr auto SETTLE_TIME = std::chrono::seconds(3);
+	static constexpr auto POLL_INTERVAL = std::chrono::milliseconds(200);
+	static constexpr size_t READ_CHUNK_SIZE = 1024 * 1024;
+
+	std::filesystem::path m_path;
+	std::chrono::seconds m_timeout;
+
+	std::optional<boost::process::child> m_process;
+	boost::process::opstream m_stdin;
+	boost::process::ipstream m_stderr;
+	int m_pid = -1;
+
+	std::thread m_feeder;
+	std::thread m_stderr_reader;
+	std::atomic<bool> m_stopping = false;
+
+	std::mutex m_stderr_mutex;
+	std::string m_stderr_output;
+
+	void feed();
+};
@@ -0,0 +1,329 @@
+#include "processes.h"
+
+#ifdef __linux__
+#	include <fcntl.h>
+#	include <sched.h>
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#	include <psapi.h>
+#else
+#	include <sys/resource.h>
+#endif
+
+#ifdef __APPLE__
+#	include <sys/sysctl.h>
+#endif
+
+std::vector<int> processes::get_allowed_cores() {
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		std::vector<int> cores;
+		for (int core = 0; core < CPU_SETSIZE; core++) {
+			if (CPU_ISSET(core, &set))
+				cores.push_back(core);
+		}
+
+		if (!cores.empty())
+			return cores;
+	}
+#endif
+
+	std::vector<int> cores(std::max(1U, std::thread::hardware_concurrency()));
+	std::iota(cores.begin(), cores.end(), 0);
+	return cores;
+}
+
+int processes::get_core_count() {
+#ifdef __linux__
+	return static_cast<int>(get_allowed_cores().size());
+#else
+	return std::max(1U, std::thread::hardware_concurrency());
+#endif
+}
+
+std::optional<double> processes::get_cpu_time(int pid) {
+	if (pid <= 0)
+		return {};
+
+#if defined(__linux__)
+	std::ifstream stat_file(std::format("/proc/{}/stat", pid));
+	if (!stat_file)
+		return {};
+
+	std::string stat;
+	std::getline(stat_file, stat);
+
+	// the process name can contain spaces, so skip past its closing paren before splitting
+	auto name_end = stat.rfind(')');
+	if (name_end == std::string::npos)
+		return {};
+
+	std::istringstream fields(stat.substr(name_end + 2));
+	std::string field;
+
+	// fields after the name start at 3 (state). utime and stime are 14 and 15
+	uint64_t utime = 0;
+	uint64_t stime = 0;
+	for (int i = 3; i <= 15 && fields >> field; i++) {
+		if (i == 14)
+			utime = std::stoull(field);
+		else if (i == 15)
+			stime = std::stoull(field);
+	}
+
+	static const long ticks_per_second = sysconf(_SC_CLK_TCK);
+
+	return static_cast<double>(utime + stime) / static_cast<double>(ticks_per_second);
+#elif defined(_WIN32)
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+	if (!process)
+		return {};
+
+	FILETIME creation_time;
+	FILETIME exit_time;
+	FILETIME kernel_time;
+	FILETIME user_time;
+	bool success = GetProcessTimes(process, &creation_time, &exit_time, &kernel_time, &user_time);
+	CloseHandle(process);
+
+	if (!success)
+		return {};
+
+	auto to_seconds = [](const FILETIME& time) {
+		ULARGE_INTEGER value;
+		value.LowPart = time.dwLowDateTime;
+		value.HighPart = time.dwHighDateTime;
+		return static_cast<double>(value.QuadPart) / 1e7; // 100ns units
+	};
+
+	return to_seconds(kernel_time) + to_seconds(user_time);
+#else
+	return {};
+#endif
+}
+
+std::optional<int> processes::get_pipe_fill(int fd) {
+#ifdef __linux__
+	int bytes = 0;
+	if (ioctl(fd, FIONREAD, &bytes) == -1)
+		return {};
+
+	return bytes;
+#else
+	return {};
+#endif
+}
+
+std::optional<int> processes::get_pipe_capacity(int fd) {
+#ifdef __linux__
+	int capacity = fcntl(fd, F_GETPIPE_SZ);
+	if (capacity <= 0)
+		return {};
+
+	return capacity;
+#else
+	return {};
+#endif
+}
+
+bool processes::set_affinity(int pid, const std::vector<int>& cores) {
+#ifdef __linux__
+	if (pid <= 0 || cores.empty())
+		return false;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int core : cores)
+		CPU_SET(core, &set);
+
+	// sched_setaffinity only applies to a single thread, so walk all of them. threads spawned afterwards inherit
+	// the mask of whichever thread created them, which is close enough
+	std::error_code ec;
+	bool applied = false;
+	for (const auto& task : std::filesystem::directory_iterator(std::format("/proc/{}/task", pid), ec)) {
+		try {
+			int tid = std::stoi(task.path().filename().string());
+			if (sched_setaffinity(tid, sizeof(set), &set) == 0)
+				applied = true;
+		}
+		catch (const std::exception&) {
+			continue;
+		}
+	}
+
+	return applied;
+#else
+	return false;
+#endif
+}
+
+bool processes::set_background_priority(int pid) {
+	if (pid <= 0)
+		return false;
+
+#if defined(_WIN32)
+	HANDLE process = OpenProcess(PROCESS_SET_INFORMATION, FALSE, pid);
+	if (!process)
+		return false;
+
+	bool success = SetPriorityClass(process, IDLE_PRIORITY_CLASS);
+	CloseHandle(process);
+
+	return success;
+#else
+	bool success = setpriority(PRIO_PROCESS, pid, 19) == 0;
+
+#	ifdef __linux__
+	// glibc has no ioprio_set wrapper. values from linux/ioprio.h
+	constexpr int IOPRIO_WHO_PROCESS = 1;
+	constexpr int IOPRIO_CLASS_IDLE = 3;
+	constexpr int IOPRIO_CLASS_SHIFT = 13;
+
+	success &= syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, pid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0;
+#	endif
+
+	return success;
+#endif
+}
+
+bool processes::suspend(int pid) {
+	if (pid <= 0)
+		return false;
+
+#ifdef _WIN32
+	return u::windows_toggle_suspend_process(pid, true);
+#else
+	return kill(pid, SIGSTOP) == 0;
+#endif
+}
+
+bool processes::resume(int pid) {
+	if (pid <= 0)
+		return false;
+
+#ifdef _WIN32
+	return u::windows_toggle_suspend_process(pid, false);
+#else
+	return kill(pid, SIGCONT) == 0;
+#endif
+}
+
+std::optional<double> processes::get_system_cpu_time() {
+#if defined(__linux__)
+	std::ifstream stat_file("/proc/stat");
+	if (!stat_file)
+		return {};
+
+	// cpu  user nice system idle iowait irq softirq steal ...
+	std::string label;
+	uint64_t user = 0;
+	uint64_t nice = 0;
+	uint64_t system = 0;
+	uint64_t idle = 0;
+	uint64_t iowait = 0;
+	uint64_t irq = 0;
+	uint64_t softirq = 0;
+	uint64_t steal = 0;
+	stat_file >> label >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
+
+	if (!stat_file || label != "cpu")
+		return {};
+
+	static const long ticks_per_second = sysconf(_SC_CLK_TCK);
+
+	return static_cast<double>(user + nice + system + irq + softirq + steal) / static_cast<double>(ticks_per_second);
+#elif defined(_WIN32)
+	FILETIME idle_time;
+	FILETIME kernel_time;
+	FILETIME user_time;
+	if (!GetSystemTimes(&idle_time, &kernel_time, &user_time))
+		return {};
+
+	auto to_seconds = [](const FILETIME& time) {
+		ULARGE_INTEGER value;
+		value.LowPart = time.dwLowDateTime;
+		value.HighPart = time.dwHighDateTime;
+		return static_cast<double>(value.QuadPart) / 1e7; // 100ns units
+	};
+
+	// kernel time includes idle time
+	return to_seconds(kernel_time) + to_seconds(user_time) - to_seconds(idle_time);
+#else
+	return {};
+#endif
+}
+
+std::optional<int64_t> processes::get_memory_usage(int pid) {
+	if (pid <= 0)
+		return {};
+
+#if defined(__linux__)
+	std::ifstream status_file(std::format("/proc/{}/status", pid));
+	if (!status_file)
+		return {};
+
+	std::string line;
+	while (std::getline(status_file, line)) {
+		// VmRSS:     12345 kB
+		if (!line.starts_with("VmRSS:"))
+			continue;
+
+		try {
+			return std::stoll(line.substr(6)) * 1024;
+		}
+		catch (const std::exception&) {
+			return {};
+		}
+	}
+
+	return {};
+#elif defined(_WIN32)
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+	if (!process)
+		return {};
+
+	PROCESS_MEMORY_COUNTERS counters{};
+	bool success = K32GetProcessMemoryInfo(process, &counters, sizeof(counters));
+	CloseHandle(process);
+
+	if (!success)
+		return {};
+
+	return static_cast<int64_t>(counters.WorkingSetSize);
+#else
+	return {};
+#endif
+}
+
+std::optional<int64_t> processes::get_total_memory() {
+#if defined(__linux__)
+	long pages = sysconf(_SC_PHYS_PAGES);
+	long page_size = sysconf(_SC_PAGE_SIZE);
+	if (pages <= 0 || page_size <= 0)
+		return {};
+
+	return static_cast<int64_t>(pages) * page_size;
+#elif defined(_WIN32)
+	MEMORYSTATUSEX status{};
+	status.dwLength = sizeof(status);
+	if (!GlobalMemoryStatusEx(&status))
+		return {};
+
+	return static_cast<int64_t>(status.ullTotalPhys);
+#elif defined(__APPLE__)
+	int64_t memory = 0;
+	size_t size = sizeof(memory);
+	if (sysctlbyname("hw.memsize", &memory, &size, nullptr, 0) != 0)
+		return {};
+
+	return memory;
+#else
+	return {};
+#endif
+}
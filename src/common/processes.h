@@ -0,0 +1,33 @@
+#pragma once
+
+// os-level helpers for inspecting and steering the vspipe/ffmpeg children of a render
+namespace processes {
+	// cores this process is allowed to run on (cpusets, taskset, container limits), children inherit them
+	std::vector<int> get_allowed_cores();
+	int get_core_count();
+
+	// total cpu time (user + system, all threads) used by a process in seconds
+	std::optional<double> get_cpu_time(int pid);
+
+	// bytes currently buffered in a pipe, and how many it can hold before the writer blocks
+	std::optional<int> get_pipe_fill(int fd);
+	std::optional<int> get_pipe_capacity(int fd);
+
+	// pins every thread of a process to the given cores. only supported on linux
+	bool set_affinity(int pid, const std::vector<int>& cores);
+
+	// lowest cpu priority and idle io class, so the process only gets what nothing else wants
+	bool set_background_priority(int pid);
+
+	bool suspend(int pid);
+	bool resume(int pid);
+
+	// resident memory of a process in bytes
+	std::optional<int64_t> get_memory_usage(int pid);
+
+	// physical memory installed in bytes
+	std::optional<int64_t> get_total_memory();
+
+	// total busy cpu time across every core on the system in seconds
+	std::optional<double> get_system_cpu_time();
+}
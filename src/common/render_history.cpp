@@ -0,0 +1,236 @@
+#include "render_history.h"
+
+namespace {
+	// fnv-1a, std::hash isn't guaranteed to be stable between runs or builds
+	uint64_t hash_string(const std::string& str) {
+		uint64_t hash = 14695981039346656037ULL;
+		for (unsigned char ch : str) {
+			hash ^= ch;
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	nlohmann::json entry_to_json(const render_history::Entry& entry) {
+		return {
+			{ "timestamp", entry.timestamp },
+			{ "width", entry.width },
+			{ "height", entry.height },
+			{ "fps", entry.fps },
+			{ "duration", entry.duration },
+			{ "output_frames", entry.output_frames },
+			// as strings, json readers commonly lose precision past 2^53
+			{ "settings_hash", std::to_string(entry.settings_hash) },
+			{ "pipeline_hash", std::to_string(entry.pipeline_hash) },
+			{ "startup", entry.timings.startup },
+			{ "processing", entry.timings.processing },
+			{ "finishing", entry.timings.finishing },
+			{ "throughput", entry.throughput },
+			{ "peak_memory", entry.peak_memory },
+		};
+	}
+
+	std::optional<render_history::Entry> entry_from_json(const nlohmann::json& json) {
+		try {
+			return render_history::Entry{
+				.timestamp = json.at("timestamp").get<int64_t>(),
+				.width = json.at("width").get<int>(),
+				.height = json.at("height").get<int>(),
+				.fps = json.at("fps").get<double>(),
+				.duration = json.at("duration").get<double>(),
+				.output_frames = json.at("output_frames").get<int>(),
+				.settings_hash = std::stoull(json.at("settings_hash").get<std::string>()),
+				.pipeline_hash = std::stoull(json.at("pipeline_hash").get<std::string>()),
+				.timings = {
+					.startup = json.at("startup").get<double>(),
+					.processing = json.at("processing").get<double>(),
+					.finishing = json.at("finishing").get<double>(),
+				},
+				.throughput = json.at("throughput").get<double>(),
+				.peak_memory = json.at("peak_memory").get<int64_t>(),
+			};
+		}
+		catch (const std::exception&) {
+			return {};
+		}
+	}
+
+	double median(std::vector<double> values) {
+		if (values.empty())
+			return 0.0;
+
+		auto middle = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+		std::ranges::nth_element(values, middle);
+		return *middle;
+	}
+}
+
+uint64_t render_history::hash_settings(const BlurSettings& settings) {
+	auto json = settings.to_json();
+	if (!json)
+		return hash_pipeline(settings);
+
+	return hash_string(json->dump());
+}
+
+uint64_t render_history::hash_pipeline(const BlurSettings& settings) {
+	// the things that decide how much work each frame is. amounts/weights/filters are cheap in comparison
+	return hash_string(
+		std::format(
+			"{}|{}|{}|{}|{}|{}|{}|{}|{}|{}|{}",
+			settings.blur,
+			settings.blur_output_fps,
+			settings.interpolate,
+			settings.interpolated_fps,
+			settings.interpolation_method,
+			settings.gpu_interpolation,
+			settings.pre_interpolate,
+			settings.deduplicate ? settings.deduplicate_method : "",
+			settings.encode_preset,
+			settings.gpu_encoding,
+			settings.timescale ? settings.input_timescale / settings.output_timescale : 1.f
+		)
+	);
+}
+
+std::filesystem::path render_history::get_history_path() {
+	return blur.settings_path / HISTORY_FILENAME;
+}
+
+std::vector<render_history::Entry> render_history::load() {
+	std::vector<Entry> entries;
+
+	std::ifstream file(get_history_path());
+	if (!file)
+		return entries;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		auto json = nlohmann::json::parse(line, nullptr, false);
+		if (json.is_discarded())
+			continue;
+
+		if (auto entry = entry_from_json(json))
+			entries.push_back(*entry);
+	}
+
+	return entries;
+}
+
+void render_history::record(const Entry& entry) {
+	auto history_path = get_history_path();
+
+	auto entries = load();
+	if (entries.size() < MAX_ENTRIES) {
+		std::ofstream file(history_path, std::ios::app);
+		file << entry_to_json(entry).dump() << "\n";
+		return;
+	}
+
+	// full, drop the oldest. write to a temp file first so a crash can't lose the whole history
+	entries.erase(entries.begin(), entries.end() - static_cast<std::ptrdiff_t>(MAX_ENTRIES - 1));
+	entries.push_back(entry);
+
+	auto temp_path = history_path;
+	temp_path += ".tmp";
+
+	{
+		std::ofstream file(temp_path, std::ios::trunc);
+		for (const auto& existing : entries)
+			file << entry_to_json(existing).dump() << "\n";
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temp_path, history_path, ec);
+	if (ec)
+		u::log_error("Failed to update render history: {}", ec.message());
+}
+
+std::optional<render_history::Estimate> render_history::estimate(
+	const u::VideoInfo& video_info, const BlurSettings& settings
+) {
+	if (video_info.width <= 0 || video_info.height <= 0 || video_info.duration <= 0.0)
+		return {};
+
+	auto entries = load();
+	if (entries.empty())
+		return {};
+
+	// prefer renders with identical settings, then ones running the same stages
+	uint64_t settings_hash = hash_settings(settings);
+	uint64_t pipeline_hash = hash_pipeline(settings);
+
+	std::vector<Entry> matches;
+	bool exact_settings = true;
+
+	for (const auto& entry : entries | std::views::reverse) {
+		if (entry.settings_hash == settings_hash)
+			matches.push_back(entry);
+	}
+
+	if (matches.empty()) {
+		exact_settings = false;
+		for (const auto& entry : entries | std::views::reverse) {
+			if (entry.pipeline_hash == pipeline_hash)
+				matches.push_back(entry);
+		}
+	}
+
+	if (matches.empty())
+		return {};
+
+	if (matches.size() > ESTIMATE_SAMPLES)
+		matches.resize(ESTIMATE_SAMPLES);
+
+	// processing cost scales with pixels * seconds of footage, finishing (audio, muxing) with seconds of footage,
+	// startup (loading plugins/models, indexing the source) is roughly fixed
+	std::vector<double> startups;
+	std::vector<double> processing_rates;
+	std::vector<double> finishing_rates;
+	double memory_rate = 0.0;
+
+	for (const auto& entry : matches) {
+		double pixels = static_cast<double>(entry.width) * entry.height;
+		if (pixels <= 0.0 || entry.duration <= 0.0)
+			continue;
+
+		startups.push_back(entry.timings.startup);
+		processing_rates.push_back(entry.timings.processing / (pixels * entry.duration));
+		finishing_rates.push_back(entry.timings.finishing / entry.duration);
+
+		// memory is mostly frame caches so it scales with resolution. take the worst seen so the estimate is an
+		// upper bound rather than a typical value
+		memory_rate = std::max(memory_rate, static_cast<double>(entry.peak_memory) / pixels);
+	}
+
+	if (processing_rates.empty())
+		return {};
+
+	// processed at the output resolution when one's set
+	auto [width, height] = config_blur::get_working_size(settings, video_info.width, video_info.height);
+	double pixels = static_cast<double>(width) * height;
+
+	return Estimate{
+		.wall_time = median(startups) + (median(processing_rates) * pixels * video_info.duration) +
+		             (median(finishing_rates) * video_info.duration),
+		.peak_memory = static_cast<int64_t>(memory_rate * pixels),
+		.samples = processing_rates.size(),
+		.exact_settings = exact_settings,
+	};
+}
+
+std::string render_history::format_duration(double seconds) {
+	int total = std::max(0, static_cast<int>(std::round(seconds)));
+
+	int hours = total / 3600;
+	int minutes = (total % 3600) / 60;
+	int secs = total % 60;
+
+	if (hours > 0)
+		return std::format("{}h {}m", hours, minutes);
+
+	if (minutes > 0)
+		return std::format("{}m {}s", minutes, secs);
+
+	return std::format("{}s", secs);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "config_blur.h"
+
+// local record of finished renders (one json object per line in the settings folder), used to predict how long a
+// render will take and how much memory it'll need before it starts
+namespace render_history {
+	const std::string HISTORY_FILENAME = "render_history.jsonl";
+	constexpr size_t MAX_ENTRIES = 500;
+	constexpr size_t ESTIMATE_SAMPLES = 20; // only look at the most recent matching renders, hardware changes
+
+	struct StageTimings {
+		double startup = 0.0;    // launch until vapoursynth produced its first frame
+		double processing = 0.0; // first frame until vapoursynth finished
+		double finishing = 0.0;  // vapoursynth finished until ffmpeg finished (flushing, muxing audio)
+	};
+
+	struct Entry {
+		int64_t timestamp = 0; // unix seconds
+
+		int width = 0;
+		int height = 0;
+		double fps = 0.0;
+		double duration = 0.0;
+		int output_frames = 0;
+
+		uint64_t settings_hash = 0; // every setting
+		uint64_t pipeline_hash = 0; // only the settings that decide which stages run
+
+		StageTimings timings;
+		double throughput = 0.0; // output frames per second while processing
+		int64_t peak_memory = 0; // bytes, vspipe + ffmpeg
+	};
+
+	struct Estimate {
+		double wall_time = 0.0;
+		int64_t peak_memory = 0;
+		size_t samples = 0;
+		bool exact_settings = false; // based on renders with identical settings
+	};
+
+	uint64_t hash_settings(const BlurSettings& settings);
+	uint64_t hash_pipeline(const BlurSettings& settings);
+
+	std::filesystem::path get_history_path();
+
+	std::vector<Entry> load();
+	void record(const Entry& entry);
+
+	std::optional<Estimate> estimate(const u::VideoInfo& video_info, const BlurSettings& settings);
+
+	std::string format_duration(double seconds);
+}
@@ -0,0 +1,118 @@
+#include "render_throttle.h"
+#include "processes.h"
+
+RenderThrottle::RenderThrottle(bool enabled, float load_threshold)
+	: m_enabled(enabled), m_load_threshold(std::clamp(load_threshold, 0.05f, 1.f)) {}
+
+void RenderThrottle::attach(int vspipe_pid, int ffmpeg_pid) {
+	m_vspipe_pid = vspipe_pid;
+	m_ffmpeg_pid = ffmpeg_pid;
+
+	if (!m_enabled)
+		return;
+
+	// there's no vspipe when ffmpeg renders on its own
+	bool vspipe_ok = m_vspipe_pid <= 0 || processes::set_background_priority(m_vspipe_pid);
+	if (!vspipe_ok || !processes::set_background_priority(m_ffmpeg_pid))
+		DEBUG_LOG("render throttle: failed to lower priority of render processes");
+
+	m_period_start = std::chrono::steady_clock::now();
+	start_sample();
+}
+
+void RenderThrottle::start_sample() {
+	m_sample_start = std::chrono::steady_clock::now();
+	m_sample_system_cpu = processes::get_system_cpu_time();
+	m_sample_render_cpu = get_render_cpu_time();
+}
+
+std::optional<double> RenderThrottle::get_render_cpu_time() const {
+	auto vspipe_cpu = m_vspipe_pid > 0 ? processes::get_cpu_time(m_vspipe_pid) : 0.0;
+	auto ffmpeg_cpu = processes::get_cpu_time(m_ffmpeg_pid);
+	if (!vspipe_cpu || !ffmpeg_cpu)
+		return {};
+
+	return *vspipe_cpu + *ffmpeg_cpu;
+}
+
+void RenderThrottle::sample() {
+	std::chrono::duration<double> window = std::chrono::steady_clock::now() - m_sample_start;
+
+	auto system_cpu = processes::get_system_cpu_time();
+	auto render_cpu = get_render_cpu_time();
+	if (!system_cpu || !render_cpu || !m_sample_system_cpu || !m_sample_render_cpu)
+		return;
+
+	// fraction of the machine used by everything except the render
+	double system_usage = (*system_cpu - *m_sample_system_cpu) / window.count();
+	double render_usage = (*render_cpu - *m_sample_render_cpu) / window.count();
+	double foreground_load = std::max(0.0, system_usage - render_usage) / processes::get_core_count();
+
+	float old_fraction = m_pause_fraction;
+
+	// back off gradually so a short spike doesn't stall the render for long, and recover the same way
+	if (foreground_load >= m_load_threshold)
+		m_pause_fraction = std::min(MAX_PAUSE_FRACTION, m_pause_fraction + PAUSE_STEP);
+	else
+		m_pause_fraction = std::max(0.f, m_pause_fraction - PAUSE_STEP);
+
+	if (m_pause_fraction != old_fraction) {
+		DEBUG_LOG(
+			"render throttle: foreground load {:.0f}% -> pausing {:.0f}% of the time",
+			foreground_load * 100,
+			m_pause_fraction * 100
+		);
+	}
+}
+
+void RenderThrottle::update(bool paused) {
+	if (!m_enabled || m_ffmpeg_pid <= 0)
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+
+	if (paused) {
+		if (m_suspended) {
+			m_throttled_time += now - m_suspend_start;
+			m_suspend_start = now;
+		}
+
+		start_sample(); // don't judge load on a window where the render wasn't running
+		return;
+	}
+
+	if (now - m_sample_start >= SAMPLE_INTERVAL) {
+		sample();
+		start_sample();
+	}
+
+	if (now - m_period_start >= DUTY_PERIOD)
+		m_period_start = now;
+
+	// paused for the first part of each period, running for the rest
+	auto pause_length = std::chrono::duration_cast<std::chrono::steady_clock::duration>(DUTY_PERIOD * m_pause_fraction);
+	set_suspended(now - m_period_start < pause_length);
+}
+
+void RenderThrottle::release() {
+	set_suspended(false);
+}
+
+void RenderThrottle::set_suspended(bool suspended) {
+	if (suspended == m_suspended)
+		return;
+
+	if (suspended) {
+		// stop the producer first so ffmpeg isn't left waiting on a half-written frame for longer than it has to
+		processes::suspend(m_vspipe_pid);
+		processes::suspend(m_ffmpeg_pid);
+		m_suspend_start = std::chrono::steady_clock::now();
+	}
+	else {
+		processes::resume(m_ffmpeg_pid);
+		processes::resume(m_vspipe_pid);
+		m_throttled_time += std::chrono::steady_clock::now() - m_suspend_start;
+	}
+
+	m_suspended = suspended;
+}
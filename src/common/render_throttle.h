@@ -0,0 +1,59 @@
+#pragma once
+
+// background rendering: drops both children to the lowest cpu/io priority, and when everything else on the system
+// (foreground use, not counting the render itself) climbs past a threshold it duty-cycles them with
+// suspend/resume so they only run for part of each period. the stall this causes is tracked so it can be shown
+class RenderThrottle {
+public:
+	RenderThrottle(bool enabled, float load_threshold);
+
+	void attach(int vspipe_pid, int ffmpeg_pid);
+
+	// call regularly from the render loop. suspends/resumes the children as needed. while the render is manually
+	// paused nothing is touched and the pause doesn't count towards throttled time
+	void update(bool paused);
+
+	// makes sure the children are running again, e.g. before killing them
+	void release();
+
+	[[nodiscard]] bool is_enabled() const {
+		return m_enabled;
+	}
+
+	[[nodiscard]] bool is_suspended() const {
+		return m_suspended;
+	}
+
+	// total time the render has spent suspended by the throttle
+	[[nodiscard]] std::chrono::duration<double> get_throttled_time() const {
+		return m_throttled_time;
+	}
+
+private:
+	static constexpr auto SAMPLE_INTERVAL = std::chrono::seconds(1);
+	static constexpr auto DUTY_PERIOD = std::chrono::milliseconds(1000);
+	static constexpr float PAUSE_STEP = 0.2f;
+	static constexpr float MAX_PAUSE_FRACTION = 0.8f; // always let the render crawl forward a bit
+
+	bool m_enabled;
+	float m_load_threshold;
+
+	int m_vspipe_pid = -1;
+	int m_ffmpeg_pid = -1;
+
+	std::chrono::steady_clock::time_point m_sample_start;
+	std::optional<double> m_sample_system_cpu;
+	std::optional<double> m_sample_render_cpu;
+
+	float m_pause_fraction = 0.f;
+	std::chrono::steady_clock::time_point m_period_start;
+
+	bool m_suspended = false;
+	std::chrono::steady_clock::time_point m_suspend_start;
+	std::chrono::duration<double> m_throttled_time{};
+
+	void start_sample();
+	void sample();
+	std::optional<double> get_render_cpu_time() const;
+	void set_suspended(bool suspended);
+};
@@ -1,15 +1,106 @@
 ﻿#include "rendering.h"
 #include "config_presets.h"
+#include "cpu_balancer.h"
+#include "render_throttle.h"
+#include "processes.h"
+#include "event_sink.h"
+#include "source_analysis.h"
+#include "weighting.h"
 #include "utils.h"
 
 #ifdef __linux__
 #	include "config_app.h"
 #endif
 
+namespace {
+	boost::process::environment get_render_environment() {
+		boost::process::environment env = boost::this_process::environment();
+
+#if defined(__APPLE__)
+		if (blur.used_installer) {
+			env["PYTHONHOME"] = (blur.resources_path / "python").native();
+			env["PYTHONPATH"] = (blur.resources_path / "python/lib/python3.12/site-packages").native();
+		}
+#endif
+
+#if defined(__linux__)
+		auto app_config = config_app::get_app_config();
+		if (!app_config.vapoursynth_lib_path.empty()) {
+			env["LD_LIBRARY_PATH"] = app_config.vapoursynth_lib_path;
+			env["PYTHONPATH"] = app_config.vapoursynth_lib_path + "/python3.12/site-packages";
+		}
+#endif
+
+		return env;
+	}
+
+	// "output" stays the main one, fan-out renders and renditions list the rest alongside it
+	nlohmann::json with_extra_outputs(nlohmann::json event, const Render& render) {
+		for (const auto& branch : render.get_branches())
+			event["branch_outputs"].push_back(std::format("{}", branch.output_path));
+
+		for (const auto& rendition : render.get_renditions())
+			event["rendition_outputs"].push_back(std::format("{}", rendition.output_path));
+
+		return event;
+	}
+
+	// 8-bit planar yuv lutyuv handles. it clamps the yuvj ones to full range and the rest to limited whatever the
+	// video's tagged as, so the range has to match the format for it to give the same picture as blur.py
+	const std::vector<std::string> LUT_PIX_FMTS = { "yuv420p", "yuv422p", "yuv444p" };
+	const std::vector<std::string> LUT_FULL_RANGE_PIX_FMTS = { "yuvj420p", "yuvj422p", "yuvj444p" };
+
+	// filters.tweak in blur.py as a lutyuv: luma scaled around the bottom of its range with brightness a fraction of
+	// the range, chroma scaled around the middle. lut truncates, so round first
+	std::wstring get_tweak_lut(bool is_full_color_range, float brightness, float contrast, float saturation) {
+		int luma_min = is_full_color_range ? 0 : 16;
+		int luma_max = is_full_color_range ? 255 : 235;
+		int chroma_min = is_full_color_range ? 0 : 16;
+		int chroma_max = is_full_color_range ? 255 : 240;
+		int chroma_mid = (chroma_min + chroma_max + 1) / 2;
+
+		std::wstring luma = L"val";
+		if (brightness != 0.f || contrast != 1.f) {
+			double offset = luma_min + (static_cast<double>(brightness) * (luma_max - luma_min));
+			luma = std::format(L"clip((val-{})*{}+{},{},{})+0.5", luma_min, contrast, offset, luma_min, luma_max);
+		}
+
+		std::wstring chroma = L"val";
+		if (saturation != 1.f) {
+			chroma = std::format(
+				L"clip((val-{})*{}+{},{},{})+0.5", chroma_mid, saturation, chroma_mid, chroma_min, chroma_max
+			);
+		}
+
+		return std::format(L"lutyuv=y='{}':u='{}':v='{}'", luma, chroma, chroma);
+	}
+
+	// same as get_blur_frames in blur.py
+	int get_blur_frames(const BlurSettings& settings, double fps) {
+		if (!settings.blur || settings.blur_amount <= 0.f)
+			return 0;
+
+		int frame_gap = static_cast<int>(fps / settings.blur_output_fps);
+		int blur_frames = static_cast<int>(frame_gap * settings.blur_amount);
+
+		// number of weights must be odd
+		if (blur_frames > 0 && blur_frames % 2 == 0)
+			blur_frames++;
+
+		return blur_frames;
+	}
+}
+
 bool Rendering::render_next_video() {
 	if (m_queue.empty())
 		return false;
 
+	render_front();
+
+	return true;
+}
+
+tl::expected<RenderResult, std::string> Rendering::render_front() {
 	auto& render = m_queue.front();
 	auto* render_ptr = render.get();
 
@@ -21,6 +112,18 @@ bool Rendering::render_next_video() {
 
 	rendering.call_progress_callback();
 
+	event_sink.emit(
+		"started",
+		with_extra_outputs(
+			{
+				{ "render_id", render->get_render_id() },
+				{ "input", std::format("{}", render->get_input_video_path()) },
+				{ "output", std::format("{}", render->get_output_video_path()) },
+			},
+			*render
+		)
+	);
+
 	tl::expected<RenderResult, std::string> render_result;
 	try {
 		render_result = render->render();
@@ -32,6 +135,31 @@ bool Rendering::render_next_video() {
 	}
 	catch (const std::exception& e) {
 		u::log("Render exception: {}", e.what());
+		render_result = tl::unexpected(std::format("Render exception: {}", e.what()));
+	}
+
+	if (!render_result) {
+		event_sink.emit(
+			"failed",
+			{
+				{ "render_id", render->get_render_id() },
+				{ "error", render_result.error() },
+				{ "vspipe_stderr", render->get_vspipe_stderr() },
+				{ "ffmpeg_stderr", render->get_ffmpeg_stderr() },
+			}
+		);
+	}
+	else {
+		event_sink.emit(
+			render_result->stopped ? "stopped" : "finished",
+			with_extra_outputs(
+				{
+					{ "render_id", render->get_render_id() },
+					{ "output", std::format("{}", render->get_output_video_path()) },
+				},
+				*render
+			)
+		);
 	}
 
 	rendering.call_render_finished_callback(
@@ -48,7 +176,71 @@ bool Rendering::render_next_video() {
 
 	rendering.call_progress_callback();
 
-	return true;
+	return render_result;
+}
+
+std::optional<std::string> Rendering::render_job(const Job& job, const std::function<void(Render&)>& on_created) {
+	// renders report their own failure event, these never get that far
+	auto reject = [&](const std::string& error) {
+		u::log(error);
+		event_sink.emit("failed", { { "job_id", job.id }, { "error", error } });
+		return error;
+	};
+
+	if (!std::filesystem::exists(job.input))
+		return reject(std::format("Video '{}' was not found", job.input));
+
+	auto video_info = u::get_video_info(job.input);
+	if (!video_info.has_video_stream)
+		return reject(std::format("Video '{}' is not a valid video or is unreadable", job.input));
+
+	if (job.config && !std::filesystem::exists(*job.config))
+		return reject(std::format("Config file '{}' was not found", *job.config));
+
+	auto create_output_folder = [](const std::optional<std::filesystem::path>& output) -> std::optional<std::string> {
+		if (!output || output->parent_path().empty())
+			return {};
+
+		std::error_code ec;
+		std::filesystem::create_directories(output->parent_path(), ec);
+		if (ec)
+			return std::format("Failed to create output folder '{}': {}", output->parent_path(), ec.message());
+
+		return {};
+	};
+
+	for (const auto& branch : job.branches) {
+		if (!std::filesystem::exists(branch.config))
+			return reject(std::format("Config file '{}' was not found", branch.config));
+
+		if (auto error = create_output_folder(branch.output))
+			return reject(*error);
+	}
+
+	if (auto error = create_output_folder(job.output))
+		return reject(*error);
+
+	Render render(job.input, video_info, job.output, job.config);
+
+	for (const auto& branch : job.branches) {
+		auto branch_res = render.add_branch(branch.config, branch.output);
+		if (!branch_res)
+			return reject(branch_res.error());
+	}
+
+	if (on_created)
+		on_created(render);
+
+	queue_render(std::move(render));
+
+	auto result = render_front();
+	if (!result)
+		return result.error();
+
+	if (result->stopped)
+		return "Render was stopped";
+
+	return {};
 }
 
 Render& Rendering::queue_render(Render&& render) {
@@ -56,39 +248,62 @@ Render& Rendering::queue_render(Render&& render) {
 	auto& added = *m_queue.emplace_back(std::make_unique<Render>(std::move(render)));
 	unlock();
 
+	nlohmann::json queued_event = {
+		{ "render_id", added.get_render_id() },
+		{ "input", std::format("{}", added.get_input_video_path()) },
+		{ "output", std::format("{}", added.get_output_video_path()) },
+	};
+
+	queued_event = with_extra_outputs(std::move(queued_event), added);
+
+	if (auto estimate = added.get_estimate()) {
+		queued_event["estimated_time"] = estimate->wall_time;
+		queued_event["estimated_peak_memory"] = estimate->peak_memory;
+	}
+
+	event_sink.emit("queued", std::move(queued_event));
+
 	return added;
 }
 
-void Render::build_output_filename() {
+std::filesystem::path Render::build_output_filename(const BlurSettings& settings, bool detailed) const {
 	auto output_folder = this->m_video_folder / this->m_app_settings.output_prefix;
-	std::filesystem::create_directories(output_folder);
+
+	// a folder that can't be made shows up as ffmpeg failing to open the output
+	std::error_code ec;
+	std::filesystem::create_directories(output_folder, ec);
+
+	// other outputs of this render don't exist yet, but they're taken too
+	auto is_taken = [&](const std::filesystem::path& path) {
+		return std::filesystem::exists(path) || path == m_output_path ||
+		       std::ranges::any_of(m_branches, [&](const RenderBranch& branch) {
+				   return branch.output_path == path;
+			   });
+	};
 
 	// build output filename
+	std::filesystem::path output_path;
 	int num = 1;
 	do {
 		std::string output_filename = this->m_video_name + " - blur";
 
-		if (this->m_settings.detailed_filenames) {
+		if (detailed) {
 			std::string extra_details;
 
 			// stupid
-			if (this->m_settings.blur) {
-				if (this->m_settings.interpolate) {
+			if (settings.blur) {
+				if (settings.interpolate) {
 					extra_details = std::format(
-						"{}fps ({}, {})",
-						this->m_settings.blur_output_fps,
-						this->m_settings.interpolated_fps,
-						this->m_settings.blur_amount
+						"{}fps ({}, {})", settings.blur_output_fps, settings.interpolated_fps, settings.blur_amount
 					);
 				}
 				else {
-					extra_details =
-						std::format("{}fps ({})", this->m_settings.blur_output_fps, this->m_settings.blur_amount);
+					extra_details = std::format("{}fps ({})", settings.blur_output_fps, settings.blur_amount);
 				}
 			}
 			else {
-				if (this->m_settings.interpolate) {
-					extra_details = std::format("{}fps", this->m_settings.interpolated_fps);
+				if (settings.interpolate) {
+					extra_details = std::format("{}fps", settings.interpolated_fps);
 				}
 			}
 
@@ -100,13 +315,15 @@ void Render::build_output_filename() {
 		if (num > 1)
 			output_filename += std::format(" ({})", num);
 
-		output_filename += "." + this->m_settings.advanced.video_container;
+		output_filename += "." + settings.advanced.video_container;
 
-		this->m_output_path = output_folder / output_filename;
+		output_path = output_folder / output_filename;
 
 		num++;
 	}
-	while (std::filesystem::exists(this->m_output_path));
+	while (is_taken(output_path));
+
+	return output_path;
 }
 
 Render::Render(
@@ -130,7 +347,7 @@ Render::Render(
 
 	// parse config file (do it now, not when rendering. nice for batch rendering the same file with different settings)
 	auto config_res = config_blur::get_config(
-		config_path.has_value() ? output_path.value() : config_blur::get_config_filename(m_video_folder),
+		config_path.has_value() ? config_path.value() : config_blur::get_config_filename(m_video_folder),
 		!config_path.has_value() // use global only if no config path is specified
 	);
 
@@ -138,13 +355,198 @@ Render::Render(
 	this->m_is_global_config = config_res.is_global;
 
 	this->m_app_settings = config_app::get_app_config();
+	this->m_background = m_app_settings.background_rendering;
 
 	if (output_path.has_value())
 		this->m_output_path = output_path.value();
 	else {
 		// note: this uses settings, so has to be called after they're loaded
-		build_output_filename();
+		this->m_output_path = build_output_filename(m_settings, m_settings.detailed_filenames);
 	}
+
+	this->m_estimate = render_history::estimate(m_video_info, m_settings);
+}
+
+tl::expected<void, std::string> Render::add_branch(
+	const std::filesystem::path& config_path, const std::optional<std::filesystem::path>& output_path
+) {
+	auto config_res = config_blur::get_config(config_path, false);
+	const BlurSettings& settings = config_res.config;
+
+	// only what comes after the interpolation can differ
+	if (config_blur::get_source_pass_settings(m_settings) != config_blur::get_source_pass_settings(settings)) {
+		return tl::unexpected(
+			std::format(
+				"Config '{}' can't share a pass with the main one, only blur, filter and encoding settings can differ",
+				config_path
+			)
+		);
+	}
+
+	// branches are interleaved into one stream at a common frame rate, so they need a fixed one
+	if (!m_settings.blur || !settings.blur)
+		return tl::unexpected("Every config needs blur enabled to render them together");
+
+	m_branches.push_back({
+		.settings = settings,
+		.output_path = output_path ? *output_path : build_output_filename(settings, true),
+	});
+
+	return {};
+}
+
+std::vector<std::filesystem::path> Render::get_output_paths() const {
+	std::vector<std::filesystem::path> paths = { m_output_path };
+	for (const auto& branch : m_branches)
+		paths.push_back(branch.output_path);
+
+	for (const auto& rendition : m_renditions)
+		paths.push_back(rendition.output_path);
+
+	return paths;
+}
+
+tl::expected<void, std::string> Render::prepare_renditions() {
+	m_renditions.clear();
+
+	auto renditions = config_blur::parse_renditions(m_settings);
+	if (!renditions)
+		return tl::unexpected(renditions.error());
+
+	if (renditions->empty())
+		return {};
+
+	if (!m_branches.empty() || m_stream || m_live || m_frame_range) {
+		u::log("Renditions are only made for regular renders, skipping them");
+		return {};
+	}
+
+	for (auto& rendition : *renditions) {
+		// named after the main output so they sort together
+		auto label = rendition.get_label();
+		auto output_path = m_output_path.parent_path() /
+		                   std::format("{} [{}].{}", m_output_path.stem(), label, rendition.container);
+
+		auto taken = get_output_paths();
+		for (int num = 2; std::ranges::find(taken, output_path) != taken.end(); num++) {
+			output_path = m_output_path.parent_path() /
+			              std::format("{} [{}] ({}).{}", m_output_path.stem(), label, num, rendition.container);
+		}
+
+		m_renditions.push_back({
+			.rendition = std::move(rendition),
+			.output_path = output_path,
+		});
+	}
+
+	return {};
+}
+
+bool Render::uses_source_analysis() const {
+	// live and streamed sources aren't all there yet to analyse
+	return source_analysis::is_needed(m_settings) && !m_live && !m_stream;
+}
+
+bool Render::prepare_source_analysis() {
+	if (!uses_source_analysis())
+		return true;
+
+	auto analysis_path = source_analysis::get_path(m_video_path);
+	if (!analysis_path || source_analysis::is_current(*analysis_path))
+		return true;
+
+	u::log("Analysing '{}' for duplicate frames (only needed once per video)", m_video_name);
+
+	auto start = std::chrono::steady_clock::now();
+
+	auto analysed = source_analysis::analyse(m_video_path, m_video_info, *analysis_path, [this] {
+		return m_to_kill;
+	});
+
+	if (!analysed) {
+		// blur.py measures it itself when it's missing, just slower
+		u::log_error("Native analysis failed, leaving it to vapoursynth");
+		if (blur.verbose || m_settings.advanced.debug)
+			u::log(analysed.error());
+
+		return true;
+	}
+
+	if (!*analysed)
+		return false;
+
+	std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+	DEBUG_LOG("source analysis took {:.2f}s", elapsed.count());
+
+	return true;
+}
+
+bool Render::prepare_interpolation_cache() {
+	m_cache_entry.reset();
+
+	// only worth it when there's interpolation to skip, and streamed or partial renders never see the whole video
+	if (!m_app_settings.interpolation_cache || !m_settings.interpolate || m_live || m_stream || m_frame_range)
+		return true;
+
+	auto key = interpolation_cache::get_key(m_video_path, m_settings);
+	if (!key)
+		return true;
+
+	if (auto entry = interpolation_cache::find(*key)) {
+		u::log("Using cached interpolation");
+		m_cache_entry = entry;
+		return true;
+	}
+
+	// not worth a second pass over the whole video if it'd just be evicted, or fill the disk getting there
+	uint64_t max_bytes = m_app_settings.get_interpolation_cache_bytes();
+	auto estimated_size = interpolation_cache::estimate_size(m_settings, m_video_info);
+	if (estimated_size && *estimated_size > max_bytes) {
+		u::log(
+			"Interpolation would take about {:.1f} GB to cache, more than the cache's limit, rendering without it",
+			*estimated_size / (1024.0 * 1024.0 * 1024.0)
+		);
+		return true;
+	}
+
+	u::log("Interpolating into the cache first, later renders with the same interpolation settings will skip it");
+
+	// make room up front rather than after, so the cache never goes over while it's written
+	interpolation_cache::evict(max_bytes - estimated_size.value_or(0));
+
+	m_cache_entry = interpolation_cache::get_pending(*key);
+	m_writing_cache = true;
+	auto commands = build_render_commands();
+	auto pass = commands ? do_render(*commands) : tl::unexpected(commands.error());
+	m_writing_cache = false;
+
+	m_cache_entry.reset();
+
+	if (!pass || pass->stopped) {
+		interpolation_cache::discard_pending(*key);
+
+		if (pass)
+			return false;
+
+		// not worth failing the render over, it can still interpolate as usual
+		u::log_error("Failed to cache interpolation, rendering without it");
+		if (blur.verbose || m_settings.advanced.debug)
+			u::log(pass.error());
+
+		return true;
+	}
+
+	auto entry = interpolation_cache::commit(*key);
+	if (!entry) {
+		u::log_error(entry.error());
+		return true;
+	}
+
+	m_cache_entry = *entry;
+
+	interpolation_cache::evict(m_app_settings.get_interpolation_cache_bytes(), *key);
+
+	return true;
 }
 
 bool Render::create_temp_path() {
@@ -185,6 +587,10 @@ tl::expected<RenderCommands, std::string> Render::build_render_commands() {
 	std::wstring path_string = m_video_path.wstring();
 	std::ranges::replace(path_string, '\\', '/');
 
+	auto thread_counts = CpuBalancer::get_thread_counts(
+		m_settings.gpu_encoding, m_app_settings.balance_render_cpu && CpuBalancer::can_rebalance()
+	);
+
 	// Build vspipe command
 	commands.vspipe = { L"-p",
 		                L"-c",
@@ -200,6 +606,8 @@ tl::expected<RenderCommands, std::string> Render::build_render_commands() {
 		                    (m_video_info.color_range ? u::towstring(*m_video_info.color_range) : L"undefined"),
 		                L"-a",
 		                L"settings=" + u::towstring(settings_json->dump()),
+		                L"-a",
+		                std::format(L"vs_threads={}", thread_counts.vapoursynth),
 #if defined(__APPLE__)
 		                L"-a",
 		                std::format(L"macos_bundled={}", blur.used_installer ? L"true" : L"false"),
@@ -215,62 +623,576 @@ tl::expected<RenderCommands, std::string> Render::build_render_commands() {
 		                blur_script_path.wstring(),
 		                L"-" };
 
-	// Build ffmpeg command
-	commands.ffmpeg = { L"-loglevel",
-		                L"error",
-		                L"-hide_banner",
-		                L"-stats",
-		                L"-y",
-		                L"-i",
-		                L"-", // piped output from video script
-		                L"-fflags",
-		                L"+genpts",
-		                L"-i",
-		                m_video_path.wstring(), // original video (for audio)
-		                L"-map",
-		                L"0:v",
-		                L"-map",
-		                L"1:a?" };
+	if (m_frame_range) {
+		commands.vspipe.insert(
+			commands.vspipe.begin(),
+			{ L"-s", std::to_wstring(m_frame_range->start), L"-e", std::to_wstring(m_frame_range->end) }
+		);
+	}
+
+	if (!m_branches.empty()) {
+		nlohmann::json branches = nlohmann::json::array();
+		for (const auto& branch : m_branches) {
+			auto branch_json = branch.settings.to_json();
+			if (!branch_json)
+				return tl::unexpected(branch_json.error());
+
+			branches.push_back(*branch_json);
+		}
+
+		commands.vspipe.insert(commands.vspipe.begin(), { L"-a", L"branches=" + u::towstring(branches.dump()) });
+	}
+
+	auto to_arg = [](const std::filesystem::path& path) {
+		std::wstring arg = path.wstring();
+		std::ranges::replace(arg, '\\', '/');
+		return arg;
+	};
+
+	// cached interpolation already has dupes filled in
+	if (uses_source_analysis() && (!m_cache_entry || m_writing_cache)) {
+		if (auto analysis_path = source_analysis::get_path(m_video_path))
+			commands.vspipe.insert(commands.vspipe.begin(), { L"-a", L"analysis_path=" + to_arg(*analysis_path) });
+	}
+
+	// vapoursynth's frame cache gets sized in bytes from this. half the ram leaves room for ffmpeg and everything else
+	if (auto total_memory = processes::get_total_memory()) {
+		commands.vspipe.insert(
+			commands.vspipe.begin(), { L"-a", std::format(L"memory_budget={}", *total_memory / 2) }
+		);
+	}
+
+	if (m_cache_entry) {
+
+		if (m_writing_cache) {
+			// lossless and intra-only so the blur pass reads back exactly what it would have interpolated
+			commands.vspipe.insert(
+				commands.vspipe.begin(), { L"-a", L"interp_cache_write=" + to_arg(m_cache_entry->meta_path) }
+			);
+
+			commands.ffmpeg = { L"-loglevel",
+				                L"error",
+				                L"-hide_banner",
+				                L"-stats",
+				                L"-y",
+				                L"-i",
+				                L"-",
+				                L"-map",
+				                L"0:v",
+				                L"-c:v",
+				                L"ffv1",
+				                L"-level",
+				                L"3",
+				                L"-slices",
+				                L"16",
+				                L"-g",
+				                L"1",
+				                L"-threads",
+				                std::to_wstring(thread_counts.ffmpeg),
+				                L"-f",
+				                L"matroska",
+				                m_cache_entry->video_path.wstring() };
+
+			add_preview_args(commands);
+
+			return commands;
+		}
+
+		commands.vspipe.insert(
+			commands.vspipe.begin(),
+			{ L"-a",
+		      L"interp_cache=" + to_arg(m_cache_entry->video_path),
+		      L"-a",
+		      L"interp_cache_meta=" + to_arg(m_cache_entry->meta_path) }
+		);
+	}
+
+	if (m_live) {
+		// frames come in on vspipe's stdin instead of from the file
+		commands.vspipe.insert(commands.vspipe.begin(), { L"-a", L"live=true" });
+	}
+
+	if (m_stream) {
+		double source_fps = static_cast<double>(m_video_info.fps_num) / m_video_info.fps_den;
+		int lookahead = stream_output::get_lookahead_frames(m_settings, source_fps);
+		int requests = stream_output::get_max_requests(
+			*m_stream, lookahead * 1000.0 / source_fps, stream_output::get_output_fps(m_settings, source_fps)
+		);
+
+		commands.vspipe.insert(
+			commands.vspipe.begin(),
+			{ L"-a",
+		      L"stream=true",
+		      L"-a",
+		      std::format(L"stream_lookahead={}", lookahead),
+		      L"-r",
+		      std::to_wstring(requests) }
+		);
+	}
+
+	// Build ffmpeg command
+	commands.ffmpeg = { L"-loglevel",
+		                L"error",
+		                L"-hide_banner",
+		                L"-stats",
+		                L"-y",
+		                L"-i",
+		                L"-" }; // piped output from video script
+
+	if (m_stream) {
+		// don't sit on input while probing it, y4m has everything in its header
+		commands.ffmpeg.insert(
+			commands.ffmpeg.end() - 2, { L"-fflags", L"+nobuffer", L"-probesize", L"32", L"-analyzeduration", L"0" }
+		);
+	}
+
+	// handle colour metadata tagging
+	// (vspipe strips this input info, need to define it manually so ffmpeg knows about it)
+	std::vector<std::string> params;
+
+	if (m_video_info.color_range) {
+		std::string range = *m_video_info.color_range == "pc" ? "full" : "limited";
+		params.emplace_back("range=" + range);
+	}
+
+	if (m_video_info.color_space) {
+		params.emplace_back("colorspace=" + *m_video_info.color_space);
+	}
+
+	if (m_video_info.color_transfer) {
+		params.emplace_back("color_trc=" + *m_video_info.color_transfer);
+	}
+
+	if (m_video_info.color_primaries) {
+		params.emplace_back("color_primaries=" + *m_video_info.color_primaries);
+	}
+
+	std::string setparams_filter;
+	if (!params.empty()) {
+		setparams_filter = "setparams=";
+		for (size_t i = 0; i < params.size(); ++i) {
+			if (i > 0)
+				setparams_filter += ":";
+			setparams_filter += params[i];
+		}
+	}
+
+	if (!m_branches.empty() || !m_renditions.empty()) {
+		commands.ffmpeg.insert(
+			commands.ffmpeg.end(),
+			{ L"-fflags",
+		      L"+genpts",
+		      L"-i",
+		      m_video_path.wstring() } // original video (for audio)
+		);
+
+		if (!m_branches.empty()) {
+			auto fan_out_args = build_fan_out_ffmpeg_args(u::towstring(setparams_filter), thread_counts.ffmpeg);
+			commands.ffmpeg.insert(commands.ffmpeg.end(), fan_out_args.begin(), fan_out_args.end());
+		}
+		else {
+			auto rendition_args = build_rendition_ffmpeg_args(u::towstring(setparams_filter), thread_counts.ffmpeg);
+			commands.ffmpeg.insert(commands.ffmpeg.end(), rendition_args.begin(), rendition_args.end());
+
+			add_preview_args(commands);
+		}
+
+		return commands;
+	}
+
+	// live audio is split off by the decoder and muxed back in once the render's done. streams are video only
+	if (m_frame_range || m_live || m_stream) {
+		commands.ffmpeg.insert(commands.ffmpeg.end(), { L"-map", L"0:v", L"-an" });
+	}
+	else {
+		commands.ffmpeg.insert(
+			commands.ffmpeg.end(),
+			{ L"-fflags",
+		      L"+genpts",
+		      L"-i",
+		      m_video_path.wstring(), // original video (for audio)
+		      L"-map",
+		      L"0:v",
+		      L"-map",
+		      L"1:a?" }
+		);
+	}
+
+	if (!setparams_filter.empty()) {
+		commands.ffmpeg.emplace_back(L"-vf");
+		commands.ffmpeg.emplace_back(u::towstring(setparams_filter));
+	}
+
+	if (m_video_info.pix_fmt) {
+		commands.ffmpeg.emplace_back(L"-pix_fmt");
+		commands.ffmpeg.emplace_back(u::towstring(*m_video_info.pix_fmt));
+	}
+
+	if (!m_frame_range && !m_live && !m_stream) {
+		auto audio_filter_args = build_audio_filter_args();
+		commands.ffmpeg.insert(commands.ffmpeg.end(), audio_filter_args.begin(), audio_filter_args.end());
+	}
+
+	auto encoder_args = build_encoder_args(m_settings, thread_counts.ffmpeg);
+	commands.ffmpeg.insert(commands.ffmpeg.end(), encoder_args.begin(), encoder_args.end());
+
+	// Output path
+	if (m_stream) {
+		auto muxer_args = stream_output::get_muxer_args(*m_stream);
+		commands.ffmpeg.insert(commands.ffmpeg.end(), muxer_args.begin(), muxer_args.end());
+	}
+	else {
+		commands.ffmpeg.push_back(!m_live_video_path.empty() ? m_live_video_path.wstring() : m_output_path.wstring());
+	}
+
+	add_preview_args(commands);
+
+	return commands;
+}
+
+void Render::add_preview_args(RenderCommands& commands, const std::wstring& source) const {
+	if (!m_settings.preview || !blur.using_preview)
+		return;
+
+	commands.ffmpeg.insert(
+		commands.ffmpeg.end(),
+		{ L"-map",
+	      source,
+	      L"-q:v",
+	      L"2",
+	      L"-update",
+	      L"1",
+	      L"-atomic_writing",
+	      L"1",
+	      L"-y",
+	      m_preview_path.wstring() }
+	);
+}
+
+bool Render::can_skip_vapoursynth() const {
+	if (m_settings.interpolate || (m_settings.deduplicate && m_settings.advanced.deduplicate_range != 0))
+		return false;
+
+	// these all rely on vspipe (stdin input, frame ranges, latency reports, interleaved outputs)
+	if (m_live || m_stream || m_frame_range || !m_branches.empty() || !m_renditions.empty())
+		return false;
+
+	if (m_video_info.fps_num <= 0 || m_video_info.fps_den <= 0)
+		return false;
+
+	double fps = static_cast<double>(m_video_info.fps_num) / m_video_info.fps_den;
+	if (m_settings.timescale)
+		fps *= m_settings.output_timescale / m_settings.input_timescale;
+
+	if (int blur_frames = get_blur_frames(m_settings, fps); blur_frames > 0) {
+		// tmix blends the encoded values, gamma needs the float path
+		if (m_settings.blur_gamma != 1.f || !weighting::get_integer_weights(m_settings.blur_weighting, blur_frames))
+			return false;
+	}
+
+	bool filtering = m_settings.filters &&
+	                 (m_settings.brightness != 1.f || m_settings.contrast != 1.f || m_settings.saturation != 1.f);
+	if (filtering) {
+		if (!m_video_info.pix_fmt)
+			return false;
+
+		bool is_full_color_range = m_video_info.color_range == "pc";
+		if (!u::contains(is_full_color_range ? LUT_FULL_RANGE_PIX_FMTS : LUT_PIX_FMTS, *m_video_info.pix_fmt))
+			return false;
+	}
+
+	return true;
+}
+
+std::wstring Render::build_ffmpeg_only_filters() const {
+	std::vector<std::wstring> filters;
+
+	// scaled first like blur.py does, so the rest runs on fewer pixels
+	auto [width, height] = config_blur::get_working_size(m_settings, m_video_info.width, m_video_info.height);
+	if (width != m_video_info.width || height != m_video_info.height)
+		filters.push_back(std::format(L"scale={}:{}:flags=lanczos", width, height));
+
+	double fps = static_cast<double>(m_video_info.fps_num) / m_video_info.fps_den;
+
+	if (m_settings.timescale) {
+		double speed = m_settings.output_timescale / m_settings.input_timescale;
+		if (speed != 1.0) {
+			fps *= speed;
+			filters.push_back(std::format(L"setpts=PTS/{}", speed));
+
+			if (!m_settings.blur)
+				filters.push_back(std::format(L"fps={}", fps));
+		}
+	}
+
+	if (m_settings.blur) {
+		if (int blur_frames = get_blur_frames(m_settings, fps); blur_frames > 0) {
+			auto weights = weighting::get_integer_weights(m_settings.blur_weighting, blur_frames);
+
+			std::wstring weights_string;
+			for (int weight : *weights)
+				weights_string += std::format(L"{}{}", weights_string.empty() ? L"" : L" ", weight);
+
+			// tmix mixes each frame with the ones before it (the first is repeated to fill in), blur.py centres the
+			// window on the frame. padding the end and dropping the first radius frames lines it up the same way
+			int radius = blur_frames / 2;
+			filters.push_back(std::format(L"tpad=stop={}:stop_mode=clone", radius));
+			filters.push_back(std::format(L"tmix=frames={}:weights='{}'", blur_frames, weights_string));
+			filters.push_back(std::format(L"trim=start_frame={}", radius));
+			filters.emplace_back(L"setpts=PTS-STARTPTS");
+		}
+
+		filters.push_back(std::format(L"fps={}", m_settings.blur_output_fps));
+	}
+
+	if (m_settings.filters &&
+	    (m_settings.brightness != 1.f || m_settings.contrast != 1.f || m_settings.saturation != 1.f))
+	{
+		filters.push_back(
+			get_tweak_lut(
+				m_video_info.color_range == "pc",
+				m_settings.brightness - 1.f,
+				m_settings.contrast,
+				m_settings.saturation
+			)
+		);
+	}
+
+	return u::join(filters, L",");
+}
+
+int Render::get_ffmpeg_only_frame_count() const {
+	double duration = m_video_info.duration;
+	double fps = static_cast<double>(m_video_info.fps_num) / m_video_info.fps_den;
+
+	if (m_settings.timescale) {
+		double speed = m_settings.output_timescale / m_settings.input_timescale;
+		duration /= speed;
+		fps *= speed;
+	}
+
+	if (m_settings.blur)
+		fps = m_settings.blur_output_fps;
+
+	return static_cast<int>(std::round(duration * fps));
+}
+
+tl::expected<RenderCommands, std::string> Render::build_ffmpeg_only_commands() {
+	RenderCommands commands;
+
+	// progress comes from -progress on stdout instead of vspipe
+	commands.ffmpeg = { L"-loglevel",
+		                L"error",
+		                L"-hide_banner",
+		                L"-nostats",
+		                L"-progress",
+		                L"pipe:1",
+		                L"-y",
+		                L"-i",
+		                m_video_path.wstring() };
+
+	auto filters = build_ffmpeg_only_filters();
+	bool preview = m_settings.preview && blur.using_preview;
+
+	if (preview) {
+		commands.ffmpeg.insert(
+			commands.ffmpeg.end(),
+			{ L"-filter_complex",
+		      std::format(L"[0:v]{},split=2[v][preview]", filters.empty() ? L"null" : filters),
+		      L"-map",
+		      L"[v]" }
+		);
+	}
+	else {
+		commands.ffmpeg.insert(commands.ffmpeg.end(), { L"-map", L"0:v" });
+
+		if (!filters.empty())
+			commands.ffmpeg.insert(commands.ffmpeg.end(), { L"-vf", filters });
+	}
+
+	commands.ffmpeg.insert(commands.ffmpeg.end(), { L"-map", L"0:a?" });
+
+	if (m_video_info.pix_fmt) {
+		commands.ffmpeg.emplace_back(L"-pix_fmt");
+		commands.ffmpeg.emplace_back(u::towstring(*m_video_info.pix_fmt));
+	}
+
+	auto audio_filter_args = build_audio_filter_args();
+	commands.ffmpeg.insert(commands.ffmpeg.end(), audio_filter_args.begin(), audio_filter_args.end());
+
+	// nothing else running, ffmpeg gets every core
+	auto encoder_args = build_encoder_args(m_settings, processes::get_core_count());
+	commands.ffmpeg.insert(commands.ffmpeg.end(), encoder_args.begin(), encoder_args.end());
+
+	commands.ffmpeg.push_back(m_output_path.wstring());
+
+	if (preview)
+		add_preview_args(commands, L"[preview]");
+
+	return commands;
+}
+
+std::vector<std::wstring> Render::build_rendition_ffmpeg_args(const std::wstring& setparams_filter, int threads) const {
+	size_t outputs = m_renditions.size() + 1;
+
+	std::wstring filter_complex = std::format(L"[0:v]split={}[s0]", outputs);
+	for (size_t i = 0; i < m_renditions.size(); i++)
+		filter_complex += std::format(L"[s{}]", i + 1);
+
+	filter_complex += std::format(L";[s0]{}[o0]", setparams_filter.empty() ? L"null" : setparams_filter);
+
+	for (size_t i = 0; i < m_renditions.size(); i++) {
+		const auto& rendition = m_renditions[i].rendition;
+
+		std::wstring filters;
+		if (rendition.width > 0)
+			filters = std::format(L"scale={}:{}:flags=lanczos", rendition.width, rendition.height);
+		else if (rendition.height > 0)
+			filters = std::format(L"scale=-2:{}:flags=lanczos", rendition.height);
+		else
+			filters = L"null";
+
+		if (!setparams_filter.empty())
+			filters += L"," + setparams_filter;
+
+		filter_complex += std::format(L";[s{}]{}[o{}]", i + 1, filters, i + 1);
+	}
+
+	std::vector<std::wstring> args = { L"-filter_complex", filter_complex };
+
+	auto audio_filter_args = build_audio_filter_args();
+
+	// the encoders share what would have gone to one
+	int encoder_threads = std::max(1, threads / static_cast<int>(outputs));
+
+	for (size_t i = 0; i < outputs; i++) {
+		args.insert(args.end(), { L"-map", std::format(L"[o{}]", i), L"-map", L"1:a?" });
+
+		if (m_video_info.pix_fmt)
+			args.insert(args.end(), { L"-pix_fmt", u::towstring(*m_video_info.pix_fmt) });
+
+		args.insert(args.end(), audio_filter_args.begin(), audio_filter_args.end());
+
+		BlurSettings settings = m_settings;
+		std::filesystem::path output_path = m_output_path;
+
+		if (i > 0) {
+			const auto& rendition = m_renditions[i - 1];
+			settings.encode_preset = rendition.rendition.encode_preset;
+			settings.quality = rendition.rendition.quality;
+			settings.advanced.ffmpeg_override.clear(); // the rendition's preset is what was asked for
+			output_path = rendition.output_path;
+		}
+
+		auto encoder_args = build_encoder_args(settings, encoder_threads);
+		args.insert(args.end(), encoder_args.begin(), encoder_args.end());
+
+		args.push_back(output_path.wstring());
+	}
+
+	return args;
+}
 
-	// handle colour metadata tagging
-	// (vspipe strips this input info, need to define it manually so ffmpeg knows about it)
-	std::vector<std::string> params;
+std::vector<std::wstring> Render::build_encoder_args(const BlurSettings& settings, int threads) const {
+	std::vector<std::string> args;
 
-	if (m_video_info.color_range) {
-		std::string range = *m_video_info.color_range == "pc" ? "full" : "limited";
-		params.emplace_back("range=" + range);
+	if (!settings.advanced.ffmpeg_override.empty()) {
+		args = u::ffmpeg_string_to_args(settings.advanced.ffmpeg_override);
+	}
+	else {
+		args = config_presets::get_preset_params(
+			settings.gpu_encoding ? m_app_settings.gpu_type : "cpu",
+			u::to_lower(settings.encode_preset.empty() ? "h264" : settings.encode_preset),
+			settings.quality
+		);
 	}
 
-	if (m_video_info.color_space) {
-		params.emplace_back("colorspace=" + *m_video_info.color_space);
+	std::vector<std::wstring> encoder_args;
+	for (const auto& arg : args)
+		encoder_args.push_back(u::towstring(arg));
+
+	bool is_override = !settings.advanced.ffmpeg_override.empty();
+
+	if (!is_override && !settings.gpu_encoding) {
+		// otherwise x264/x265 spawn a thread per core and fight vapoursynth for them
+		encoder_args.insert(encoder_args.end(), { L"-threads", std::to_wstring(threads) });
 	}
 
-	if (m_video_info.color_transfer) {
-		params.emplace_back("color_trc=" + *m_video_info.color_transfer);
+	if (m_stream) {
+		auto codec = config_presets::extract_codec_from_args(args);
+		if (codec) {
+			double source_fps = static_cast<double>(m_video_info.fps_num) / m_video_info.fps_den;
+			auto low_delay_args =
+				stream_output::get_low_delay_args(*codec, stream_output::get_output_fps(settings, source_fps));
+			encoder_args.insert(encoder_args.end(), low_delay_args.begin(), low_delay_args.end());
+		}
 	}
+	else if (!is_override) {
+		// audio
+		encoder_args.insert(encoder_args.end(), { L"-c:a", L"aac", L"-b:a", L"320k" });
 
-	if (m_video_info.color_primaries) {
-		params.emplace_back("color_primaries=" + *m_video_info.color_primaries);
+		// extra
+		encoder_args.insert(encoder_args.end(), { L"-movflags", L"+faststart" });
 	}
 
-	if (!params.empty()) {
-		std::string setparams_filter = "setparams=";
-		for (size_t i = 0; i < params.size(); ++i) {
-			if (i > 0)
-				setparams_filter += ":";
-			setparams_filter += params[i];
-		}
+	return encoder_args;
+}
 
-		commands.ffmpeg.emplace_back(L"-vf");
-		commands.ffmpeg.emplace_back(u::towstring(setparams_filter));
+std::vector<std::wstring> Render::build_fan_out_ffmpeg_args(const std::wstring& setparams_filter, int threads) const {
+	std::vector<const BlurSettings*> settings = { &m_settings };
+	for (const auto& branch : m_branches)
+		settings.push_back(&branch.settings);
+
+	auto output_paths = get_output_paths();
+	size_t outputs = settings.size();
+
+	// blur.py brings every branch up to the highest output fps and interleaves them frame by frame, so frame n
+	// belongs to branch n % outputs. pick them back out, then drop the duplicates slower branches were padded with
+	int common_fps = 0;
+	for (const auto* branch_settings : settings)
+		common_fps = std::max(common_fps, branch_settings->blur_output_fps);
+
+	std::wstring filter_complex = std::format(L"[0:v]split={}", outputs);
+	for (size_t i = 0; i < outputs; i++)
+		filter_complex += std::format(L"[s{}]", i);
+
+	for (size_t i = 0; i < outputs; i++) {
+		filter_complex += std::format(L";[s{}]select='eq(mod(n,{}),{})',setpts=N/({}*TB)", i, outputs, i, common_fps);
+
+		if (settings[i]->blur_output_fps != common_fps)
+			filter_complex += std::format(L",fps={}", settings[i]->blur_output_fps);
+
+		if (!setparams_filter.empty())
+			filter_complex += L"," + setparams_filter;
+
+		filter_complex += std::format(L"[o{}]", i);
 	}
 
-	if (m_video_info.pix_fmt) {
-		commands.ffmpeg.emplace_back(L"-pix_fmt");
-		commands.ffmpeg.emplace_back(u::towstring(*m_video_info.pix_fmt));
+	std::vector<std::wstring> args = { L"-filter_complex", filter_complex };
+
+	auto audio_filter_args = build_audio_filter_args();
+
+	// the encoders share what would have gone to one
+	int encoder_threads = std::max(1, threads / static_cast<int>(outputs));
+
+	for (size_t i = 0; i < outputs; i++) {
+		args.insert(args.end(), { L"-map", std::format(L"[o{}]", i), L"-map", L"1:a?" });
+
+		if (m_video_info.pix_fmt)
+			args.insert(args.end(), { L"-pix_fmt", u::towstring(*m_video_info.pix_fmt) });
+
+		args.insert(args.end(), audio_filter_args.begin(), audio_filter_args.end());
+
+		auto encoder_args = build_encoder_args(*settings[i], encoder_threads);
+		args.insert(args.end(), encoder_args.begin(), encoder_args.end());
+
+		args.push_back(output_paths[i].wstring());
 	}
 
-	// Handle audio filters
+	return args;
+}
+
+std::vector<std::wstring> Render::build_audio_filter_args() const {
 	std::vector<std::wstring> audio_filters;
 	if (m_settings.timescale) {
 		if (m_settings.input_timescale != 1.f) {
@@ -301,65 +1223,141 @@ tl::expected<RenderCommands, std::string> Render::build_render_commands() {
 		}
 	}
 
-	if (!audio_filters.empty()) {
-		commands.ffmpeg.emplace_back(L"-af");
-		commands.ffmpeg.push_back(
-			std::accumulate(
-				std::next(audio_filters.begin()),
-				audio_filters.end(),
-				audio_filters[0],
-				[](const std::wstring& a, const std::wstring& b) {
-					return a + L"," + b;
-				}
-			)
-		);
-	}
+	if (audio_filters.empty())
+		return {};
+
+	return { L"-af",
+		     std::accumulate(
+				 std::next(audio_filters.begin()),
+				 audio_filters.end(),
+				 audio_filters[0],
+				 [](const std::wstring& a, const std::wstring& b) {
+					 return a + L"," + b;
+				 }
+			 ) };
+}
+
+tl::expected<int, std::string> Render::get_output_frame_count() {
+	namespace bp = boost::process;
+
+	auto render_commands = build_render_commands();
+	if (!render_commands)
+		return tl::unexpected(render_commands.error());
 
-	if (!m_settings.advanced.ffmpeg_override.empty()) {
-		auto args = u::ffmpeg_string_to_args(m_settings.advanced.ffmpeg_override);
+	// same script and arguments, just asking for info instead of frames
+	std::vector<std::wstring> args = { L"--info" };
+	for (size_t i = 0; i < render_commands->vspipe.size(); i++) {
+		const auto& arg = render_commands->vspipe[i];
+		if (arg == L"-p")
+			continue;
 
-		for (const auto& arg : args) {
-			commands.ffmpeg.push_back(u::towstring(arg));
+		if (arg == L"-c" || arg == L"-s" || arg == L"-e" || arg == L"-r") {
+			i++; // skip value too
+			continue;
 		}
+
+		args.push_back(arg);
 	}
-	else {
-		auto preset_args = config_presets::get_preset_params(
-			m_settings.gpu_encoding ? m_app_settings.gpu_type : "cpu",
-			u::to_lower(m_settings.encode_preset.empty() ? "h264" : m_settings.encode_preset),
-			m_settings.quality
+
+	try {
+		bp::ipstream vspipe_stdout;
+		bp::ipstream vspipe_stderr;
+		bp::child vspipe_process(
+			boost::filesystem::path{ blur.vspipe_path },
+			bp::args(args),
+			bp::std_out > vspipe_stdout,
+			bp::std_err > vspipe_stderr,
+			get_render_environment()
+#ifdef _WIN32
+				,
+			bp::windows::create_no_window
+#endif
 		);
 
-		for (const auto& arg : preset_args)
-			commands.ffmpeg.push_back(u::towstring(arg));
+		std::optional<int> frames;
+		std::string line;
+		while (std::getline(vspipe_stdout, line)) {
+			if (line.starts_with("Frames: ")) {
+				try {
+					frames = std::stoi(line.substr(8));
+				}
+				catch (...) {
+				}
+			}
+		}
 
-		// audio
-		commands.ffmpeg.insert(commands.ffmpeg.end(), { L"-c:a", L"aac", L"-b:a", L"320k" });
+		std::string errors((std::istreambuf_iterator<char>(vspipe_stderr)), std::istreambuf_iterator<char>());
 
-		// extra
-		commands.ffmpeg.insert(commands.ffmpeg.end(), { L"-movflags", L"+faststart" });
-	}
+		vspipe_process.wait();
 
-	// Output path
-	commands.ffmpeg.push_back(m_output_path.wstring());
+		if (vspipe_process.exit_code() != 0 || !frames)
+			return tl::unexpected(std::format("Failed to get output frame count:\n{}", errors));
 
-	// Preview output if needed
-	if (m_settings.preview && blur.using_preview) {
-		commands.ffmpeg.insert(
-			commands.ffmpeg.end(),
-			{ L"-map",
-		      L"0:v",
-		      L"-q:v",
-		      L"2",
-		      L"-update",
-		      L"1",
-		      L"-atomic_writing",
-		      L"1",
-		      L"-y",
-		      m_preview_path.wstring() }
+		return *frames;
+	}
+	catch (const boost::system::system_error& e) {
+		return tl::unexpected(e.what());
+	}
+}
+
+void Render::record_history(const render_history::StageTimings& timings, int64_t peak_memory) {
+	auto now = std::chrono::system_clock::now().time_since_epoch();
+
+	auto [width, height] = config_blur::get_working_size(m_settings, m_video_info.width, m_video_info.height);
+
+	render_history::Entry entry{
+		.timestamp = std::chrono::duration_cast<std::chrono::seconds>(now).count(),
+		.width = width,
+		.height = height,
+		.fps = m_video_info.fps_den > 0 ? static_cast<double>(m_video_info.fps_num) / m_video_info.fps_den : 0.0,
+		.duration = m_video_info.duration,
+		.output_frames = m_status.total_frames,
+		.settings_hash = render_history::hash_settings(m_settings),
+		.pipeline_hash = render_history::hash_pipeline(m_settings),
+		.timings = timings,
+		.throughput = timings.processing > 0.0 ? m_status.total_frames / timings.processing : 0.0,
+		.peak_memory = peak_memory,
+	};
+
+	render_history::record(entry);
+
+	if (m_estimate) {
+		DEBUG_LOG(
+			"render history: estimated {:.1f}s, took {:.1f}s",
+			m_estimate->wall_time,
+			timings.startup + timings.processing + timings.finishing
 		);
 	}
+}
 
-	return commands;
+void Render::report_latency(const stream_output::LatencySummary& summary, bool final) {
+	if (summary.frames == 0)
+		return;
+
+	u::log(
+		"{}latency: p50 {:.0f}ms, p95 {:.0f}ms, p99 {:.0f}ms, max {:.0f}ms over {} frames{}",
+		final ? "stream " : "",
+		summary.p50,
+		summary.p95,
+		summary.p99,
+		summary.max,
+		summary.frames,
+		summary.p95 > static_cast<float>(m_stream->latency_budget.count()) ? " (over budget)" : ""
+	);
+
+	event_sink.emit(
+		"latency",
+		{
+			{ "render_id", m_render_id },
+			{ "final", final },
+			{ "frames", summary.frames },
+			{ "p50", summary.p50 },
+			{ "p95", summary.p95 },
+			{ "p99", summary.p99 },
+			{ "max", summary.max },
+			{ "budget", m_stream->latency_budget.count() },
+		}
+	);
 }
 
 void Render::update_progress(int current_frame, int total_frames) {
@@ -384,7 +1382,11 @@ void Render::update_progress(int current_frame, int total_frames) {
 
 	m_status.update_progress_string(first);
 
-	u::log(m_status.progress_string);
+	// structured progress replaces the log line when enabled, it'd just be noise next to it
+	if (event_sink.is_enabled())
+		event_sink.emit_progress(m_render_id, current_frame, total_frames, m_status.fps);
+	else
+		u::log(m_status.progress_string);
 
 	rendering.call_progress_callback();
 }
@@ -396,77 +1398,159 @@ tl::expected<RenderResult, std::string> Render::do_render(RenderCommands render_
 	std::ostringstream vspipe_stderr_output;
 	std::ostringstream ffmpeg_stderr_output;
 
+	// ffmpeg reads the source itself, there's no vspipe
+	bool ffmpeg_only = render_commands.vspipe.empty();
+
 	try {
+		bp::pipe vspipe_stdin;
 		bp::pipe vspipe_stdout;
 		bp::ipstream vspipe_stderr;
 		bp::ipstream ffmpeg_stderr;
+		bp::ipstream ffmpeg_progress;
 
 #ifndef _DEBUG
 		if (m_settings.advanced.debug) {
 #endif
-			DEBUG_LOG("VSPipe command: {} {}", blur.vspipe_path, u::tostring(u::join(render_commands.vspipe, L" ")));
+			if (!ffmpeg_only)
+				DEBUG_LOG(
+					"VSPipe command: {} {}", blur.vspipe_path, u::tostring(u::join(render_commands.vspipe, L" "))
+				);
 			DEBUG_LOG("FFmpeg command: {} {}", blur.ffmpeg_path, u::tostring(u::join(render_commands.ffmpeg, L" ")));
 #ifndef _DEBUG
 		}
 #endif
 
-		bp::environment env = boost::this_process::environment();
+		bp::environment env = get_render_environment();
 
-#if defined(__APPLE__)
-		if (blur.used_installer) {
-			env["PYTHONHOME"] = (blur.resources_path / "python").native();
-			env["PYTHONPATH"] = (blur.resources_path / "python/lib/python3.12/site-packages").native();
-		}
-#endif
+		// live input is decoded into vspipe's stdin, has to be running before vspipe starts reading the header
+		std::optional<LiveInput> live_input;
+		if (m_live) {
+			live_input.emplace(m_video_path, m_live_timeout);
 
-#if defined(__linux__)
-		auto app_config = config_app::get_app_config();
-		if (!app_config.vapoursynth_lib_path.empty()) {
-			env["LD_LIBRARY_PATH"] = app_config.vapoursynth_lib_path;
-			env["PYTHONPATH"] = app_config.vapoursynth_lib_path + "/python3.12/site-packages";
+			auto started = live_input->start(
+				vspipe_stdin,
+				!m_live_audio_path.empty() ? std::optional(m_live_audio_path) : std::nullopt,
+				env
+			);
+			if (!started)
+				return tl::unexpected(started.error());
 		}
-#endif
 
 		// Launch vspipe process
-		bp::child vspipe_process(
-			boost::filesystem::path{ blur.vspipe_path },
-			bp::args(render_commands.vspipe),
-			bp::std_out > vspipe_stdout,
-			bp::std_err > vspipe_stderr,
-			env
+		std::optional<bp::child> vspipe_process;
+		if (!ffmpeg_only) {
+			vspipe_process.emplace(
+				boost::filesystem::path{ blur.vspipe_path },
+				bp::args(render_commands.vspipe),
+				bp::std_in < vspipe_stdin,
+				bp::std_out > vspipe_stdout,
+				bp::std_err > vspipe_stderr,
+				env
 #ifdef _WIN32
-			,
-			bp::windows::create_no_window
+				,
+				bp::windows::create_no_window
 #endif
-		);
+			);
+		}
+
+		if (!live_input)
+			vspipe_stdin.close(); // nothing to read, vspipe shouldn't wait on it
 
 		// Launch ffmpeg process
-		bp::child ffmpeg_process(
-			boost::filesystem::path{ blur.ffmpeg_path },
-			bp::args(render_commands.ffmpeg),
-			bp::std_out.null(),
-			bp::std_err > ffmpeg_stderr,
-			bp::std_in < vspipe_stdout,
-			env
+		auto launch_ffmpeg = [&](auto&& std_out, auto&& std_in) {
+			return bp::child(
+				boost::filesystem::path{ blur.ffmpeg_path },
+				bp::args(render_commands.ffmpeg),
+				std_out,
+				bp::std_err > ffmpeg_stderr,
+				std_in,
+				env
 #ifdef _WIN32
-			,
-			bp::windows::create_no_window
+				,
+				bp::windows::create_no_window
 #endif
-		);
+			);
+		};
+
+		// streams to stdout go straight through to ours
+		bp::child ffmpeg_process =
+			ffmpeg_only                        ? launch_ffmpeg(bp::std_out > ffmpeg_progress, bp::std_in.null())
+			: m_stream && m_stream->to_stdout() ? launch_ffmpeg(bp::std_out > stdout, bp::std_in < vspipe_stdout)
+			                                    : launch_ffmpeg(bp::std_out.null(), bp::std_in < vspipe_stdout);
+
+		auto vspipe_running = [&] {
+			return vspipe_process && vspipe_process->running();
+		};
 
 		// Store PIDs for signal handler
-		m_vspipe_pid = vspipe_process.id();
+		m_vspipe_pid = vspipe_process ? vspipe_process->id() : -1;
 		m_ffmpeg_pid = ffmpeg_process.id();
 
+		// nothing to balance ffmpeg against when it's on its own
+		CpuBalancer cpu_balancer(m_settings.gpu_encoding, m_app_settings.balance_render_cpu);
+		if (!ffmpeg_only) {
+#ifdef _WIN32
+			cpu_balancer.attach(m_vspipe_pid, m_ffmpeg_pid, -1); // pipe fill level isn't sampled on windows
+#else
+			cpu_balancer.attach(m_vspipe_pid, m_ffmpeg_pid, vspipe_stdout.native_source());
+#endif
+		}
+
+		RenderThrottle throttle(m_background, m_app_settings.background_load_threshold);
+		throttle.attach(m_vspipe_pid, m_ffmpeg_pid);
+
+		// stage timings and peak memory for the render history
+		auto launch_time = std::chrono::steady_clock::now();
+		std::optional<std::chrono::steady_clock::time_point> first_frame_time;
+		std::optional<std::chrono::steady_clock::time_point> vspipe_finish_time;
+		auto last_memory_sample = launch_time;
+		int64_t peak_memory = 0;
+		bool was_paused = false;
+
+		stream_output::LatencyTracker latency_tracker;
+		auto last_latency_report = launch_time;
+
 		std::thread progress_thread([&]() {
+			if (ffmpeg_only) {
+				int total_frames = get_ffmpeg_only_frame_count();
+
+				std::string line;
+				while (std::getline(ffmpeg_progress, line)) {
+					if (!line.starts_with("frame="))
+						continue;
+
+					try {
+						// the estimate can be a frame or two short
+						int current_frame = std::stoi(line.substr(6));
+						update_progress(current_frame, std::max(current_frame, total_frames));
+					}
+					catch (...) {
+					}
+				}
+				return;
+			}
+
 			std::string line;
 			std::string progress_line;
 			char ch = 0;
 
 			while (ffmpeg_process.running() && vspipe_stderr.get(ch)) {
 				if (ch == '\n') {
-					// Handle full line for logging
-					vspipe_stderr_output << line << '\n';
+					// per-frame latencies from blur.py when streaming, too many to keep in the log
+					if (line.starts_with("Latency: ")) {
+						auto parts = u::split_string(line, " ");
+						if (parts.size() == 3) {
+							try {
+								latency_tracker.add(std::stof(parts[2]));
+							}
+							catch (...) {
+							}
+						}
+					}
+					else {
+						// Handle full line for logging
+						vspipe_stderr_output << line << '\n';
+					}
 					line.clear();
 				}
 				else if (ch == '\r') {
@@ -478,7 +1562,8 @@ tl::expected<RenderResult, std::string> Render::do_render(RenderCommands render_
 						int current_frame = std::stoi(match[1]);
 						int total_frames = std::stoi(match[2]);
 
-						update_progress(current_frame, total_frames);
+						// vspipe's total is just the live clip's upper bound
+						update_progress(current_frame, m_live ? 0 : total_frames);
 					}
 
 					// Don't clear the line for logging purposes
@@ -505,33 +1590,95 @@ tl::expected<RenderResult, std::string> Render::do_render(RenderCommands render_
 		});
 
 		bool killed = false;
+		bool cache_too_big = false;
 
-		while (vspipe_process.running() || ffmpeg_process.running()) {
+		while (vspipe_running() || ffmpeg_process.running()) {
 			if (m_to_kill) {
+				throttle.release();
+				if (live_input)
+					live_input->stop();
 				ffmpeg_process.terminate();
-				vspipe_process.terminate();
+				if (vspipe_running())
+					vspipe_process->terminate();
 				DEBUG_LOG("render: killed processes early");
 				killed = true;
 				m_to_kill = false;
 			}
 
+			if (throttle.is_enabled()) {
+				throttle.update(m_paused);
+				m_status.throttled_time = throttle.get_throttled_time();
+			}
+
+			cpu_balancer.update(m_paused || throttle.is_suspended());
+
+			auto now = std::chrono::steady_clock::now();
+
+			if (!first_frame_time && m_status.init_frames)
+				first_frame_time = now;
+
+			if (!vspipe_finish_time && vspipe_process && !vspipe_process->running())
+				vspipe_finish_time = now;
+
+			if (now - last_memory_sample >= std::chrono::milliseconds(500)) {
+				last_memory_sample = now;
+				peak_memory = std::max(
+					peak_memory,
+					processes::get_memory_usage(m_vspipe_pid).value_or(0) +
+						processes::get_memory_usage(m_ffmpeg_pid).value_or(0)
+				);
+
+				// the size estimate is rough, don't let an entry that was underestimated run on past the limit
+				if (m_writing_cache && !cache_too_big) {
+					std::error_code ec;
+					auto cache_size = std::filesystem::file_size(m_cache_entry->video_path, ec);
+					if (!ec && cache_size > m_app_settings.get_interpolation_cache_bytes()) {
+						throttle.release();
+						ffmpeg_process.terminate();
+						if (vspipe_running())
+							vspipe_process->terminate();
+						DEBUG_LOG("render: interpolation cache entry went over the limit");
+						cache_too_big = true;
+					}
+				}
+			}
+
+			was_paused |= m_paused;
+
+			if (m_stream && now - last_latency_report >= STREAM_LATENCY_REPORT_INTERVAL) {
+				last_latency_report = now;
+				report_latency(latency_tracker.get_recent_summary(), false);
+			}
+
 			std::this_thread::sleep_for(std::chrono::milliseconds(50));
 		}
 
 		// Clean up
+		if (live_input)
+			live_input->stop();
+
 		if (progress_thread.joinable())
 			progress_thread.join();
 
 		if (ffmpeg_stderr_thread.joinable())
 			ffmpeg_stderr_thread.join();
 
+		m_vspipe_stderr = vspipe_stderr_output.str();
+		m_ffmpeg_stderr = ffmpeg_stderr_output.str();
+
 		m_vspipe_pid = -1;
 		m_ffmpeg_pid = -1;
 
-		if (m_settings.advanced.debug)
-			u::log(
-				"vspipe exit code: {}, ffmpeg exit code: {}", vspipe_process.exit_code(), ffmpeg_process.exit_code()
-			);
+		if (m_settings.advanced.debug) {
+			if (vspipe_process)
+				u::log(
+					"vspipe exit code: {}, ffmpeg exit code: {}",
+					vspipe_process->exit_code(),
+					ffmpeg_process.exit_code()
+				);
+			else
+				u::log("ffmpeg exit code: {}", ffmpeg_process.exit_code());
+		}
 
 		if (killed) {
 			return RenderResult{
@@ -539,23 +1686,82 @@ tl::expected<RenderResult, std::string> Render::do_render(RenderCommands render_
 			};
 		}
 
+		if (cache_too_big)
+			return tl::unexpected("Interpolation cache entry went over the cache's size limit");
+
 		m_status.finished = true;
 
 		// final progress update
-		update_progress(m_status.total_frames, m_status.total_frames);
+		if (m_live)
+			update_progress(m_status.current_frame, 0);
+		else
+			update_progress(m_status.total_frames, m_status.total_frames);
 
 		std::chrono::duration<float> elapsed_time = std::chrono::steady_clock::now() - m_status.start_time;
 		float elapsed_seconds = elapsed_time.count();
 		u::log("render finished in {:.2f}s", elapsed_seconds);
+		if (ffmpeg_only)
+			u::log("rendered by ffmpeg alone, nothing needed vapoursynth");
+		else
+			u::log(cpu_balancer.get_summary());
+
+		if (throttle.is_enabled())
+			u::log("background throttling slowed the render by {:.2f}s", throttle.get_throttled_time().count());
+
+		if (m_stream)
+			report_latency(latency_tracker.get_summary(), true);
+
+		// live renders end by running out of frames, which vspipe reports as an error
+		bool vspipe_ok = !vspipe_process || vspipe_process->exit_code() == 0 ||
+		                 (m_live && m_vspipe_stderr.find(LiveInput::END_OF_INPUT_MESSAGE) != std::string::npos);
+
+		if (!vspipe_ok || ffmpeg_process.exit_code() != 0) {
+			std::string live_errors = live_input ? live_input->get_stderr() : "";
 
-		if (vspipe_process.exit_code() != 0 || ffmpeg_process.exit_code() != 0) {
 			return tl::unexpected(
 				std::format(
-					"--- [vspipe] ---\n{}\n--- [ffmpeg] ---\n{}", vspipe_stderr_output.str(), ffmpeg_stderr_output.str()
+					"--- [vspipe] ---\n{}\n--- [ffmpeg] ---\n{}{}",
+					m_vspipe_stderr,
+					m_ffmpeg_stderr,
+					!live_errors.empty() ? std::format("\n--- [live decoder] ---\n{}", live_errors) : ""
 				)
 			);
 		}
 
+		if (first_frame_time) {
+			auto finish_time = std::chrono::steady_clock::now();
+			if (!vspipe_finish_time)
+				vspipe_finish_time = finish_time;
+
+			std::chrono::duration<double> startup = *first_frame_time - launch_time;
+			std::chrono::duration<double> processing = *vspipe_finish_time - *first_frame_time;
+			std::chrono::duration<double> finishing = finish_time - *vspipe_finish_time;
+
+			render_history::StageTimings timings{
+				.startup = startup.count(),
+				.processing = std::max(0.0, processing.count() - throttle.get_throttled_time().count()),
+				.finishing = finishing.count(),
+			};
+
+			event_sink.emit(
+				"stages",
+				{
+					{ "render_id", m_render_id },
+					{ "startup", timings.startup },
+					{ "processing", timings.processing },
+					{ "finishing", timings.finishing },
+					{ "throttled", throttle.get_throttled_time().count() },
+					{ "peak_memory", peak_memory },
+				}
+			);
+
+			// manual pauses would skew the timings. throttling is subtracted out instead, it's not under the user's
+			// control. live renders are paced by the recording so they'd be meaningless too, and renders with extra
+			// outputs or cached interpolation aren't comparable to single full ones
+			if (!was_paused && !m_live && m_branches.empty() && m_renditions.empty() && !m_cache_entry)
+				record_history(timings, peak_memory);
+		}
+
 		return RenderResult{
 			.stopped = false,
 		};
@@ -634,6 +1840,15 @@ tl::expected<RenderResult, std::string> Render::render() {
 		u::log("Rendered at {:.2f} speed with crf {}", m_settings.output_timescale, m_settings.quality);
 	}
 
+	if (m_estimate) {
+		u::log(
+			"Estimated render time: ~{} (based on {} past render{})",
+			render_history::format_duration(m_estimate->wall_time),
+			m_estimate->samples,
+			m_estimate->samples != 1 ? "s" : ""
+		);
+	}
+
 	// start preview
 	if (m_settings.preview && blur.using_preview) {
 		if (create_temp_path()) {
@@ -641,12 +1856,72 @@ tl::expected<RenderResult, std::string> Render::render() {
 		}
 	}
 
+	if (!m_branches.empty()) {
+		if (m_stream || m_live || m_frame_range)
+			return tl::unexpected("Multiple outputs can't be combined with streaming, live or segmented renders");
+
+		for (const auto& branch : m_branches) {
+			u::log(
+				"Also rendering to '{}' ({}fps, {:.2f} blur amount)",
+				branch.output_path,
+				branch.settings.blur_output_fps,
+				branch.settings.blur_amount
+			);
+		}
+	}
+
+	if (m_stream) {
+		if (m_settings.timescale && (m_settings.input_timescale != 1.f || m_settings.output_timescale != 1.f))
+			return tl::unexpected("Timescale can't be used when streaming, the output has to keep up with the input");
+
+		double source_fps = static_cast<double>(m_video_info.fps_num) / m_video_info.fps_den;
+		double lookahead_ms = stream_output::get_lookahead_frames(m_settings, source_fps) * 1000.0 / source_fps;
+
+		u::log("Streaming to {} with a {}ms latency budget", m_stream->url, m_stream->latency_budget.count());
+
+		if (lookahead_ms > static_cast<double>(m_stream->latency_budget.count())) {
+			u::log(
+				"The blur window alone needs {:.0f}ms of lookahead, lower the blur amount or raise the budget",
+				lookahead_ms
+			);
+		}
+	}
+
+	auto renditions_res = prepare_renditions();
+	if (!renditions_res)
+		return tl::unexpected(renditions_res.error());
+
+	for (const auto& rendition : m_renditions)
+		u::log("Also encoding a {} rendition to '{}'", rendition.rendition.get_label(), rendition.output_path);
+
+	if (m_live) {
+		u::log("Following live input, the render will finish once recording stops");
+
+		// audio can't go through vspipe, so it's split off while following and muxed back in afterwards
+		if (!m_stream && LiveInput::has_audio_stream(m_video_path) &&
+		    (!m_temp_path.empty() || create_temp_path()))
+		{
+			m_live_audio_path = m_temp_path / "live_audio.mka";
+			m_live_video_path = m_temp_path / ("live_video" + m_output_path.extension().string());
+		}
+	}
+
 	// render
-	auto render_commands = build_render_commands();
-	if (!render_commands)
-		return tl::unexpected(render_commands.error());
+	tl::expected<RenderResult, std::string> render = RenderResult{ .stopped = true };
+
+	if (prepare_source_analysis() && prepare_interpolation_cache()) {
+		auto render_commands = can_skip_vapoursynth() ? build_ffmpeg_only_commands() : build_render_commands();
+		if (!render_commands)
+			return tl::unexpected(render_commands.error());
+
+		render = do_render(*render_commands);
+	}
 
-	auto render = do_render(*render_commands);
+	if (render && !render->stopped && !m_live_video_path.empty()) {
+		auto muxed = mux_live_audio();
+		if (!muxed)
+			render = tl::unexpected(muxed.error());
+	}
 	if (!render) {
 		u::log("Failed to render '{}'", m_video_name);
 
@@ -657,17 +1932,21 @@ tl::expected<RenderResult, std::string> Render::render() {
 	else {
 		if (render->stopped) {
 			u::log("Stopped render '{}'", m_video_name);
-			std::filesystem::remove(m_output_path);
+			if (!m_stream) {
+				for (const auto& output_path : get_output_paths())
+					std::filesystem::remove(output_path);
+			}
 		}
 		else {
 			if (blur.verbose) {
 				u::log("Finished rendering '{}'", m_video_name);
 			}
 
-			if (m_settings.copy_dates) {
+			if (m_settings.copy_dates && !m_stream) {
 				try {
 					auto input_time = std::filesystem::last_write_time(m_video_path);
-					std::filesystem::last_write_time(m_output_path, input_time);
+					for (const auto& output_path : get_output_paths())
+						std::filesystem::last_write_time(output_path, input_time);
 
 					if (m_settings.advanced.debug) {
 						u::log("Set output file modified time to match input file");
@@ -686,6 +1965,59 @@ tl::expected<RenderResult, std::string> Render::render() {
 	return render;
 }
 
+tl::expected<void, std::string> Render::mux_live_audio() {
+	namespace bp = boost::process;
+
+	std::vector<std::wstring> args = { L"-loglevel",
+		                               L"error",
+		                               L"-hide_banner",
+		                               L"-y",
+		                               L"-i",
+		                               m_live_video_path.wstring(),
+		                               L"-i",
+		                               m_live_audio_path.wstring(),
+		                               L"-map",
+		                               L"0:v",
+		                               L"-map",
+		                               L"1:a?",
+		                               L"-c:v",
+		                               L"copy" };
+
+	auto audio_filter_args = build_audio_filter_args();
+	args.insert(args.end(), audio_filter_args.begin(), audio_filter_args.end());
+
+	args.insert(
+		args.end(), { L"-c:a", L"aac", L"-b:a", L"320k", L"-movflags", L"+faststart", m_output_path.wstring() }
+	);
+
+	try {
+		bp::ipstream ffmpeg_stderr;
+		bp::child ffmpeg_process(
+			boost::filesystem::path{ blur.ffmpeg_path },
+			bp::args(args),
+			bp::std_out.null(),
+			bp::std_err > ffmpeg_stderr,
+			get_render_environment()
+#ifdef _WIN32
+				,
+			bp::windows::create_no_window
+#endif
+		);
+
+		std::string errors((std::istreambuf_iterator<char>(ffmpeg_stderr)), std::istreambuf_iterator<char>());
+
+		ffmpeg_process.wait();
+
+		if (ffmpeg_process.exit_code() != 0)
+			return tl::unexpected(std::format("Failed to mux live audio:\n{}", errors));
+
+		return {};
+	}
+	catch (const boost::system::system_error& e) {
+		return tl::unexpected(e.what());
+	}
+}
+
 void Rendering::stop_renders_and_wait() {
 	auto current_render = get_current_render();
 	if (current_render) {
@@ -700,6 +2032,16 @@ void Rendering::stop_renders_and_wait() {
 }
 
 void RenderStatus::update_progress_string(bool first) {
+	if (total_frames <= 0) {
+		progress_string = first ? std::format("{} frames (live)", current_frame)
+		                        : std::format("{} frames ({:.2f} fps, live)", current_frame, fps);
+
+		if (throttled_time.count() > 0)
+			progress_string += std::format(" [throttled {:.1f}s]", throttled_time.count());
+
+		return;
+	}
+
 	float progress = current_frame / (float)total_frames;
 
 	if (first) {
@@ -709,6 +2051,9 @@ void RenderStatus::update_progress_string(bool first) {
 		progress_string =
 			std::format("{:.1f}% complete ({}/{}, {:.2f} fps)", progress * 100, current_frame, total_frames, fps);
 	}
+
+	if (throttled_time.count() > 0)
+		progress_string += std::format(" [throttled {:.1f}s]", throttled_time.count());
 }
 
 void RenderStatus::on_pause() {
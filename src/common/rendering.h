@@ -2,12 +2,35 @@
 
 #include "config_blur.h"
 #include "config_app.h"
+#include "render_history.h"
+#include "job_store.h"
+#include "live_input.h"
+#include "stream_output.h"
+#include "interpolation_cache.h"
 
 struct RenderCommands {
-	std::vector<std::wstring> vspipe;
+	std::vector<std::wstring> vspipe; // empty when ffmpeg renders straight from the source on its own
 	std::vector<std::wstring> ffmpeg;
 };
 
+// output frames to render (inclusive), for segments that are encoded separately and joined afterwards
+struct FrameRange {
+	int start;
+	int end;
+};
+
+// another blur and encode configuration rendered off the same decoded, deduplicated and interpolated frames
+struct RenderBranch {
+	BlurSettings settings;
+	std::filesystem::path output_path;
+};
+
+// an extra encode of the main output, fed from the same frames
+struct RenderRendition {
+	OutputRendition rendition;
+	std::filesystem::path output_path;
+};
+
 struct RenderResult {
 	bool stopped;
 };
@@ -17,7 +40,7 @@ struct RenderStatus {
 
 	bool init_frames = false;
 	int current_frame = 0;
-	int total_frames = 0;
+	int total_frames = 0; // 0 when it isn't known up front (live input)
 
 	bool init_fps = false;
 	std::chrono::steady_clock::time_point start_time;
@@ -25,6 +48,9 @@ struct RenderStatus {
 	std::chrono::duration<double> elapsed_time;
 	float fps = 0.f;
 
+	// time spent suspended by background throttling
+	std::chrono::duration<double> throttled_time{};
+
 	void update_progress_string(bool first);
 	void on_pause();
 
@@ -53,17 +79,89 @@ private:
 
 	GlobalAppSettings m_app_settings;
 
+	std::optional<render_history::Estimate> m_estimate;
+
+	// stderr of the last run, kept for failure reports
+	std::string m_vspipe_stderr;
+	std::string m_ffmpeg_stderr;
+
 	bool m_to_kill = false;
 	bool m_paused = false;
+	bool m_background = false;
+	std::optional<FrameRange> m_frame_range;
+
+	// input is still being recorded
+	bool m_live = false;
+	std::chrono::seconds m_live_timeout = LiveInput::DEFAULT_TIMEOUT;
+	std::filesystem::path m_live_audio_path; // audio split off while following, muxed back in at the end
+	std::filesystem::path m_live_video_path;
+
+	// extra outputs sharing everything up to the blur with the main one
+	std::vector<RenderBranch> m_branches;
+
+	// filled in from the settings when the render starts
+	std::vector<RenderRendition> m_renditions;
+
+	// output goes to a stream instead of m_output_path
+	std::optional<stream_output::Settings> m_stream;
+	static constexpr auto STREAM_LATENCY_REPORT_INTERVAL = std::chrono::seconds(5);
+
+	// interpolated frames are read from here instead of being made from the source. while m_writing_cache is set the
+	// render is the pass that fills it in
+	std::optional<interpolation_cache::Entry> m_cache_entry;
+	bool m_writing_cache = false;
+
 	int m_vspipe_pid = -1;
 	int m_ffmpeg_pid = -1;
 
-	void build_output_filename();
+	[[nodiscard]] std::filesystem::path build_output_filename(const BlurSettings& settings, bool detailed) const;
+
+	[[nodiscard]] std::vector<std::wstring> build_encoder_args(const BlurSettings& settings, int threads) const;
+
+	// splits the output to encode each rendition alongside it
+	[[nodiscard]] std::vector<std::wstring> build_rendition_ffmpeg_args(
+		const std::wstring& setparams_filter, int threads
+	) const;
+
+	tl::expected<void, std::string> prepare_renditions();
+
+	[[nodiscard]] bool uses_source_analysis() const;
+
+	// analyses the source for deduplication if it hasn't been already. false if it was stopped
+	[[nodiscard]] bool prepare_source_analysis();
+
+	// finds or writes the interpolation cache entry for this render. false if it was stopped while writing it
+	[[nodiscard]] bool prepare_interpolation_cache();
+
+	void add_preview_args(RenderCommands& commands, const std::wstring& source = L"0:v") const;
+
+	// nothing was asked for that ffmpeg can't do by itself (timescale, filters, a plain blend), so vspipe doesn't
+	// need to be started at all
+	[[nodiscard]] bool can_skip_vapoursynth() const;
+
+	// ffmpeg filters doing what blur.py would have, for renders that skip vapoursynth
+	[[nodiscard]] std::wstring build_ffmpeg_only_filters() const;
+
+	// estimated from the source's duration, there's no vspipe to ask
+	[[nodiscard]] int get_ffmpeg_only_frame_count() const;
+
+	tl::expected<RenderCommands, std::string> build_ffmpeg_only_commands();
+
+	// splits vspipe's interleaved branches back apart and encodes each to its own output
+	[[nodiscard]] std::vector<std::wstring> build_fan_out_ffmpeg_args(
+		const std::wstring& setparams_filter, int threads
+	) const;
 
 	tl::expected<RenderCommands, std::string> build_render_commands();
 
 	void update_progress(int current_frame, int total_frames);
 
+	void report_latency(const stream_output::LatencySummary& summary, bool final);
+
+	void record_history(const render_history::StageTimings& timings, int64_t peak_memory);
+
+	tl::expected<void, std::string> mux_live_audio();
+
 	tl::expected<RenderResult, std::string> do_render(RenderCommands render_commands);
 
 public:
@@ -90,6 +188,61 @@ public:
 		return m_paused;
 	}
 
+	void set_background(bool background) {
+		m_background = background;
+	}
+
+	[[nodiscard]] bool is_background() const {
+		return m_background;
+	}
+
+	// follow an input that's still being written instead of reading it as it is. see LiveInput
+	void set_live(std::chrono::seconds timeout = LiveInput::DEFAULT_TIMEOUT) {
+		m_live = true;
+		m_live_timeout = timeout;
+	}
+
+	[[nodiscard]] bool is_live() const {
+		return m_live;
+	}
+
+	// mux to mpeg-ts and send it to a url as it's encoded instead of writing a file. see stream_output
+	void set_stream(stream_output::Settings stream) {
+		m_stream = std::move(stream);
+	}
+
+	[[nodiscard]] bool is_streaming() const {
+		return m_stream.has_value();
+	}
+
+	// renders another output from the same decode and interpolation pass, only the blur, filter and encoding
+	// settings can differ from the main config
+	tl::expected<void, std::string> add_branch(
+		const std::filesystem::path& config_path, const std::optional<std::filesystem::path>& output_path = {}
+	);
+
+	[[nodiscard]] const std::vector<RenderBranch>& get_branches() const {
+		return m_branches;
+	}
+
+	[[nodiscard]] const std::vector<RenderRendition>& get_renditions() const {
+		return m_renditions;
+	}
+
+	// the main output followed by the branches' and renditions'
+	[[nodiscard]] std::vector<std::filesystem::path> get_output_paths() const;
+
+	// segments are rendered without audio, it's muxed back in once they're joined
+	void set_frame_range(FrameRange range) {
+		m_frame_range = range;
+	}
+
+	// runs the script without rendering anything to see how many frames it'll output
+	tl::expected<int, std::string> get_output_frame_count();
+
+	// -af arguments for the timescale settings, empty if the audio is left as is
+	[[nodiscard]] std::vector<std::wstring> build_audio_filter_args() const;
+
 	void stop() {
 		m_to_kill = true;
 	}
@@ -118,6 +271,19 @@ public:
 		return m_status;
 	}
 
+	[[nodiscard]] const std::string& get_vspipe_stderr() const {
+		return m_vspipe_stderr;
+	}
+
+	[[nodiscard]] const std::string& get_ffmpeg_stderr() const {
+		return m_ffmpeg_stderr;
+	}
+
+	// predicted from past renders, empty if there's nothing comparable in the history yet
+	[[nodiscard]] std::optional<render_history::Estimate> get_estimate() const {
+		return m_estimate;
+	}
+
 	[[nodiscard]] std::filesystem::path get_preview_path() const {
 		return m_preview_path;
 	}
@@ -138,9 +304,15 @@ private:
 
 	std::mutex m_lock;
 
+	tl::expected<RenderResult, std::string> render_front();
+
 public:
 	bool render_next_video();
 
+	// validates a stored job, queues it and renders it straight away. returns the error if it failed.
+	// on_created can adjust the render before it's queued
+	std::optional<std::string> render_job(const Job& job, const std::function<void(Render&)>& on_created = {});
+
 	Render& queue_render(Render&& render);
 
 	void stop_renders_and_wait();
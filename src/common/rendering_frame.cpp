@@ -1,4 +1,5 @@
 ﻿#include "rendering_frame.h"
+#include "source_analysis.h"
 
 tl::expected<RenderCommands, std::string> FrameRender::build_render_commands(
 	const std::filesystem::path& input_path,
@@ -50,6 +51,16 @@ tl::expected<RenderCommands, std::string> FrameRender::build_render_commands(
 		                blur_script_path.wstring(),
 		                L"-" };
 
+	// only use an existing analysis, analysing the whole video for one frame would take longer than without it
+	if (source_analysis::is_needed(settings)) {
+		auto analysis_path = source_analysis::get_path(input_path);
+		if (analysis_path && source_analysis::is_current(*analysis_path)) {
+			std::wstring analysis_string = analysis_path->wstring();
+			std::ranges::replace(analysis_string, '\\', '/');
+			commands.vspipe.insert(commands.vspipe.begin(), { L"-a", L"analysis_path=" + analysis_string });
+		}
+	}
+
 	// Build ffmpeg command
 	// clang-format off
 	commands.ffmpeg = {
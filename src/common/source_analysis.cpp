@@ -0,0 +1,318 @@
+#include "source_analysis.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#	include <emmintrin.h>
+#endif
+
+namespace {
+	constexpr std::streamsize SAMPLE_SIZE = 1024 * 1024;
+
+	uint64_t hash_string(const std::string& str, uint64_t hash = 14695981039346656037ULL) {
+		for (unsigned char ch : str) {
+			hash ^= ch;
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	std::string encode_base64(const std::string& data) {
+		static constexpr std::string_view CHARS = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		std::string out;
+		out.reserve((data.size() + 2) / 3 * 4);
+
+		for (size_t i = 0; i < data.size(); i += 3) {
+			uint32_t chunk = static_cast<uint8_t>(data[i]) << 16;
+			if (i + 1 < data.size())
+				chunk |= static_cast<uint8_t>(data[i + 1]) << 8;
+			if (i + 2 < data.size())
+				chunk |= static_cast<uint8_t>(data[i + 2]);
+
+			out += CHARS[(chunk >> 18) & 63];
+			out += CHARS[(chunk >> 12) & 63];
+			out += i + 1 < data.size() ? CHARS[(chunk >> 6) & 63] : '=';
+			out += i + 2 < data.size() ? CHARS[chunk & 63] : '=';
+		}
+
+		return out;
+	}
+}
+
+std::filesystem::path source_analysis::get_folder() {
+	return blur.settings_path / FOLDER_NAME;
+}
+
+bool source_analysis::is_needed(const BlurSettings& settings) {
+	bool deduplicating = settings.deduplicate && settings.advanced.deduplicate_range != 0 &&
+	                     settings.deduplicate_method != "old";
+
+	return deduplicating ||
+	       (settings.interpolate && (settings.adaptive_interpolation || settings.advanced.skip_static_regions));
+}
+
+std::optional<std::string> source_analysis::get_source_hash(const std::filesystem::path& source) {
+	// hashing whole sources would take longer than some renders. size, modified time and the start and end of the
+	// file are enough to tell a different or re-exported video apart
+	std::error_code ec;
+	auto size = std::filesystem::file_size(source, ec);
+	if (ec)
+		return {};
+
+	auto modified = std::filesystem::last_write_time(source, ec);
+	if (ec)
+		return {};
+
+	std::ifstream file(source, std::ios::binary);
+	if (!file)
+		return {};
+
+	std::string sample(SAMPLE_SIZE, '\0');
+	file.read(sample.data(), SAMPLE_SIZE);
+	sample.resize(file.gcount());
+
+	if (size > static_cast<uintmax_t>(SAMPLE_SIZE)) {
+		std::string tail(SAMPLE_SIZE, '\0');
+		file.clear();
+		file.seekg(-SAMPLE_SIZE, std::ios::end);
+		file.read(tail.data(), SAMPLE_SIZE);
+		tail.resize(file.gcount());
+		sample += tail;
+	}
+
+	uint64_t hash =
+		hash_string(sample, hash_string(std::format("{}|{}", size, modified.time_since_epoch().count())));
+
+	return std::format("{:016x}", hash);
+}
+
+std::optional<std::filesystem::path> source_analysis::get_path(const std::filesystem::path& source) {
+	auto hash = get_source_hash(source);
+	if (!hash)
+		return {};
+
+	std::error_code ec;
+	std::filesystem::create_directories(get_folder(), ec);
+	if (ec)
+		return {};
+
+	return get_folder() / (*hash + ".json");
+}
+
+bool source_analysis::is_current(const std::filesystem::path& path) {
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	try {
+		auto analysis = nlohmann::json::parse(file);
+		return analysis.value("version", 0) == VERSION;
+	}
+	catch (const nlohmann::json::exception&) {
+		return false;
+	}
+}
+
+float source_analysis::get_frame_diff(const uint8_t* a, const uint8_t* b, size_t size) {
+	if (size == 0)
+		return 0.f;
+
+	uint64_t sum = 0;
+	size_t i = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+	// psadbw sums 8 absolute differences into each 64-bit half
+	__m128i acc = _mm_setzero_si128();
+	for (; i + 16 <= size; i += 16) {
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+	}
+
+	alignas(16) uint64_t lanes[2];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+	sum += lanes[0] + lanes[1];
+#endif
+
+	for (; i < size; i++)
+		sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+
+	return static_cast<float>(static_cast<double>(sum) / (static_cast<double>(size) * 255.0));
+}
+
+void source_analysis::update_tile_diffs(
+	const uint8_t* frame, const uint8_t* reference, std::span<float> tile_diffs, size_t stride
+) {
+	// a small change (a timer, a notification) barely moves a tile's mean, so it's the largest pixel difference that
+	// says whether the tile can be copied from the reference
+	std::array<uint8_t, static_cast<size_t>(TILE_COLUMNS) * TILE_ROWS> maxes{};
+
+	for (int y = 0; y < TILE_ROWS * TILE_SIZE; y++) {
+		const uint8_t* row = frame + (y * stride);
+		const uint8_t* reference_row = reference + (y * stride);
+		uint8_t* row_maxes = maxes.data() + static_cast<ptrdiff_t>(y / TILE_SIZE) * TILE_COLUMNS;
+
+		for (int x = 0; x < TILE_COLUMNS * TILE_SIZE; x++) {
+			uint8_t diff = row[x] > reference_row[x] ? row[x] - reference_row[x] : reference_row[x] - row[x];
+			row_maxes[x / TILE_SIZE] = std::max(row_maxes[x / TILE_SIZE], diff);
+		}
+	}
+
+	for (size_t i = 0; i < maxes.size(); i++)
+		tile_diffs[i] = std::max(tile_diffs[i], maxes[i] / 255.f);
+}
+
+tl::expected<bool, std::string> source_analysis::analyse(
+	const std::filesystem::path& source,
+	const u::VideoInfo& video_info,
+	const std::filesystem::path& output,
+	const std::function<bool()>& should_stop
+) {
+	namespace bp = boost::process;
+
+	static_assert(std::endian::native == std::endian::little, "diffs are saved as little endian floats");
+
+	if (video_info.width <= 0 || video_info.height <= 0)
+		return tl::unexpected(std::format("Failed to analyse '{}': unknown video size", source));
+
+	// full size luma for the diffs with the area scaled change map frame stacked under it, so one decode gives both.
+	// scaled to the size ffprobe reported in case the decoder rotates it
+	const size_t width = video_info.width;
+	const size_t height = video_info.height;
+	const size_t stride = std::max<size_t>(width, ANALYSIS_WIDTH);
+
+	std::wstring input = L"[0:v:0]";
+	std::wstring filters;
+	if (video_info.fps_num > 0 && video_info.fps_den > 0) {
+		filters = std::format(L"{}fps={}/{}[v];", input, video_info.fps_num, video_info.fps_den);
+		input = L"[v]";
+	}
+
+	filters += std::format(
+		L"{0}format=gray,scale={1}:{2},split[full][small];"
+		L"[small]scale={4}:{5}:flags=area,pad={3}:{5}[small];"
+		L"[full]pad={3}:{2}[full];"
+		L"[full][small]vstack",
+		input,
+		width,
+		height,
+		stride,
+		ANALYSIS_WIDTH,
+		ANALYSIS_HEIGHT
+	);
+
+	std::vector<std::wstring> args = { L"-loglevel", L"error", L"-hide_banner", L"-i", source.wstring(), L"-an" };
+	args.insert(args.end(), { L"-filter_complex", filters, L"-f", L"rawvideo", L"pipe:1" });
+
+	const size_t FRAME_SIZE = stride * (height + ANALYSIS_HEIGHT);
+	const size_t TILE_FRAME_OFFSET = stride * height;
+
+	// mean over just the picture, padding is the same in every frame
+	auto get_full_diff = [&](const uint8_t* a, const uint8_t* b) {
+		if (stride == width)
+			return get_frame_diff(a, b, width * height);
+
+		double total = 0.0;
+		for (size_t y = 0; y < height; y++)
+			total += get_frame_diff(a + (y * stride), b + (y * stride), width);
+
+		return static_cast<float>(total / static_cast<double>(height));
+	};
+
+	std::vector<float> diffs;
+	std::vector<float> tile_diffs(static_cast<size_t>(TILE_COLUMNS) * TILE_ROWS);
+	if (int estimated_frames = video_info.get_frame_count(); estimated_frames > 0)
+		diffs.reserve(estimated_frames);
+
+	try {
+		bp::ipstream ffmpeg_stdout;
+		bp::ipstream ffmpeg_stderr;
+		bp::child ffmpeg_process(
+			boost::filesystem::path{ blur.ffmpeg_path },
+			bp::args(args),
+			bp::std_out > ffmpeg_stdout,
+			bp::std_err > ffmpeg_stderr
+#ifdef _WIN32
+			,
+			bp::windows::create_no_window
+#endif
+		);
+
+		std::string errors;
+		std::thread stderr_thread([&] {
+			errors.assign(std::istreambuf_iterator<char>(ffmpeg_stderr), std::istreambuf_iterator<char>());
+		});
+
+		std::vector<uint8_t> first;
+		std::vector<uint8_t> previous(FRAME_SIZE);
+		std::vector<uint8_t> current(FRAME_SIZE);
+		bool stopped = false;
+
+		while (ffmpeg_stdout.read(reinterpret_cast<char*>(current.data()), FRAME_SIZE)) {
+			if (first.empty())
+				first = current;
+			else
+				update_tile_diffs(
+					current.data() + TILE_FRAME_OFFSET, first.data() + TILE_FRAME_OFFSET, tile_diffs, stride
+				);
+
+			diffs.push_back(diffs.empty() ? 0.f : get_full_diff(current.data(), previous.data()));
+			std::swap(previous, current);
+
+			if (should_stop()) {
+				stopped = true;
+				ffmpeg_process.terminate();
+				break;
+			}
+		}
+
+		ffmpeg_process.wait();
+		stderr_thread.join();
+
+		if (stopped)
+			return false;
+
+		if (ffmpeg_process.exit_code() != 0 || diffs.empty())
+			return tl::unexpected(std::format("Failed to analyse '{}':\n{}", source, errors));
+	}
+	catch (const boost::system::system_error& e) {
+		return tl::unexpected(e.what());
+	}
+
+	auto encode_floats = [](const std::vector<float>& values) {
+		return encode_base64(std::string(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float)));
+	};
+
+	nlohmann::json analysis = {
+		{ "version", VERSION },
+		{ "frames", diffs.size() },
+		{ "diffs", encode_floats(diffs) },
+		{ "tile_columns", TILE_COLUMNS },
+		{ "tile_rows", TILE_ROWS },
+		{ "tiles", encode_floats(tile_diffs) },
+	};
+
+	// written to the side and renamed so renders of the same video running at once never see half a file. each
+	// writer gets its own temp name (pid like blur.py, plus a random part for renders within one process)
+	auto temp_path = output;
+	temp_path += std::format(".{}.{}.tmp", boost::this_process::get_id(), u::random_string(8));
+
+	std::error_code ec;
+
+	{
+		std::ofstream file(temp_path, std::ios::binary);
+		file << analysis.dump();
+		if (!file) {
+			file.close();
+			std::filesystem::remove(temp_path, ec);
+			return tl::unexpected(std::format("Failed to write analysis to '{}'", temp_path));
+		}
+	}
+
+	std::filesystem::rename(temp_path, output, ec);
+	if (ec) {
+		std::filesystem::remove(temp_path, ec);
+		return tl::unexpected(std::format("Failed to save analysis: {}", ec.message()));
+	}
+
+	return true;
+}
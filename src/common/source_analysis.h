@@ -0,0 +1,58 @@
+#pragma once
+
+// per-source analysis that doesn't depend on any settings, saved next to the app config so later renders and previews
+// of the same video don't redo it. blur runs it natively before the first render that needs it, blur.py loads it and
+// works out the duplicate runs for its threshold and where there's little enough motion to interpolate less (and only
+// falls back to measuring it itself if it's missing)
+namespace source_analysis {
+	const std::string FOLDER_NAME = "analysis";
+
+	// has to match blur/analysis.py
+	constexpr int VERSION = 5;
+
+	// the change map is measured on luma area scaled down to this. diffs are at the source's size, the same as the
+	// PlaneStats diffs deduplicate threshold has always been compared against (scaling down averages small motion
+	// away)
+	constexpr int ANALYSIS_WIDTH = 320;
+	constexpr int ANALYSIS_HEIGHT = 180;
+
+	// change map grid. tiles are TILE_SIZE analysis pixels square, about 64x64 of a 1080p source
+	constexpr int TILE_SIZE = 10;
+	constexpr int TILE_COLUMNS = ANALYSIS_WIDTH / TILE_SIZE;
+	constexpr int TILE_ROWS = ANALYSIS_HEIGHT / TILE_SIZE;
+
+	std::filesystem::path get_folder();
+
+	// deduplication, adaptive interpolation and skipping static regions work from the analysis. the old dedupe method
+	// finds dupes its own way
+	bool is_needed(const BlurSettings& settings);
+
+	// identifies the source's contents without reading all of it: size, modified time and the first and last MB.
+	// empty if it can't be read
+	std::optional<std::string> get_source_hash(const std::filesystem::path& source);
+
+	// where the analysis of the source is or will be saved
+	std::optional<std::filesystem::path> get_path(const std::filesystem::path& source);
+
+	// exists and was made natively by this version. blur.py's fallback versions its sidecars apart so they get redone
+	bool is_current(const std::filesystem::path& path);
+
+	// mean absolute difference (0-1) between two 8-bit planes
+	float get_frame_diff(const uint8_t* a, const uint8_t* b, size_t size);
+
+	// raises each tile's entry in tile_diffs to the largest difference (0-1) of any pixel in it between an analysis
+	// frame and the reference frame, if that's higher. stride is the distance between rows of both
+	void update_tile_diffs(
+		const uint8_t* frame, const uint8_t* reference, std::span<float> tile_diffs, size_t stride = ANALYSIS_WIDTH
+	);
+
+	// decodes the source once and saves the diff between each frame and the one before it to output, along with the
+	// most any pixel of each tile ever differs from the first frame (what static regions are pasted from). frames are
+	// resampled to the video's frame rate so they line up with how blur.py loads it. false if should_stop stopped it
+	tl::expected<bool, std::string> analyse(
+		const std::filesystem::path& source,
+		const u::VideoInfo& video_info,
+		const std::filesystem::path& output,
+		const std::function<bool()>& should_stop
+	);
+}
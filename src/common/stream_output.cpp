@@ -0,0 +1,151 @@
+#include "stream_output.h"
+
+int stream_output::get_lookahead_frames(const BlurSettings& settings, double source_fps) {
+	int lookahead = 0;
+
+	if (settings.blur && settings.blur_amount > 0.f && settings.blur_output_fps > 0) {
+		double window_seconds = settings.blur_amount / settings.blur_output_fps;
+		lookahead += static_cast<int>(std::ceil(window_seconds / 2 * source_fps));
+	}
+
+	if (settings.interpolate)
+		lookahead += 1;
+
+	return lookahead;
+}
+
+double stream_output::get_output_fps(const BlurSettings& settings, double source_fps) {
+	if (settings.blur)
+		return settings.blur_output_fps;
+
+	if (settings.interpolate) {
+		const auto& fps = settings.interpolated_fps;
+
+		try {
+			if (fps.ends_with('x'))
+				return source_fps * std::stod(fps.substr(0, fps.size() - 1));
+
+			return std::max(source_fps, std::stod(fps));
+		}
+		catch (const std::exception&) {
+			return source_fps; // blur.py will complain about it
+		}
+	}
+
+	return source_fps;
+}
+
+int stream_output::get_max_requests(const Settings& stream, double lookahead_ms, double output_fps) {
+	// each request in flight is roughly another frame time of delay on top of the lookahead
+	double remaining_ms = static_cast<double>(stream.latency_budget.count()) - lookahead_ms;
+	int requests = static_cast<int>(remaining_ms * output_fps / 1000.0);
+
+	int max_requests = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+	return std::clamp(requests, 1, max_requests);
+}
+
+std::vector<std::wstring> stream_output::get_low_delay_args(const std::string& codec, double output_fps) {
+	// a keyframe every second so a receiver that joins late doesn't wait long
+	std::vector<std::wstring> args = { L"-g", std::to_wstring(std::max(1, static_cast<int>(std::round(output_fps)))) };
+
+	if (codec == "libx264" || codec == "libx265")
+		args.insert(args.end(), { L"-tune", L"zerolatency", L"-bf", L"0" });
+	else if (codec.ends_with("_nvenc"))
+		args.insert(args.end(), { L"-zerolatency", L"1", L"-delay", L"0", L"-bf", L"0" });
+	else if (codec.ends_with("_amf"))
+		args.insert(args.end(), { L"-usage", L"lowlatency", L"-bf", L"0" });
+	else if (codec.ends_with("_qsv"))
+		args.insert(args.end(), { L"-async_depth", L"1", L"-bf", L"0" });
+	else if (codec.ends_with("_videotoolbox"))
+		args.insert(args.end(), { L"-realtime", L"1", L"-bf", L"0" });
+	else if (codec == "libvpx-vp9")
+		args.insert(args.end(), { L"-deadline", L"realtime", L"-lag-in-frames", L"0" });
+	else if (codec == "libaom-av1")
+		args.insert(args.end(), { L"-usage", L"realtime", L"-lag-in-frames", L"0" });
+
+	return args;
+}
+
+std::vector<std::wstring> stream_output::get_muxer_args(const Settings& stream) {
+	return { L"-f",
+		     L"mpegts",
+		     L"-flush_packets",
+		     L"1",
+		     L"-muxdelay",
+		     L"0",
+		     L"-muxpreload",
+		     L"0",
+		     stream.to_stdout() ? L"pipe:1" : u::towstring(stream.url) };
+}
+
+void stream_output::LatencyTracker::add(float latency_ms) {
+	std::lock_guard lock(m_mutex);
+
+	if (m_window.size() < WINDOW_FRAMES)
+		m_window.push_back(latency_ms);
+	else
+		m_window[m_window_next] = latency_ms;
+
+	m_window_next = (m_window_next + 1) % WINDOW_FRAMES;
+
+	auto bucket = static_cast<size_t>(std::clamp(std::round(latency_ms), 0.f, static_cast<float>(HISTOGRAM_MS)));
+	m_histogram[bucket]++;
+
+	m_frames++;
+	m_max = std::max(m_max, latency_ms);
+}
+
+stream_output::LatencySummary stream_output::LatencyTracker::get_summary() const {
+	std::lock_guard lock(m_mutex);
+
+	if (m_frames == 0)
+		return {};
+
+	auto percentile = [&](float p) {
+		auto index = static_cast<size_t>(p * static_cast<float>(m_frames - 1));
+
+		size_t seen = 0;
+		for (size_t bucket = 0; bucket < HISTOGRAM_MS; bucket++) {
+			seen += m_histogram[bucket];
+			if (seen > index)
+				return static_cast<float>(bucket);
+		}
+
+		return m_max;
+	};
+
+	return {
+		.frames = m_frames,
+		.p50 = percentile(0.5f),
+		.p95 = percentile(0.95f),
+		.p99 = percentile(0.99f),
+		.max = m_max,
+	};
+}
+
+stream_output::LatencySummary stream_output::LatencyTracker::get_recent_summary() const {
+	std::vector<float> latencies;
+	{
+		std::lock_guard lock(m_mutex);
+		latencies = m_window;
+	}
+
+	if (latencies.empty())
+		return {};
+
+	std::ranges::sort(latencies);
+
+	auto percentile = [&](float p) {
+		auto index = static_cast<size_t>(p * static_cast<float>(latencies.size() - 1));
+		return latencies[index];
+	};
+
+	return {
+		.frames = latencies.size(),
+		.p50 = percentile(0.5f),
+		.p95 = percentile(0.95f),
+		.p99 = percentile(0.99f),
+		.max = latencies.back(),
+	};
+}
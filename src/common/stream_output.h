@@ -0,0 +1,76 @@
+#pragma once
+
+#include "config_blur.h"
+
+// streaming renders: instead of a file, the output is muxed to mpeg-ts as it's encoded and sent to a url (udp, a
+// named pipe, or stdout with "-") for something like a local restream to pick up. the encoder is set up for low delay
+// and vapoursynth only looks ahead as far as the blur window and interpolation need, so the delay stays bounded.
+//
+// blur.py reports when each output frame is done relative to when the source frame it's centred on was first
+// decoded, that's collected here to report percentiles. try it out locally with:
+//
+//   ffmpeg -re -f lavfi -i testsrc2=size=1280x720:rate=60 -c:v libx264 -f mpegts live.ts
+//   blur-cli -i live.ts --live --stream udp://127.0.0.1:5000 --latency-budget 250
+//   ffplay -fflags nobuffer udp://127.0.0.1:5000
+namespace stream_output {
+	constexpr auto DEFAULT_LATENCY_BUDGET = std::chrono::milliseconds(500);
+
+	struct Settings {
+		std::string url; // "-" for stdout
+		std::chrono::milliseconds latency_budget = DEFAULT_LATENCY_BUDGET;
+
+		[[nodiscard]] bool to_stdout() const {
+			return url == "-";
+		}
+	};
+
+	// source frames the pipeline has to see past the one being output: half the blur window, plus the next frame
+	// for interpolation to have something to interpolate towards
+	int get_lookahead_frames(const BlurSettings& settings, double source_fps);
+
+	double get_output_fps(const BlurSettings& settings, double source_fps);
+
+	// how many frames vspipe can have in flight while staying within the budget once the lookahead is accounted for
+	int get_max_requests(const Settings& stream, double lookahead_ms, double output_fps);
+
+	// encoder options to stop it holding frames back, for the codec the preset picked
+	std::vector<std::wstring> get_low_delay_args(const std::string& codec, double output_fps);
+
+	// mpeg-ts muxer options that flush every packet as soon as it's ready
+	std::vector<std::wstring> get_muxer_args(const Settings& stream);
+
+	struct LatencySummary {
+		size_t frames = 0;
+		float p50 = 0.f;
+		float p95 = 0.f;
+		float p99 = 0.f;
+		float max = 0.f;
+	};
+
+	// collects per-frame latencies from the render's stderr thread, read from the render loop. memory stays fixed
+	// however long the stream runs: periodic reports cover a window of the latest frames, the final one comes from a
+	// histogram of every frame
+	class LatencyTracker {
+	public:
+		static constexpr size_t WINDOW_FRAMES = 1024;
+		static constexpr size_t HISTOGRAM_MS = 10000; // 1ms buckets, anything slower goes in the last one
+
+		void add(float latency_ms);
+
+		// the last WINDOW_FRAMES frames
+		[[nodiscard]] LatencySummary get_recent_summary() const;
+
+		// every frame so far, percentiles to the nearest ms
+		[[nodiscard]] LatencySummary get_summary() const;
+
+	private:
+		mutable std::mutex m_mutex;
+
+		std::vector<float> m_window; // ring buffer once full
+		size_t m_window_next = 0;
+
+		std::vector<uint32_t> m_histogram = std::vector<uint32_t>(HISTOGRAM_MS + 1);
+		size_t m_frames = 0;
+		float m_max = 0.f;
+	};
+}
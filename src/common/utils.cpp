@@ -275,7 +275,7 @@ u::VideoInfo u::get_video_info(const std::filesystem::path& path) {
 		"v:0", // only want to analyse first video stream
 		"-show_entries",
 		"stream=codec_type,codec_name,duration,color_range,sample_rate,r_frame_rate,pix_fmt,color_space,color_transfer,"
-		"color_primaries",
+		"color_primaries,width,height",
 		"-show_entries",
 		"format=duration",
 		"-of",
@@ -331,6 +331,12 @@ u::VideoInfo u::get_video_info(const std::filesystem::path& path) {
 		else if (line.find("sample_rate=") != std::string::npos) {
 			info.sample_rate = std::stoi(line.substr(line.find('=') + 1));
 		}
+		else if (line.starts_with("width=")) {
+			info.width = std::stoi(line.substr(line.find('=') + 1));
+		}
+		else if (line.starts_with("height=")) {
+			info.height = std::stoi(line.substr(line.find('=') + 1));
+		}
 		else if (line.find("r_frame_rate=") != std::string::npos) {
 			std::string frame_rate_str = line.substr(line.find('=') + 1);
 			auto fps_split = u::split_string(frame_rate_str, "/");
@@ -351,6 +357,7 @@ u::VideoInfo u::get_video_info(const std::filesystem::path& path) {
 	// Static images will typically have duration=0 or N/A
 	bool is_animated_format = u::contains(codec_name, "gif") || u::contains(codec_name, "webp");
 	info.has_video_stream = has_video_stream && (duration > 0.1 || is_animated_format);
+	info.duration = duration;
 
 	if (info.sample_rate == -1) {
 		// todo: throw?
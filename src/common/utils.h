@@ -166,6 +166,18 @@ namespace u {
 		}
 	}
 
+	// keeps stdout clean for machine-readable output
+	inline void redirect_logs_to_stderr() {
+		auto& logger = detail::get_logger();
+		logger.sinks().clear();
+		logger.sinks().push_back(std::make_shared<spdlog::sinks::stderr_color_sink_mt>());
+#ifdef _DEBUG
+		logger.set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v");
+#else
+		logger.set_pattern("%v");
+#endif
+	}
+
 	template<typename S, typename... Args>
 	void log(const S& fmt, Args&&... args) {
 		static_assert(
@@ -367,6 +379,17 @@ namespace u {
 		int sample_rate = -1;
 		int fps_num = -1;
 		int fps_den = -1;
+		int width = -1;
+		int height = -1;
+		double duration = 0.0;
+
+		// estimated from duration and frame rate, ffprobe would have to decode the whole file to count exactly
+		[[nodiscard]] int get_frame_count() const {
+			if (fps_num <= 0 || fps_den <= 0)
+				return 0;
+
+			return static_cast<int>(std::round(duration * fps_num / fps_den));
+		}
 	};
 
 	VideoInfo get_video_info(const std::filesystem::path& path);
@@ -0,0 +1,299 @@
+#include "watch_folder.h"
+
+#ifdef __linux__
+#	include <fcntl.h>
+#	include <poll.h>
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif
+
+namespace {
+	const std::unordered_set<std::string> VIDEO_EXTENSIONS = {
+		".webm", ".mkv", ".flv", ".vob", ".ogv", ".ogg", ".gifv", ".mng", ".mov", ".avi", ".qt",  ".wmv",
+		".yuv",  ".rm",  ".rmvb", ".asf", ".amv", ".mp4", ".m4p",  ".m4v", ".mpg", ".mp2", ".mpeg", ".mpe",
+		".mpv",  ".svi", ".3gp", ".3g2", ".mxf", ".roq", ".nsv",  ".f4v", ".ts",  ".m2ts", ".mts", ".divx",
+	};
+}
+
+WatchFolder::~WatchFolder() {
+	stop();
+}
+
+bool WatchFolder::is_video_file(const std::filesystem::path& path) {
+	auto extension = u::to_lower(path.extension().string());
+	return VIDEO_EXTENSIONS.contains(extension);
+}
+
+bool WatchFolder::is_blur_output(const std::filesystem::path& path) {
+	// see Render::build_output_filename
+	return u::contains(path.stem().string(), " - blur");
+}
+
+tl::expected<void, std::string> WatchFolder::start(
+	const std::filesystem::path& folder, bool recursive, Callback callback
+) {
+	stop();
+
+	std::error_code ec;
+	if (!std::filesystem::is_directory(folder, ec))
+		return tl::unexpected(std::format("Watch folder '{}' doesn't exist", folder));
+
+	m_folder = std::filesystem::canonical(folder, ec);
+	m_recursive = recursive;
+	m_callback = std::move(callback);
+	m_candidates.clear();
+
+#ifdef __linux__
+	m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify_fd == -1)
+		return tl::unexpected(std::format("Failed to initialise inotify: {}", std::strerror(errno)));
+
+	if (m_recursive)
+		add_watches_recursive(m_folder);
+	else
+		add_watch(m_folder);
+
+	if (m_watch_dirs.empty()) {
+		close(m_inotify_fd);
+		m_inotify_fd = -1;
+		return tl::unexpected(std::format("Failed to watch '{}'", m_folder));
+	}
+#else
+	m_last_poll_time = std::filesystem::file_time_type::clock::now();
+#endif
+
+	m_stopping = false;
+	m_running = true;
+	m_thread = std::thread(&WatchFolder::run, this);
+
+	return {};
+}
+
+void WatchFolder::stop() {
+	if (!m_running)
+		return;
+
+	m_stopping = true;
+	if (m_thread.joinable())
+		m_thread.join();
+
+#ifdef __linux__
+	if (m_inotify_fd != -1) {
+		close(m_inotify_fd); // also drops every watch
+		m_inotify_fd = -1;
+	}
+	m_watch_dirs.clear();
+#endif
+
+	m_candidates.clear();
+	m_running = false;
+}
+
+void WatchFolder::run() {
+	while (!m_stopping) {
+#ifdef __linux__
+		pollfd poll_fd{ .fd = m_inotify_fd, .events = POLLIN, .revents = 0 };
+		if (poll(&poll_fd, 1, 500) > 0)
+			handle_inotify_events();
+#else
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+		auto now = std::filesystem::file_time_type::clock::now();
+		if (now - m_last_poll_time >= POLL_INTERVAL)
+			poll_for_changes();
+#endif
+
+		if (std::chrono::steady_clock::now() - m_last_check >= CHECK_INTERVAL)
+			check_candidates();
+	}
+}
+
+void WatchFolder::add_candidate(const std::filesystem::path& path) {
+	if (!is_video_file(path) || is_blur_output(path))
+		return;
+
+	std::error_code ec;
+	auto size = std::filesystem::file_size(path, ec);
+	if (ec)
+		return;
+
+	// restart the clock if it's already being tracked, it's still being written
+	m_candidates[path] = Candidate{ .size = size, .stable_since = std::chrono::steady_clock::now() };
+}
+
+void WatchFolder::check_candidates() {
+	auto now = std::chrono::steady_clock::now();
+	m_last_check = now;
+
+	for (auto it = m_candidates.begin(); it != m_candidates.end();) {
+		const auto& path = it->first;
+		auto& candidate = it->second;
+
+		std::error_code ec;
+		auto size = std::filesystem::file_size(path, ec);
+		if (ec) {
+			it = m_candidates.erase(it); // deleted or moved away
+			continue;
+		}
+
+		if (size != candidate.size) {
+			candidate.size = size;
+			candidate.stable_since = now;
+			++it;
+			continue;
+		}
+
+		if (now - candidate.stable_since < STABLE_DURATION || size == 0 || is_open_for_writing(path)) {
+			++it;
+			continue;
+		}
+
+		DEBUG_LOG("watch folder: '{}' is ready", path);
+		m_callback(path);
+
+		it = m_candidates.erase(it);
+	}
+}
+
+bool WatchFolder::is_open_for_writing(const std::filesystem::path& path) {
+#if defined(__linux__)
+	// a read lease can only be taken while nobody has the file open for writing. leases only work on local files we
+	// own, if we can't take one for any other reason fall back to trusting the size check
+	int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd == -1)
+		return true;
+
+	bool writing = false;
+	if (fcntl(fd, F_SETLEASE, F_RDLCK) == 0)
+		fcntl(fd, F_SETLEASE, F_UNLCK);
+	else
+		writing = errno == EAGAIN;
+
+	close(fd);
+	return writing;
+#elif defined(_WIN32)
+	// sharing violation = someone else has it open with write access
+	HANDLE file = CreateFileW(
+		path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+	);
+	if (file == INVALID_HANDLE_VALUE)
+		return GetLastError() == ERROR_SHARING_VIOLATION;
+
+	CloseHandle(file);
+	return false;
+#else
+	return false;
+#endif
+}
+
+#ifdef __linux__
+void WatchFolder::add_watch(const std::filesystem::path& dir) {
+	int wd = inotify_add_watch(
+		m_inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF | IN_ONLYDIR
+	);
+	if (wd == -1) {
+		u::log_error("Failed to watch '{}': {}", dir, std::strerror(errno));
+		return;
+	}
+
+	m_watch_dirs[wd] = dir;
+}
+
+void WatchFolder::add_watches_recursive(const std::filesystem::path& dir) {
+	add_watch(dir);
+
+	std::error_code ec;
+	for (std::filesystem::recursive_directory_iterator
+	         it(dir, std::filesystem::directory_options::skip_permission_denied, ec),
+	     end;
+	     it != end;
+	     it.increment(ec))
+	{
+		if (ec)
+			break;
+
+		if (it->is_directory(ec))
+			add_watch(it->path());
+	}
+}
+
+void WatchFolder::handle_inotify_events() {
+	alignas(inotify_event) std::array<char, 16384> buffer{};
+
+	while (true) {
+		ssize_t length = read(m_inotify_fd, buffer.data(), buffer.size());
+		if (length <= 0)
+			break; // EAGAIN, drained
+
+		for (char* ptr = buffer.data(); ptr < buffer.data() + length;) {
+			auto* event = reinterpret_cast<inotify_event*>(ptr);
+			ptr += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				u::log_error("Watch folder event queue overflowed, some new files may have been missed");
+				continue;
+			}
+
+			auto dir_it = m_watch_dirs.find(event->wd);
+			if (dir_it == m_watch_dirs.end())
+				continue;
+
+			if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+				m_watch_dirs.erase(dir_it);
+				continue;
+			}
+
+			if (event->len == 0)
+				continue;
+
+			auto path = dir_it->second / event->name;
+
+			if (event->mask & IN_ISDIR) {
+				// files can land in a new folder before we've started watching it, so anything already inside
+				// counts as new too
+				if (m_recursive && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+					add_watches_recursive(path);
+
+					std::error_code ec;
+					for (const auto& entry : std::filesystem::recursive_directory_iterator(path, ec)) {
+						if (entry.is_regular_file(ec))
+							add_candidate(entry.path());
+					}
+				}
+				continue;
+			}
+
+			// created files are only tracked once they're closed or moved in, which is what we really want to know
+			if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				add_candidate(path);
+		}
+	}
+}
+#else
+void WatchFolder::poll_for_changes() {
+	auto poll_time = std::filesystem::file_time_type::clock::now();
+
+	std::error_code ec;
+	auto check_entry = [&](const std::filesystem::directory_entry& entry) {
+		if (!entry.is_regular_file(ec) || !is_video_file(entry.path()))
+			return;
+
+		auto write_time = entry.last_write_time(ec);
+		if (!ec && write_time >= m_last_poll_time && !m_candidates.contains(entry.path()))
+			add_candidate(entry.path());
+	};
+
+	if (m_recursive) {
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(
+				 m_folder, std::filesystem::directory_options::skip_permission_denied, ec
+			 ))
+			check_entry(entry);
+	}
+	else {
+		for (const auto& entry : std::filesystem::directory_iterator(m_folder, ec))
+			check_entry(entry);
+	}
+
+	m_last_poll_time = poll_time;
+}
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+// watches a folder tree for new videos and reports each one once it's finished being written: its size has stopped
+// changing and nothing has it open for writing anymore. on linux this is driven by inotify (one watch per directory,
+// only files that were written or moved in are tracked), elsewhere by periodically looking for recently modified
+// files. either way existing files are left alone and memory only grows with the files currently being written
+class WatchFolder {
+public:
+	using Callback = std::function<void(const std::filesystem::path& path)>;
+
+	static inline const std::string QUEUE_FILENAME = "watch_queue.jsonl";
+
+	WatchFolder() = default;
+	~WatchFolder();
+
+	WatchFolder(const WatchFolder&) = delete;
+	WatchFolder& operator=(const WatchFolder&) = delete;
+
+	tl::expected<void, std::string> start(const std::filesystem::path& folder, bool recursive, Callback callback);
+	void stop();
+
+	[[nodiscard]] bool is_running() const {
+		return m_running;
+	}
+
+	[[nodiscard]] const std::filesystem::path& get_folder() const {
+		return m_folder;
+	}
+
+	static bool is_video_file(const std::filesystem::path& path);
+
+	// our own renders land next to (or under) their inputs, don't feed them back in
+	static bool is_blur_output(const std::filesystem::path& path);
+
+	// best effort, false when it can't be told
+	static bool is_open_for_writing(const std::filesystem::path& path);
+
+private:
+	static constexpr auto STABLE_DURATION = std::chrono::seconds(3);
+	static constexpr auto CHECK_INTERVAL = std::chrono::seconds(1);
+	static constexpr auto POLL_INTERVAL = std::chrono::seconds(5);
+
+	struct Candidate {
+		uintmax_t size;
+		std::chrono::steady_clock::time_point stable_since;
+	};
+
+	std::filesystem::path m_folder;
+	bool m_recursive = true;
+	Callback m_callback;
+
+	std::atomic<bool> m_running = false;
+	std::atomic<bool> m_stopping = false;
+	std::thread m_thread;
+
+	std::unordered_map<std::filesystem::path, Candidate> m_candidates;
+	std::chrono::steady_clock::time_point m_last_check;
+
+#ifdef __linux__
+	int m_inotify_fd = -1;
+	std::unordered_map<int, std::filesystem::path> m_watch_dirs;
+
+	void add_watch(const std::filesystem::path& dir);
+	void add_watches_recursive(const std::filesystem::path& dir);
+	void handle_inotify_events();
+#else
+	std::filesystem::file_time_type m_last_poll_time;
+
+	void poll_for_changes();
+#endif
+
+	void run();
+	void add_candidate(const std::filesystem::path& path);
+	void check_candidates();
+};
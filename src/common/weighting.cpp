@@ -234,3 +234,27 @@ weighting::GetWeightsResult weighting::get_weights(const BlurSettings& settings,
 		}
 	}
 }
+
+std::optional<std::vector<int>> weighting::get_integer_weights(const std::string& weighting, int frames) {
+	std::vector<int> weights(frames);
+
+	if (weighting == "equal") {
+		std::ranges::fill(weights, 1);
+	}
+	else if (weighting == "ascending") {
+		std::iota(weights.begin(), weights.end(), 1);
+	}
+	else if (weighting == "descending") {
+		std::iota(weights.rbegin(), weights.rend(), 1);
+	}
+	else if (weighting == "pyramid") {
+		// pyramid's half - |i - half| + 1 doubled, half is a fraction with an even number of frames
+		for (int i = 0; i < frames; i++)
+			weights[i] = frames + 1 - std::abs((2 * i) - (frames - 1));
+	}
+	else {
+		return {};
+	}
+
+	return weights;
+}
@@ -31,4 +31,8 @@ namespace weighting {
 	};
 
 	GetWeightsResult get_weights(const BlurSettings& settings, int video_fps);
+
+	// the weightings above that are plain integer sequences, scaled up to whole numbers (oldest frame first) for
+	// ffmpeg's tmix, which normalises them itself. empty for the rest
+	std::optional<std::vector<int>> get_integer_weights(const std::string& weighting, int frames);
 }
@@ -79,6 +79,13 @@ void configs::option_information(ui::Container& container) {
 				"Speed: svp > rife",
 			},
 		},
+		{
+			"adaptive interpolation checkbox",
+			{
+				"Interpolates fewer frames where there's little motion",
+				"Mostly still footage renders much faster, the blur looks the same",
+			},
+		},
 		// pre-interp settings
 		{
 			"section pre-interpolation checkbox",
@@ -118,6 +125,13 @@ void configs::option_information(ui::Container& container) {
 				"(higher = less accurate, faster; lower = more accurate, slower)",
 			},
 		},
+		{
+			"adaptive interpolation threshold text input",
+			{
+				"How different frames have to be (0-1) to get every interpolated frame",
+				"Less motion than this gets proportionally fewer",
+			},
+		},
 		{
 			"interpolation mask area slider",
 			{
@@ -147,6 +161,7 @@ void configs::option_information(ui::Container& container) {
 			"deduplicate threshold input",
 			{
 				"Threshold of movement that triggers deduplication",
+				"Compared against the mean luma difference (0-1) from the frame before at full resolution",
 				"Turn on debug in advanced and render a video to embed text showing the movement in each frame",
 			},
 		},
@@ -157,6 +172,21 @@ void configs::option_information(ui::Container& container) {
 				"Speed: old > svp > rife",
 			},
 		},
+		{
+			"output resolution text input",
+			{
+				"Size to render at (720p, 1280x720 or source)",
+				"Scaled before anything else, so smaller sizes render faster",
+			},
+		},
+		{
+			"renditions text input",
+			{
+				"Extra encodes made from the same render, comma separated",
+				"Each is a size (720p, 1280x720 or source), then optionally a preset, quality and container",
+				"e.g. 720p h265 24 mkv",
+			},
+		},
 		{
 			"preview checkbox",
 			{
@@ -220,12 +250,68 @@ void configs::option_information(ui::Container& container) {
 			},
 		},
 		// { "debug checkbox", { "Shows debug window and prints commands used by blur", } }
+		{
+			"half precision checkbox",
+			{
+				"Runs RIFE and gamma blending in 16-bit float instead of 32-bit,",
+				"uses less memory at high resolutions, barely visible difference",
+			},
+		},
+		{
+			"skip static regions checkbox",
+			{
+				"Edges of the frame that stay the same as the first frame for the whole",
+				"video (letterboxing, a fixed overlay) are copied from it instead of",
+				"being interpolated and blurred. Needs an extra pass over the video",
+			},
+		},
 		{
 			"copy dates checkbox",
 			{
 				"Copies over the modified date from the input",
 			},
 		},
+		{
+			"background rendering checkbox",
+			{
+				"Renders at the lowest cpu and disk priority and",
+				"pauses the render in bursts when other programs are busy",
+			},
+		},
+		{
+			"background load threshold",
+			{
+				"How busy the rest of the system has to be (0-1)",
+				"before background renders start getting throttled",
+			},
+		},
+		{
+			"interpolation cache checkbox",
+			{
+				"Keeps the interpolated frames of recent renders so",
+				"changing only blur, filters or encoding skips interpolating",
+			},
+		},
+		{
+			"interpolation cache size",
+			{
+				"Disk space the cache can use before the least",
+				"recently used videos are removed",
+			},
+		},
+		{
+			"watch folder checkbox",
+			{
+				"Automatically renders new videos once they've",
+				"finished copying into the watch folder",
+			},
+		},
+		{
+			"watch folder input",
+			{
+				"Folder (and subfolders) to watch for new videos",
+			},
+		},
 	};
 
 	std::string hovered = ui::get_hovered_id();
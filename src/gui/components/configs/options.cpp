@@ -3,6 +3,7 @@
 
 #include "../../ui/ui.h"
 #include "../../render/render.h"
+#include "../../tasks.h"
 
 #include "common/config_presets.h"
 #include "common/config_app.h"
@@ -178,6 +179,14 @@ void configs::options(ui::Container& container) {
 			settings.interpolation_method,
 			fonts::dejavu
 		);
+
+		ui::add_checkbox(
+			"adaptive interpolation checkbox",
+			container,
+			"adaptive interpolation",
+			settings.adaptive_interpolation,
+			fonts::dejavu
+		);
 	}
 
 	/*
@@ -302,6 +311,12 @@ void configs::options(ui::Container& container) {
 		);
 	}
 
+	ui::add_text_input(
+		"output resolution text input", container, settings.output_resolution, "output resolution", fonts::dejavu
+	);
+
+	ui::add_text_input("renditions text input", container, settings.renditions, "renditions", fonts::dejavu);
+
 	ui::add_checkbox("preview checkbox", container, "preview", settings.preview, fonts::dejavu);
 
 	ui::add_checkbox(
@@ -312,6 +327,56 @@ void configs::options(ui::Container& container) {
 
 	ui::add_text_input("output path input", container, app_settings.output_prefix, "output path", fonts::dejavu);
 
+	ui::add_checkbox(
+		"background rendering checkbox",
+		container,
+		"background rendering",
+		app_settings.background_rendering,
+		fonts::dejavu
+	);
+
+	if (app_settings.background_rendering) {
+		ui::add_slider(
+			"background load threshold",
+			container,
+			0.05f,
+			1.f,
+			&app_settings.background_load_threshold,
+			"throttle above {:.2f} load",
+			fonts::dejavu
+		);
+	}
+
+	ui::add_checkbox(
+		"interpolation cache checkbox",
+		container,
+		"interpolation cache",
+		app_settings.interpolation_cache,
+		fonts::dejavu
+	);
+
+	if (app_settings.interpolation_cache) {
+		ui::add_slider(
+			"interpolation cache size",
+			container,
+			1.f,
+			200.f,
+			&app_settings.interpolation_cache_size,
+			"cache size: {:.0f} gb",
+			fonts::dejavu
+		);
+	}
+
+	ui::add_checkbox(
+		"watch folder checkbox", container, "watch folder", app_settings.watch_folder_enabled, fonts::dejavu
+	);
+
+	if (app_settings.watch_folder_enabled) {
+		ui::add_text_input(
+			"watch folder input", container, app_settings.watch_folder, "folder to watch", fonts::dejavu
+		);
+	}
+
 	/*
 	    GPU Acceleration
 	*/
@@ -525,6 +590,18 @@ void configs::options(ui::Container& container) {
 
 		ui::add_checkbox("debug checkbox", container, "debug", settings.advanced.debug, fonts::dejavu);
 
+		ui::add_checkbox(
+			"half precision checkbox", container, "half precision", settings.advanced.half_precision, fonts::dejavu
+		);
+
+		ui::add_checkbox(
+			"skip static regions checkbox",
+			container,
+			"skip static regions",
+			settings.advanced.skip_static_regions,
+			fonts::dejavu
+		);
+
 		/*
 		    Advanced Interpolation
 		*/
@@ -571,6 +648,16 @@ void configs::options(ui::Container& container) {
 
 		ui::add_text_input("rife model", container, settings.advanced.rife_model, "rife model", fonts::dejavu);
 
+		if (settings.adaptive_interpolation) {
+			ui::add_text_input(
+				"adaptive interpolation threshold text input",
+				container,
+				settings.advanced.adaptive_interpolation_threshold,
+				"adaptive interpolation threshold",
+				fonts::dejavu
+			);
+		}
+
 		/*
 		    Advanced Blur
 		*/
@@ -654,6 +741,8 @@ void configs::save_config() {
 
 	config_app::create(config_app::get_app_config_path(), app_settings);
 	current_app_settings = app_settings;
+
+	tasks::update_watch_folder(app_settings);
 };
 
 void configs::on_load() {
@@ -12,6 +12,56 @@
 
 namespace main = gui::components::main;
 
+namespace {
+	std::string format_eta(int eta_seconds) {
+		int hours = eta_seconds / 3600;
+		int minutes = (eta_seconds % 3600) / 60;
+		int seconds = eta_seconds % 60;
+
+		std::ostringstream eta_stream;
+		if (hours > 0)
+			eta_stream << hours << " hour" << (hours > 1 ? "s " : " ");
+		if (minutes > 0)
+			eta_stream << minutes << " minute" << (minutes > 1 ? "s " : " ");
+		if (seconds > 0 || (hours == 0 && minutes == 0))
+			eta_stream << seconds << " second" << (seconds != 1 ? "s" : "");
+
+		return eta_stream.str();
+	}
+
+	std::string format_clock_time(double seconds_from_now) {
+		auto time = std::chrono::system_clock::to_time_t(
+			std::chrono::system_clock::now() + std::chrono::seconds(static_cast<int64_t>(seconds_from_now))
+		);
+
+		std::tm local{};
+#ifdef _WIN32
+		localtime_s(&local, &time);
+#else
+		localtime_r(&time, &local);
+#endif
+
+		return std::format("{:02}:{:02}", local.tm_hour, local.tm_min);
+	}
+
+	// seconds left on a render. uses the live fps once it's known, the history estimate before that
+	std::optional<double> get_remaining_time(const Render& render, bool current) {
+		auto status = render.get_status();
+
+		if (current && status.fps > 0.f)
+			return (status.total_frames - status.current_frame) / status.fps;
+
+		auto estimate = render.get_estimate();
+		if (!estimate)
+			return {};
+
+		if (current && status.init_frames && status.total_frames > 0)
+			return estimate->wall_time * (1.f - ((float)status.current_frame / (float)status.total_frames));
+
+		return estimate->wall_time;
+	}
+}
+
 void main::open_files_button(ui::Container& container, const std::string& label) {
 	ui::add_button("open file button", container, label, fonts::dejavu, [] {
 		static auto file_callback = [](void* userdata, const char* const* files, int filter) {
@@ -55,7 +105,8 @@ void main::render_screen(
 	bool current,
 	float delta_time,
 	bool& is_progress_shown,
-	float& bar_percent
+	float& bar_percent,
+	std::optional<double> finish_in
 ) {
 	// todo: ui concept
 	// screen start|      [faded]last_video current_video [faded]next_video next_video2 next_video3 (+5) |
@@ -63,6 +114,10 @@ void main::render_screen(
 
 	std::string render_title_text = render.get_video_name();
 
+	// fan-out renders are one queue entry with several outputs
+	if (!render.get_branches().empty())
+		render_title_text += std::format(" [{} outputs]", render.get_branches().size() + 1);
+
 	if (current) {
 		int queue_size = rendering.get_queue().size() + tasks::finished_renders;
 		if (queue_size > 1) {
@@ -79,8 +134,20 @@ void main::render_screen(
 		FONT_CENTERED_X
 	);
 
-	if (!current)
+	if (!current) {
+		if (finish_in) {
+			ui::add_text(
+				std::format("video {} finish text", render.get_render_id()),
+				container,
+				std::format("done ~{}", format_clock_time(*finish_in)),
+				gfx::Color(255, 255, 255, 100),
+				fonts::dejavu,
+				FONT_CENTERED_X
+			);
+		}
+
 		return;
+	}
 
 	auto render_status = render.get_status();
 	int bar_width = 300;
@@ -157,22 +224,20 @@ void main::render_screen(
 			int remaining_frames = render_status.total_frames - render_status.current_frame;
 			int eta_seconds = static_cast<int>(remaining_frames / render_status.fps);
 
-			int hours = eta_seconds / 3600;
-			int minutes = (eta_seconds % 3600) / 60;
-			int seconds = eta_seconds % 60;
-
-			std::ostringstream eta_stream;
-			if (hours > 0)
-				eta_stream << hours << " hour" << (hours > 1 ? "s " : " ");
-			if (minutes > 0)
-				eta_stream << minutes << " minute" << (minutes > 1 ? "s " : " ");
-			if (seconds > 0 || (hours == 0 && minutes == 0))
-				eta_stream << seconds << " second" << (seconds != 1 ? "s" : "");
-
 			ui::add_text(
 				"progress text eta",
 				container,
-				std::format("~{} left", eta_stream.str()),
+				std::format("~{} left", format_eta(eta_seconds)),
+				gfx::Color::white(renderer::MUTED_SHADE),
+				fonts::dejavu,
+				FONT_CENTERED_X
+			);
+		}
+		else if (finish_in) {
+			ui::add_text(
+				"progress text eta",
+				container,
+				std::format("~{} left (estimated)", format_eta(static_cast<int>(*finish_in))),
 				gfx::Color::white(renderer::MUTED_SHADE),
 				fonts::dejavu,
 				FONT_CENTERED_X
@@ -279,10 +344,19 @@ void main::home_screen(ui::Container& container, float delta_time) {
 
 			render_current_edge_case();
 
+			// predicted finish times add up along the queue, and stop once one of them can't be predicted
+			std::optional<double> queue_time = 0.0;
+
 			for (const auto [i, render] : u::enumerate(rendering.get_queue())) {
 				bool current = current_render && render.get() == current_render.value();
 
-				render_screen(container, *render, current, delta_time, is_progress_shown, bar_percent);
+				auto remaining_time = get_remaining_time(*render, current);
+				if (queue_time && remaining_time)
+					*queue_time += *remaining_time;
+				else
+					queue_time.reset();
+
+				render_screen(container, *render, current, delta_time, is_progress_shown, bar_percent, queue_time);
 			}
 		}
 		rendering.unlock();
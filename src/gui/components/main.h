@@ -14,7 +14,8 @@ namespace gui::components::main {
 		bool current,
 		float delta_time,
 		bool& is_progress_shown,
-		float& bar_percent
+		float& bar_percent,
+		std::optional<double> finish_in = {} // seconds until this render should be done, if it can be predicted
 	);
 
 	void home_screen(ui::Container& container, float delta_time);
@@ -2,6 +2,8 @@
 
 #include "common/rendering.h"
 #include "common/config_app.h"
+#include "common/job_store.h"
+#include "common/watch_folder.h"
 
 #include "gui.h"
 #include "gui/renderer.h"
@@ -14,6 +16,51 @@
 namespace {
 	std::vector<std::filesystem::path> pending_video_paths;
 	std::mutex pending_video_paths_mutex;
+
+	// videos picked up from the watch folder are journaled until their render finishes, so anything found before a
+	// crash or restart gets queued again on the next launch
+	JobStore watch_store;
+	bool watch_store_open = false;
+	WatchFolder watcher;
+	std::mutex watcher_mutex;
+
+	void finish_watch_job(const std::filesystem::path& input, JobState state, const std::string& error = "") {
+		if (!watch_store_open)
+			return;
+
+		for (const auto& job : watch_store.get_jobs()) {
+			if (job.input == input && job.state == JobState::PENDING) {
+				watch_store.set_state(job.id, state, error);
+				break;
+			}
+		}
+	}
+
+	void resume_watch_jobs() {
+		auto store_res = watch_store.open(blur.settings_path / WatchFolder::QUEUE_FILENAME);
+		if (!store_res) {
+			u::log_error("Failed to open watch folder queue: {}", store_res.error());
+			return;
+		}
+
+		watch_store_open = true;
+
+		std::vector<std::filesystem::path> paths;
+		for (const auto& job : watch_store.get_jobs()) {
+			if (job.state != JobState::PENDING)
+				continue;
+
+			if (!std::filesystem::exists(job.input)) {
+				watch_store.set_state(job.id, JobState::FAILED, "Input no longer exists");
+				continue;
+			}
+
+			paths.push_back(job.input);
+		}
+
+		if (!paths.empty())
+			tasks::add_files(paths);
+	}
 }
 
 void tasks::run(const std::vector<std::string>& arguments) {
@@ -42,6 +89,13 @@ void tasks::run(const std::vector<std::string>& arguments) {
 
 	rendering.set_render_finished_callback([](Render* render, const tl::expected<RenderResult, std::string>& result) {
 		gui::renderer::on_render_finished(render, result);
+
+		if (!result)
+			finish_watch_job(render->get_input_video_path(), JobState::FAILED, result.error());
+		else if (result->stopped)
+			finish_watch_job(render->get_input_video_path(), JobState::FAILED, "Render was stopped");
+		else
+			finish_watch_job(render->get_input_video_path(), JobState::DONE);
 	});
 
 	auto update_res = Blur::check_updates();
@@ -105,6 +159,11 @@ void tasks::run(const std::vector<std::string>& arguments) {
 
 	add_files(paths); // todo: mac packaged app support (& linux? does it work?)
 
+	if (gui::initialisation_res) {
+		resume_watch_jobs();
+		update_watch_folder(config_app::get_app_config());
+	}
+
 	std::thread([] {
 		while (!blur.exiting) {
 			process_pending_files();
@@ -180,6 +239,38 @@ void tasks::process_pending_files() {
 	}
 }
 
+void tasks::update_watch_folder(const GlobalAppSettings& app_settings) {
+	std::lock_guard<std::mutex> lock(watcher_mutex);
+
+	if (!watch_store_open)
+		return;
+
+	if (!app_settings.watch_folder_enabled || app_settings.watch_folder.empty()) {
+		if (watcher.is_running()) {
+			watcher.stop();
+			u::log("stopped watching folder");
+		}
+		return;
+	}
+
+	auto folder = u::string_to_path(app_settings.watch_folder);
+
+	std::error_code ec;
+	if (watcher.is_running() && std::filesystem::equivalent(watcher.get_folder(), folder, ec))
+		return;
+
+	auto watch_res = watcher.start(folder, true, [](const std::filesystem::path& path) {
+		watch_store.add({ .input = path });
+		tasks::add_files({ path });
+	});
+	if (!watch_res) {
+		gui::components::notifications::add(watch_res.error(), ui::NotificationType::NOTIF_ERROR);
+		return;
+	}
+
+	u::log("watching {} for new videos", watcher.get_folder());
+}
+
 void tasks::add_sample_video(const std::filesystem::path& path_str) {
 	std::filesystem::path path = std::filesystem::canonical(path_str);
 	if (path.empty() || !std::filesystem::exists(path))
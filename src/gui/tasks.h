@@ -1,5 +1,7 @@
 #pragma once
 
+#include "common/config_app.h"
+
 namespace tasks {
 	inline int finished_renders = 0;
 
@@ -8,4 +10,7 @@ namespace tasks {
 	void add_files(const std::vector<std::filesystem::path>& path_strs);
 	void add_sample_video(const std::filesystem::path& path_str);
 	void process_pending_files();
+
+	// starts, stops or moves the watch folder to match the app settings
+	void update_watch_folder(const GlobalAppSettings& app_settings);
 }
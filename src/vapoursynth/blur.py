@@ -3,14 +3,22 @@ from vapoursynth import core
 
 import sys
 import json
+from fractions import Fraction
 from pathlib import Path
 
 # add blur.py folder to path so it can reference scripts
 sys.path.insert(1, str(Path(__file__).parent))
 
+import blur.analysis
 import blur.blending
+import blur.cache
 import blur.deduplicate
+import blur.filters
+import blur.formats
 import blur.interpolate
+import blur.live
+import blur.regions
+import blur.stream
 import blur.weighting
 import blur.utils as u
 
@@ -44,11 +52,34 @@ interpolation_mask_area = u.coalesce(
     blur.interpolate.DEFAULT_MASKING,
 )
 
+# thread count picked by blur so vapoursynth and ffmpeg don't oversubscribe the cpu
+vs_threads = u.safe_int(vars().get("vs_threads"))
+if vs_threads:
+    core.num_threads = vs_threads
+
 rife_gpu_index = settings["rife_gpu_index"]
 if rife_gpu_index == -1:  # haven't benchmarked yet..?
     rife_gpu_index = 0
 
-if vars().get("enable_lsmash") == "true":
+# interpolated frames from an earlier render with the same source and interpolation settings
+interp_cache = vars().get("interp_cache")
+interp_cache_write = vars().get("interp_cache_write")
+
+if interp_cache:
+    video = blur.cache.load(
+        Path(interp_cache),
+        Path(vars().get("interp_cache_meta", "")),
+        enable_lsmash=vars().get("enable_lsmash") == "true",
+    )
+elif vars().get("live") == "true":
+    # the input is still being recorded, blur feeds it in over stdin as it's written
+    video = blur.live.source(
+        sys.stdin.fileno(),
+        fps_num=int(fps_num),
+        fps_den=int(fps_den),
+        is_full_color_range=is_full_color_range,
+    )
+elif vars().get("enable_lsmash") == "true":
     video = core.lsmas.LWLibavSource(
         source=video_path,
         cache=0,
@@ -64,22 +95,94 @@ else:
         fpsden=fps_den if fps_den != -1 else None,
     )
 
+# scaled to the output resolution before anything else so every later stage works on fewer pixels. cached
+# interpolation was already made at that size
+if not interp_cache:
+    video = blur.formats.resize(
+        video, settings["output_width"], settings["output_height"]
+    )
+
+# streaming: the lookahead is bounded so the output keeps up with the input
+streaming = vars().get("stream") == "true"
+if streaming:
+    stream_lookahead = u.coalesce(u.safe_int(vars().get("stream_lookahead")), 1)
+    source_fps = float(video.fps)
+    video, arrivals = blur.stream.track_arrivals(video)
+
+# stages say which formats they can work in and frames are only converted when they need to be
+planner = blur.formats.FormatPlanner(video, is_full_color_range)
+
+# float rgb stages (rife, gamma blending) can run in half precision, half the memory and bandwidth of RGBS
+rgb_float = vs.RGBH if settings["half_precision"] else vs.RGBS
+
+# duplicate runs left to fill during svp interpolation
+pending_dedupe_runs = None
+
 # input timescale
-if settings["timescale"]:
+if settings["timescale"] and not interp_cache:
     input_timescale = float(settings["input_timescale"])
     if settings["input_timescale"] != 1:
         video = u.assume_scaled_fps(video, 1 / input_timescale)
 
-if settings["deduplicate"] and settings["deduplicate_range"] != 0:
+# frame diffs saved from an earlier render of the same video, or worked out now and saved for the next one. used by
+# deduplication and adaptive interpolation, blur only passes a path when the whole source is there to analyse
+analysis = None
+analysis_path = vars().get("analysis_path")
+if analysis_path and not interp_cache:
+    analysis = blur.analysis.load_or_create(Path(analysis_path), video)
+
+# edges of the frame that stay the same as the first frame all the way through (letterboxing, fixed overlays) are
+# cropped off and pasted back from it at the end instead of being interpolated and blended. the analysis measures
+# every tile against that frame, so nothing that drifts away from it gets frozen. the cache pass keeps the whole
+# frame for other configs
+static_area = None
+if (
+    settings["skip_static_regions"]
+    and settings["interpolate"]
+    and analysis is not None
+    and not interp_cache_write
+):
+    static_area = blur.regions.get_active_area(video, analysis)
+    if static_area is not None:
+        static_background = video[0]
+        video = blur.regions.crop(video, static_area)
+
+        if settings["debug"]:
+            print(f"skipping static regions, processing {static_area}")
+
+# diffs below this were duplicates and have been filled in with motion
+filled_threshold = 0.0
+
+if (
+    settings["deduplicate"]
+    and settings["deduplicate_range"] != 0
+    and not interp_cache
+):
     deduplicate_range: int | None = int(settings["deduplicate_range"])
     if deduplicate_range == -1:  # -1 = infinite
         deduplicate_range = None
 
+    if streaming:
+        # can't wait indefinitely for the next unique frame
+        deduplicate_range = min(deduplicate_range or stream_lookahead, stream_lookahead)
+
     try:
         deduplicate_threshold = float(settings["deduplicate_threshold"])
     except (ValueError, TypeError, KeyError):
         deduplicate_threshold = 0.001
 
+    filled_threshold = deduplicate_threshold
+
+    # svp dedupe into svp interpolation can share one motion search, the runs are filled in along with it
+    shares_svp_vectors = (
+        settings["deduplicate_method"] == "svp"
+        and analysis is not None
+        and settings["interpolate"]
+        and settings["interpolation_method"] not in ("rife", "mvtools")
+        and not settings["manual_svp"]
+        and not settings["pre_interpolate"]
+    )
+
     match settings["deduplicate_method"]:
         case "old":
             video = blur.deduplicate.fill_drops_old(
@@ -88,12 +191,19 @@ if settings["deduplicate"] and settings["deduplicate_range"] != 0:
                 debug=settings["debug"],
             )
 
+        case "svp" if shares_svp_vectors:
+            pending_dedupe_runs = analysis.get_duplicate_runs(
+                deduplicate_threshold, deduplicate_range
+            )
+
         case "svp":
+            video = planner.prepare(video, "svp dedupe", (vs.YUV420P8,))
             video = blur.deduplicate.fill_drops_multiple(
                 video,
                 is_full_color_range=is_full_color_range,
                 threshold=deduplicate_threshold,
                 max_frames=deduplicate_range,
+                analysis=analysis,
                 debug=settings["debug"],
                 svp_preset=settings["svp_interpolation_preset"],
                 svp_algorithm=svp_interpolation_algorithm,
@@ -103,6 +213,7 @@ if settings["deduplicate"] and settings["deduplicate_range"] != 0:
             )
 
         case _:
+            video = planner.prepare(video, "rife dedupe", (rgb_float,))
             video = blur.deduplicate.fill_drops_rife(
                 video,
                 is_full_color_range=is_full_color_range,
@@ -110,11 +221,12 @@ if settings["deduplicate"] and settings["deduplicate_range"] != 0:
                 gpu_index=rife_gpu_index,
                 threshold=deduplicate_threshold,
                 max_frames=deduplicate_range,
+                analysis=analysis,
                 debug=settings["debug"],
             )
 
 # interpolation
-if settings["interpolate"]:
+if settings["interpolate"] and not interp_cache:
 
     def parse_fps_setting(setting_key):
         fps_value = settings[setting_key].strip()
@@ -147,6 +259,9 @@ if settings["interpolate"]:
 
     interpolated_fps = parse_fps_setting("interpolated_fps")
 
+    # frames no longer line up with the analysis after pre-interpolation
+    pre_interpolated = False
+
     if settings["interpolation_method"] != "rife" and settings["pre_interpolate"]:
         pre_interpolated_fps = parse_fps_setting("pre_interpolated_fps")
 
@@ -154,9 +269,11 @@ if settings["interpolate"]:
             video.fps < pre_interpolated_fps
         ):  # if can be while if rife limits the max interpolation fps, but i don't think it does
             old_fps = video.fps
+            pre_interpolated = True
 
             print(f"pre-interpolating to {pre_interpolated_fps}")
 
+            video = planner.prepare(video, "rife pre-interpolation", (rgb_float,))
             video = blur.interpolate.interpolate_rife(
                 video,
                 is_full_color_range=is_full_color_range,
@@ -178,6 +295,7 @@ if settings["interpolate"]:
 
         match settings["interpolation_method"]:
             case "rife":
+                video = planner.prepare(video, "rife interpolation", (rgb_float,))
                 video = blur.interpolate.interpolate_rife(
                     video,
                     is_full_color_range=is_full_color_range,
@@ -194,7 +312,27 @@ if settings["interpolate"]:
             #         masking=int(settings["interpolation_mask_area"]),
             #     )
 
+            case _ if pending_dedupe_runs is not None:  # svp, deduplicating too
+                video = planner.prepare(
+                    video, "svp dedupe and interpolation", (vs.YUV420P8,)
+                )
+                video = blur.interpolate.interpolate_svp_deduplicated(
+                    video,
+                    is_full_color_range=is_full_color_range,
+                    runs=pending_dedupe_runs,
+                    new_fps=int(interpolated_fps),
+                    preset=settings["svp_interpolation_preset"],
+                    algorithm=svp_interpolation_algorithm,
+                    blocksize=interpolation_blocksize,
+                    overlap=0,
+                    masking=interpolation_mask_area,
+                    gpu=settings["gpu_interpolation"],
+                )
+                pending_dedupe_runs = None
+
             case _:  # svp
+                video = planner.prepare(video, "svp interpolation", (vs.YUV420P8,))
+
                 if not settings["manual_svp"]:
                     video = blur.interpolate.interpolate_svp(
                         video,
@@ -227,60 +365,219 @@ if settings["interpolate"]:
             f"added {fps_added} (interp: {interpolated_fps}. video.fps: {video.fps}/{interpolated_fps})"
         )
 
+        if settings["adaptive_interpolation"] and analysis is not None and not pre_interpolated:
+            try:
+                motion_threshold = float(settings["adaptive_interpolation_threshold"])
+            except (ValueError, TypeError, KeyError):
+                motion_threshold = 0.01
+
+            factor = Fraction(video.fps) / old_fps
+            densities = analysis.get_interpolation_densities(
+                factor, motion_threshold, filled_threshold
+            )
+
+            video = blur.interpolate.thin_interpolation(video, factor, densities)
+
+            if settings["debug"]:
+                thinned = sum(density is not None for density in densities)
+                print(f"adaptive interpolation: {thinned}/{len(densities)} frames thinned")
+
+if pending_dedupe_runs is not None:
+    # already at or above the interpolated fps, only the runs need filling
+    video = planner.prepare(video, "svp dedupe", (vs.YUV420P8,))
+    video = blur.interpolate.interpolate_svp_deduplicated(
+        video,
+        is_full_color_range=is_full_color_range,
+        runs=pending_dedupe_runs,
+        new_fps=video.fps,
+        preset=settings["svp_interpolation_preset"],
+        algorithm=svp_interpolation_algorithm,
+        blocksize=interpolation_blocksize,
+        overlap=0,
+        masking=interpolation_mask_area,
+        gpu=settings["gpu_interpolation"],
+    )
+
 # output timescale
-if settings["timescale"]:
+if settings["timescale"] and not interp_cache:
     output_timescale = float(settings["output_timescale"])
     if output_timescale != 1:
         video = u.assume_scaled_fps(video, output_timescale)
 
-# blurring
-if settings["blur"]:
-    if settings["blur_amount"] > 0:
-        frame_gap = int(video.fps / settings["blur_output_fps"])
-        blur_frames = int(frame_gap * settings["blur_amount"])
-
-        if blur_frames > 0:
-            # number of weights must be odd
-            if blur_frames % 2 == 0:
-                blur_frames += 1
-
-            weights = blur.weighting.parse(
-                blur_frames,
-                weighting_type=settings["blur_weighting"],
-                gaussian_std_dev=settings["blur_weighting_gaussian_std_dev"],
-                gaussian_mean=settings["blur_weighting_gaussian_mean"],
-                gaussian_bound=json.loads(settings["blur_weighting_gaussian_bound"]),
-            )
 
-            gamma = float(settings["blur_gamma"])
-            if gamma == 1.0:
-                video = blur.blending.average(video, weights)
+def get_blur_frames(video, settings) -> int:
+    if not settings["blur"] or settings["blur_amount"] <= 0:
+        return 0
+
+    frame_gap = int(video.fps / settings["blur_output_fps"])
+    blur_frames = int(frame_gap * settings["blur_amount"])
+
+    # number of weights must be odd
+    if blur_frames > 0 and blur_frames % 2 == 0:
+        blur_frames += 1
+
+    return blur_frames
+
+
+def blur_and_filter(video, settings):
+    # blurring
+    if settings["blur"]:
+        if settings["blur_amount"] > 0:
+            blur_frames = get_blur_frames(video, settings)
+
+            if blur_frames > 0:
+                weights = blur.weighting.parse(
+                    blur_frames,
+                    weighting_type=settings["blur_weighting"],
+                    gaussian_std_dev=settings["blur_weighting_gaussian_std_dev"],
+                    gaussian_mean=settings["blur_weighting_gaussian_mean"],
+                    gaussian_bound=json.loads(settings["blur_weighting_gaussian_bound"]),
+                )
+
+                gamma = float(settings["blur_gamma"])
+                if gamma == 1.0:
+                    # plain averaging works in anything, no need to leave the current format
+                    video = planner.prepare(video, "blend")
+                    video = blur.blending.average(video, weights)
+                else:
+                    # integer sources blend through lookup tables, anything already in float stays there
+                    lut_format = blur.blending.get_gamma_lut_format(planner.output_format)
+                    video = planner.prepare(
+                        video,
+                        "gamma blend",
+                        (lut_format, rgb_float) if lut_format else (rgb_float,),
+                    )
+
+                    if video.format.id == lut_format:
+                        # linear frames are float in between, half when half precision is on
+                        planner.hold(video, rgb_float)
+                        video = blur.blending.average_bright_lut(
+                            video, gamma, weights, linear_format=rgb_float
+                        )
+                    else:
+                        video = blur.blending.average_bright(
+                            video, is_full_color_range, gamma, weights
+                        )
+
+        # set exact fps
+        video = blur.interpolate.change_fps(video, settings["blur_output_fps"])
+
+    # filters
+    if settings["filters"]:
+        if (
+            settings["brightness"] != 1
+            or settings["contrast"] != 1
+            or settings["saturation"] != 1
+        ):
+            if planner.output_format.color_family == vs.YUV:
+                # works in any yuv format. rgb left by a gamma blend goes to the output format, it'd be converted
+                # there at the end anyway
+                video = planner.prepare(
+                    video,
+                    "filters",
+                    None
+                    if video.format.color_family == vs.YUV
+                    else (planner.output_format.id,),
+                )
+                video = blur.filters.tweak(
+                    video,
+                    is_full_color_range,
+                    brightness=settings["brightness"] - 1,
+                    contrast=settings["contrast"],
+                    saturation=settings["saturation"],
+                )
             else:
-                video = blur.blending.average_bright(
-                    video, is_full_color_range, gamma, weights
+                video = planner.prepare(video, "filters", (vs.YUV444PS,))
+                video = core.adjust.Tweak(
+                    video,
+                    bright=settings["brightness"] - 1,
+                    cont=settings["contrast"],
+                    sat=settings["saturation"],
                 )
 
-    # set exact fps
-    video = blur.interpolate.change_fps(video, settings["blur_output_fps"])
-
-# filters
-if settings["filters"]:
-    if (
-        settings["brightness"] != 1
-        or settings["contrast"] != 1
-        or settings["saturation"] != 1
-    ):
-        video = u.with_format(
-            video,
-            is_full_color_range,
-            vs.YUV444PS,
-            lambda video: core.adjust.Tweak(
-                video,
-                bright=settings["brightness"] - 1,
-                cont=settings["contrast"],
-                sat=settings["saturation"],
-            ),
+    return video
+
+
+# extra configs rendered off the same interpolated clip. blur splits them back apart into their own outputs
+branches = json.loads(vars().get("branches", "[]"))
+
+# frames each output frame is blended from, the most any output needs cached at once
+blend_window = (
+    0
+    if interp_cache_write
+    else max(get_blur_frames(video, branch) for branch in [settings] + branches)
+)
+
+if interp_cache_write:
+    # caching pass, the interpolated frames are the output
+    video = planner.finish(video)
+    blur.cache.write_meta(video, Path(interp_cache_write))
+elif branches:
+    outputs = [
+        planner.finish(blur_and_filter(video, branch))
+        for branch in [settings] + branches
+    ]
+
+    if static_area is not None:
+        outputs = [
+            blur.regions.paste(output, static_background, static_area)
+            for output in outputs
+        ]
+
+    # interleaving needs them all at the same rate, slower ones get padded with duplicates that blur drops again
+    common_fps = max(int(branch["blur_output_fps"]) for branch in [settings] + branches)
+    outputs = [
+        output
+        if output.fps == common_fps
+        else blur.interpolate.change_fps(output, common_fps)
+        for output in outputs
+    ]
+
+    length = min(len(output) for output in outputs)
+    video = core.std.Interleave([output[:length] for output in outputs])
+else:
+    video = planner.finish(blur_and_filter(video, settings))
+
+    if static_area is not None:
+        video = blur.regions.paste(video, static_background, static_area)
+
+if settings["debug"]:
+    print(f"formats: {planner.describe()}")
+
+# cache sized in bytes from the biggest frames the pipeline holds instead of vapoursynth's fixed default, so high
+# resolution float jobs keep their blend window cached without going past what blur allows
+memory_budget = u.safe_int(vars().get("memory_budget"))
+if memory_budget:
+    # safety cap on frames in flight so the budget isn't overrun, vspipe requests as many frames at once as there are
+    # threads. it doesn't shrink what each thread holds, so below the cap memory use and speed are unchanged
+    thread_limit = blur.formats.get_thread_limit(
+        planner.max_frame_bytes, blend_window, memory_budget
+    )
+    if thread_limit < core.num_threads:
+        if settings["debug"]:
+            print(f"threads: {core.num_threads} -> {thread_limit} to fit memory budget")
+
+        core.num_threads = thread_limit
+
+    if settings["debug"]:
+        # compare against the peak memory blur records for the render
+        working_set = blur.formats.get_thread_working_set(
+            planner.max_frame_bytes, blend_window
+        )
+        print(
+            f"working set: {working_set // (1024 * 1024)} MB per thread, "
+            f"{working_set * core.num_threads // (1024 * 1024)} MB total"
         )
 
+    cache_size = blur.formats.get_cache_size(
+        planner.max_frame_bytes, blend_window, core.num_threads, memory_budget
+    )
+    core.max_cache_size = cache_size // (1024 * 1024)
+
+    if settings["debug"]:
+        print(f"cache size: {core.max_cache_size} MB")
+
+if streaming:
+    video = blur.stream.report_latency(video, arrivals, source_fps)
 
 video.set_output()
@@ -0,0 +1,224 @@
+import vapoursynth as vs
+from vapoursynth import core
+
+import base64
+import json
+import math
+import os
+import sys
+from array import array
+from fractions import Fraction
+from pathlib import Path
+
+# has to match source_analysis::VERSION. bumped whenever the way anything in the sidecar is measured changes, older
+# ones are redone
+VERSION = 5
+
+# the fallback scales the change map down bilinearly rather than with ffmpeg's area scaling, so its sidecars are
+# versioned apart: blur doesn't count them as current and redoes them natively, they're only reused when that keeps
+# failing
+FALLBACK_VERSION = 1000 + VERSION
+
+# has to match source_analysis::ANALYSIS_WIDTH/HEIGHT
+ANALYSIS_SIZE = (320, 180)
+
+# has to match source_analysis::TILE_SIZE/COLUMNS/ROWS, the change map grid over ANALYSIS_SIZE
+TILE_SIZE = 10
+TILE_COLUMNS = 32
+TILE_ROWS = 18
+
+
+def encode_floats(values: list[float]) -> str:
+    # stored as little endian float32s, a json number per frame adds up on long videos
+    encoded = array("f", values)
+    if sys.byteorder != "little":
+        encoded.byteswap()
+
+    return base64.b64encode(encoded.tobytes()).decode()
+
+
+def decode_floats(data: str) -> list[float]:
+    decoded = array("f")
+    decoded.frombytes(base64.b64decode(data))
+
+    if sys.byteorder != "little":
+        decoded.byteswap()
+
+    return decoded.tolist()
+
+
+class SourceAnalysis:
+    """
+    settings-independent analysis of a source, saved by blur per source hash so it's only done once per video
+
+    diffs[n] is the mean absolute 8-bit luma difference (0-1) between frame n and n - 1 at the source's size, what
+    PlaneStatsDiff gives and what deduplicate threshold is compared against, diffs[0] is 0.
+    tiles[row * TILE_COLUMNS + column] is the most any pixel of that tile of the grid ever differs (0-1) from the
+    first frame, measured on luma scaled down to ANALYSIS_SIZE
+    """
+
+    def __init__(self, diffs: list[float], tiles: list[float], version: int = VERSION):
+        self.diffs = diffs
+        self.tiles = tiles
+        self.version = version
+
+    def get_duplicate_runs(
+        self, threshold: float, max_frames: int | None = None
+    ) -> list[tuple[int, int]]:
+        """
+        (last good frame, next good frame) around every run of duplicates, the frames between them are duplicates.
+        runs without a good frame after them within max_frames are left as they are, there's nothing to interpolate
+        towards
+        """
+        runs = []
+
+        n = 1
+        while n < len(self.diffs):
+            if self.diffs[n] >= threshold:
+                n += 1
+                continue
+
+            next_good = n + 1
+            while next_good < len(self.diffs) and self.diffs[next_good] < threshold:
+                next_good += 1
+
+            if next_good < len(self.diffs) and (
+                not max_frames or next_good - n <= max_frames
+            ):
+                runs.append((n - 1, next_good))
+
+            n = next_good + 1
+
+        return runs
+
+    def get_interpolation_densities(
+        self, factor: Fraction, threshold: float, ignore_below: float = 0.0
+    ) -> list[int | None]:
+        """
+        interpolated frames worth making between each frame and the next, in proportion to how much they differ up
+        to the full factor at threshold. None where it's the full factor anyway. diffs under ignore_below are
+        duplicates that deduplication replaced with moving frames, so they get the full factor too
+        """
+        densities = []
+
+        for n in range(len(self.diffs)):
+            diff = self.diffs[n + 1] if n + 1 < len(self.diffs) else threshold
+            if diff >= threshold or diff < ignore_below:
+                densities.append(None)
+                continue
+
+            density = max(1, math.ceil(factor * diff / threshold))
+            densities.append(density if density < factor else None)
+
+        return densities
+
+    def get_changing_tiles(self, threshold: float) -> tuple[int, int, int, int] | None:
+        """
+        (left, top, right, bottom) tile bounds, right and bottom exclusive, around every tile that changed by
+        threshold or more at some point. None if none did
+        """
+        changing = [
+            (n % TILE_COLUMNS, n // TILE_COLUMNS)
+            for n, diff in enumerate(self.tiles)
+            if diff >= threshold
+        ]
+        if not changing:
+            return None
+
+        columns = [column for column, _ in changing]
+        rows = [row for _, row in changing]
+        return (min(columns), min(rows), max(columns) + 1, max(rows) + 1)
+
+    def to_json(self) -> dict:
+        return {
+            "version": self.version,
+            "frames": len(self.diffs),
+            "diffs": encode_floats(self.diffs),
+            "tile_columns": TILE_COLUMNS,
+            "tile_rows": TILE_ROWS,
+            "tiles": encode_floats(self.tiles),
+        }
+
+    @staticmethod
+    def from_json(data: dict) -> "SourceAnalysis | None":
+        version = data.get("version")
+        if version not in (VERSION, FALLBACK_VERSION):
+            return None
+
+        if (data["tile_columns"], data["tile_rows"]) != (TILE_COLUMNS, TILE_ROWS):
+            return None
+
+        diffs = decode_floats(data["diffs"])
+        tiles = decode_floats(data["tiles"])
+
+        if len(diffs) != data["frames"] or len(tiles) != TILE_COLUMNS * TILE_ROWS:
+            return None
+
+        return SourceAnalysis(diffs, tiles, version)
+
+
+def analyse(clip: vs.VideoNode) -> SourceAnalysis:
+    """
+    fallback for when blur couldn't analyse it natively. diffs are measured the same way, the change map is close
+    """
+    full_luma = core.std.ShufflePlanes(clip, planes=0, colorfamily=vs.GRAY)
+    full_luma = core.resize.Point(full_luma, format=vs.GRAY8)
+    diffclip = core.std.PlaneStats(full_luma, full_luma[0] + full_luma)
+
+    luma = core.resize.Bilinear(full_luma, *ANALYSIS_SIZE)
+
+    # largest difference from the first frame around the middle of each tile, then just that pixel of each tile.
+    # the maximums reach a pixel into the next tile, which only ever makes it look like it changes more
+    tileclip = core.std.Expr([luma, luma[0] * len(luma)], "x y - abs")
+    for _ in range(TILE_SIZE // 2):
+        tileclip = core.std.Maximum(tileclip)
+    tileclip = core.resize.Point(tileclip, TILE_COLUMNS, TILE_ROWS)
+
+    diffs = []
+    tiles = [0.0] * (TILE_COLUMNS * TILE_ROWS)
+    for diff_frame, tile_frame in zip(diffclip.frames(), tileclip.frames()):
+        diffs.append(diff_frame.props["PlaneStatsDiff"])
+
+        rows = memoryview(tile_frame[0]).tolist()
+        for row in range(TILE_ROWS):
+            for column in range(TILE_COLUMNS):
+                n = row * TILE_COLUMNS + column
+                tiles[n] = max(tiles[n], rows[row][column] / 255)
+
+    diffs[0] = 0.0
+
+    return SourceAnalysis(diffs, tiles, FALLBACK_VERSION)
+
+
+def load(path: Path, clip: vs.VideoNode) -> SourceAnalysis | None:
+    try:
+        analysis = SourceAnalysis.from_json(json.loads(path.read_text()))
+    except (OSError, ValueError, KeyError, TypeError):
+        return None
+
+    # different decoders can disagree on frame counts, don't trust it then
+    if analysis is None or len(analysis.diffs) != len(clip):
+        return None
+
+    return analysis
+
+
+def load_or_create(path: Path, clip: vs.VideoNode) -> SourceAnalysis:
+    analysis = load(path, clip)
+    if analysis is not None:
+        print("using saved source analysis")
+        return analysis
+
+    print("analysing source (only needed once per video)")
+    analysis = analyse(clip)
+
+    # written to the side and renamed so renders of the same video running at once never see half a file
+    temp_path = path.with_name(f"{path.name}.{os.getpid()}.tmp")
+    try:
+        temp_path.write_text(json.dumps(analysis.to_json()))
+        os.replace(temp_path, path)
+    except OSError as e:
+        print(f"failed to save source analysis: {e}")
+        temp_path.unlink(missing_ok=True)
+
+    return analysis
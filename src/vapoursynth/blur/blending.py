@@ -104,4 +104,52 @@ def average_bright(
 
         return video
 
-    return u.with_format(_video, is_full_color_range, vs.RGBS, process)
+    # half float works as well (the planner leaves it in RGBH when half precision is on)
+    return u.with_format(_video, is_full_color_range, (vs.RGBS, vs.RGBH), process)
+
+
+# integer rgb the lut blend can start from, by source bit depth. above 12-bit the table stops being worth it
+LUT_FORMATS = {
+    8: vs.RGB24,
+    10: vs.RGB30,
+    12: vs.RGB36,
+}
+
+
+def get_gamma_lut_format(output_format: vs.VideoFormat) -> int | None:
+    if output_format.sample_type != vs.INTEGER:
+        return None
+
+    return LUT_FORMATS.get(output_format.bits_per_sample)
+
+
+def average_bright_lut(
+    video: vs.VideoNode,
+    gamma: float,
+    weights: list[float],
+    divisor: float | None = None,
+    linear_format: int = vs.RGBS,
+):
+    """
+    same as average_bright for 8-12 bit integer rgb without a conversion to float and a pow for every source frame.
+    a lookup table takes each sample straight to float linear, the blend runs on that and the pow back only happens
+    once per output frame, into the integer format again. linear has to stay float, 16-bit integer linear can't
+    tell the darkest levels apart and crushes shadows. half float can (its precision follows the value), so with
+    linear_format RGBH the table writes half and the blend reads half the bytes per frame
+    """
+    bits = video.format.bits_per_sample
+    peak = (1 << bits) - 1
+
+    to_linear = [(i / peak) ** gamma for i in range(peak + 1)]
+
+    video = core.std.Lut(
+        video,
+        planes=[0, 1, 2],
+        lutf=to_linear,
+        bits=core.get_video_format(linear_format).bits_per_sample,
+        floatout=True,
+    )
+    video = average(video, weights, divisor)
+    return core.std.Expr(
+        video, f"x 0 max {1.0 / gamma} pow {peak} *", format=LUT_FORMATS[bits]
+    )
@@ -0,0 +1,41 @@
+import vapoursynth as vs
+from vapoursynth import core
+
+import json
+from pathlib import Path
+
+import blur.utils as u
+
+
+def write_meta(clip: vs.VideoNode, meta_path: Path):
+    """
+    the interpolated fps usually isn't something the container keeps exactly, so it's saved alongside the frames
+    """
+    meta = {
+        "fps_num": clip.fps.numerator,
+        "fps_den": clip.fps.denominator,
+        "frames": len(clip),
+    }
+
+    meta_path.write_text(json.dumps(meta))
+
+
+def load(video_path: Path, meta_path: Path, enable_lsmash: bool) -> vs.VideoNode:
+    try:
+        meta = json.loads(meta_path.read_text())
+        fps_num = int(meta["fps_num"])
+        fps_den = int(meta["fps_den"])
+        frames = int(meta["frames"])
+    except (OSError, ValueError, KeyError) as e:
+        raise u.BlurException(f"Interpolation cache entry is broken ({e}), try clearing the cache")
+
+    if enable_lsmash:
+        clip = core.lsmas.LWLibavSource(
+            source=video_path, cache=0, fpsnum=fps_num, fpsden=fps_den
+        )
+    else:
+        clip = core.bs.VideoSource(
+            source=video_path, cachemode=0, fpsnum=fps_num, fpsden=fps_den
+        )
+
+    return clip[:frames] if len(clip) > frames else clip
@@ -1,37 +1,16 @@
 import vapoursynth as vs
 from vapoursynth import core
 
+import threading
+from collections import OrderedDict
+
 import blur.interpolate
 import blur.utils as u
+from blur.analysis import SourceAnalysis
 
-cur_interp = None
-dupe_last_good_idx = 0
-dupe_next_good_idx = 0
-duped_frames = 0
-
-
-def find_next_good_frame(clip, duplicate_index: int, threshold: float, max_frames: int):
-    duped_frame = clip[duplicate_index]
-    index = duplicate_index + 1
-    last_possible_index = len(clip) - 1  # for clarity (this shit always trips me up)
-
-    if max_frames:
-        max_permitted = duplicate_index + max_frames
-        if last_possible_index > max_permitted:
-            last_possible_index = max_permitted
-
-    while index <= last_possible_index:
-        test_frame = clip[index]
-        diffclip = core.std.PlaneStats(test_frame, duped_frame)
-
-        for frame_index2, frame2 in enumerate(diffclip.frames()):
-            if frame2.props["PlaneStatsDiff"] >= threshold:
-                return index
-
-        index += 1
-
-    return None
-
+# interpolators kept around per vapoursynth thread. frames are asked for roughly in order, so only the runs threads
+# are in the middle of get reused
+RUN_INTERPS_PER_THREAD = 2
 
 def create_rife_interp(good_frames, duped_frames, model_path: str, gpu_index: int):
     interp = core.rife.RIFE(
@@ -86,83 +65,173 @@ def create_svp_interp(
     return interp[1 : 1 + duped_frames]  # first frame is a duplicate
 
 
-def get_interp(
-    clip,
-    duplicate_index: int,
-    threshold: float,
-    max_frames: int,
-    interp_creator,
-    **kwargs,
-):
-    global cur_interp, dupe_last_good_idx, dupe_next_good_idx, duped_frames
+class DiffCache:
+    """
+    PlaneStats diffs between each frame and the one before it, remembered so walking over a run only measures each
+    frame once. safe to use from any thread
+    """
 
-    dupe_last_good_idx = duplicate_index - 1
-    dupe_next_good_idx = find_next_good_frame(
-        clip, duplicate_index, threshold, max_frames
-    )
+    def __init__(self, video: vs.VideoNode):
+        self.diffclip = core.std.PlaneStats(video, video[0] + video)
+        self.diffs = {0: 0.0}
+        self.lock = threading.Lock()
 
-    if not dupe_next_good_idx:
-        cur_interp = None
-        return
+    def set(self, n: int, diff: float):
+        with self.lock:
+            self.diffs[n] = diff
 
-    duped_frames = dupe_next_good_idx - dupe_last_good_idx
+    def get(self, n: int) -> float:
+        with self.lock:
+            diff = self.diffs.get(n)
 
-    # generate fake clip which includes the two good frames. this will be used to interpolate between them.
-    # todo: possibly including more frames will result in better results?
-    good_frames = clip[dupe_last_good_idx] + clip[dupe_next_good_idx]
+        if diff is None:
+            # not holding the lock while waiting on the frame, other threads can keep going
+            diff = self.diffclip.get_frame(n).props["PlaneStatsDiff"]
+            self.set(n, diff)
 
-    cur_interp = interp_creator(good_frames, duped_frames, **kwargs)
-    cur_interp = core.std.AssumeFPS(cur_interp, fpsnum=1, fpsden=1)
+        return diff
 
 
-def interpolate_dupes(
-    clip, frame_index: int, threshold: float, max_frames: int, interp_creator, **kwargs
+def create_run_finder(
+    length: int, diffs: DiffCache, threshold: float, max_frames: int | None
 ):
-    global cur_interp, dupe_last_good_idx, dupe_next_good_idx
+    """
+    measures the diffs around a duplicate as they're needed, for when there's no source analysis (live and streamed
+    input). finds the same runs SourceAnalysis.get_duplicate_runs would
+    """
 
-    clip1 = core.std.AssumeFPS(clip, fpsnum=1, fpsden=1)
+    def find_run(n: int) -> tuple[int, int] | None:
+        if n == 0 or diffs.get(n) >= threshold:
+            return None
 
-    if cur_interp is None:
-        # haven't interpolated yet
-        get_interp(clip1, frame_index, threshold, max_frames, interp_creator, **kwargs)
+        first_dupe = n
+        while first_dupe > 1 and diffs.get(first_dupe - 1) < threshold:
+            first_dupe -= 1
 
-    if cur_interp is None:
-        # interpolated but no dedupe solution. get out
-        return clip
+            if max_frames and n - first_dupe >= max_frames:
+                return None  # already too long to fill
 
-    # combine the good frames with the interpolated ones so that vapoursynth can use them by indexing
-    # (i hate how you have to do this, there might be nicer way idk)
-    good_before = core.std.Trim(clip1, first=0, last=dupe_last_good_idx)
-    good_after = core.std.Trim(clip1, first=dupe_next_good_idx)
+        next_good = n + 1
+        while next_good < length and diffs.get(next_good) < threshold:
+            next_good += 1
 
-    joined = good_before + cur_interp + good_after
+            if max_frames and next_good - first_dupe > max_frames:
+                return None
 
-    return core.std.AssumeFPS(joined, src=clip)
+        if next_good >= length:
+            return None  # nothing to interpolate towards
 
+        return first_dupe - 1, next_good
 
-def create_frame_handler(video, threshold, max_frames, interp_creator, debug, **kwargs):
-    def handle_frames(n, f):
-        global cur_interp
+    return find_run
 
-        if f.props["PlaneStatsDiff"] >= threshold or n == 0:
-            cur_interp = None
+
+def create_run_table(length: int, runs: list[tuple[int, int]]):
+    run_at = [None] * length
+    for run in runs:
+        last_good, next_good = run
+        for n in range(last_good + 1, next_good):
+            run_at[n] = run
+
+    return lambda n: run_at[n]
+
+
+def fill_runs(
+    video: vs.VideoNode,
+    find_run,
+    interp_creator,
+    debug: bool,
+    prop_src: DiffCache | None = None,
+    **kwargs,
+):
+    """
+    replaces each run of duplicates with frames interpolated between the good frames either side. find_run gives
+    the (last good, next good) frames around a duplicate, or None for a good frame or a run that can't be filled.
+
+    frame n only depends on n, so frames can be requested in any order from any number of threads. each run is
+    interpolated once, the first time one of its frames is needed. its interpolator is dropped once all of its
+    frames have been handed out, or when too many newer runs have been started since (then it's made again if a
+    frame of it is asked for again)
+    """
+    clip1 = core.std.AssumeFPS(video, fpsnum=1, fpsden=1)
+
+    # run -> (interpolator, offsets of its frames not handed out yet), least recently used first
+    run_interps: OrderedDict[tuple[int, int], tuple[vs.VideoNode, set[int]]] = (
+        OrderedDict()
+    )
+    run_interps_lock = threading.Lock()
+    max_run_interps = max(core.num_threads, 1) * RUN_INTERPS_PER_THREAD
+
+    def get_run_frame(run: tuple[int, int], offset: int) -> vs.VideoNode:
+        with run_interps_lock:
+            entry = run_interps.get(run)
+            if entry is None:
+                last_good, next_good = run
+                good_frames = clip1[last_good] + clip1[next_good]
+                entry = (
+                    interp_creator(good_frames, next_good - last_good, **kwargs),
+                    set(range(next_good - last_good - 1)),
+                )
+                run_interps[run] = entry
+
+                while len(run_interps) > max_run_interps:
+                    run_interps.popitem(last=False)
+            else:
+                run_interps.move_to_end(run)
+
+            interp, remaining = entry
+            remaining.discard(offset)
+            if not remaining:
+                del run_interps[run]
+
+            return interp[offset]
+
+    def handle_frame(n, f=None):
+        if f is not None:
+            # own diff came in with the frame, saves waiting on it
+            prop_src.set(n, f.props["PlaneStatsDiff"])
+
+        run = find_run(n)
+        if run is None:
             return video
 
-        interp = interpolate_dupes(
-            video, n, threshold, max_frames, interp_creator, **kwargs
-        )
+        last_good, next_good = run
+        frame = get_run_frame(run, n - last_good - 1)
 
         if debug:
-            gap = duped_frames - 1
-            return core.text.Text(
-                clip=interp,
-                text=f"duplicate, {gap} gap, diff: {f.props['PlaneStatsDiff']:.4f}",
+            frame = core.text.Text(
+                clip=frame,
+                text=f"duplicate, {next_good - last_good - 1} gap",
                 alignment=8,
             )
 
-        return interp
+        # frameeval wants frame n, so the one interpolated frame is looped out that far
+        return core.std.AssumeFPS(frame * (n + 1), src=video)
+
+    if prop_src:
+        return core.std.FrameEval(video, handle_frame, prop_src=prop_src.diffclip)
+
+    return core.std.FrameEval(video, handle_frame)
+
+
+def fill_drops(
+    video: vs.VideoNode,
+    analysis: SourceAnalysis | None,
+    threshold: float,
+    max_frames: int | None,
+    interp_creator,
+    debug: bool,
+    **kwargs,
+):
+    if analysis:
+        find_run = create_run_table(
+            len(video), analysis.get_duplicate_runs(threshold, max_frames)
+        )
+        return fill_runs(video, find_run, interp_creator, debug, **kwargs)
 
-    return handle_frames
+    diffs = DiffCache(video)
+    find_run = create_run_finder(len(video), diffs, threshold, max_frames)
+    return fill_runs(video, find_run, interp_creator, debug, prop_src=diffs, **kwargs)
 
 
 def fill_drops_rife(
@@ -172,14 +241,15 @@ def fill_drops_rife(
     gpu_index: int,
     threshold: float = 0.1,
     max_frames: int | None = None,
+    analysis: SourceAnalysis | None = None,
     debug=False,
 ):
     u.check_model_path(model_path)
 
     def process(video):
-        diffclip = core.std.PlaneStats(video, video[0] + video)
-        handler = create_frame_handler(
+        return fill_drops(
             video,
+            analysis,
             threshold,
             max_frames,
             create_rife_interp,
@@ -187,9 +257,8 @@ def fill_drops_rife(
             model_path=model_path,
             gpu_index=gpu_index,
         )
-        return core.std.FrameEval(video, handler, prop_src=diffclip)
 
-    return u.with_format(_video, is_full_color_range, vs.RGBS, process)
+    return u.with_format(_video, is_full_color_range, (vs.RGBS, vs.RGBH), process)
 
 
 def fill_drops_multiple(
@@ -202,12 +271,13 @@ def fill_drops_multiple(
     svp_blocksize=blur.interpolate.DEFAULT_BLOCKSIZE,
     svp_masking=blur.interpolate.DEFAULT_MASKING,
     svp_gpu=blur.interpolate.DEFAULT_GPU,
+    analysis: SourceAnalysis | None = None,
     debug=False,
 ):
     def process(video):
-        diffclip = core.std.PlaneStats(video, video[0] + video)
-        handler = create_frame_handler(
+        return fill_drops(
             video,
+            analysis,
             threshold,
             max_frames,
             create_svp_interp,
@@ -218,7 +288,6 @@ def fill_drops_multiple(
             svp_masking=svp_masking,
             svp_gpu=svp_gpu,
         )
-        return core.std.FrameEval(video, handler, prop_src=diffclip)
 
     return u.with_format(_video, is_full_color_range, vs.YUV420P8, process)
 
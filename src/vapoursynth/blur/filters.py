@@ -0,0 +1,57 @@
+import vapoursynth as vs
+from vapoursynth import core
+
+
+def get_ranges(
+    format: vs.VideoFormat, is_full_color_range: bool
+) -> tuple[tuple[float, float], tuple[float, float]]:
+    """
+    (min, max) of luma and chroma in format, what adjust.Tweak's float 0-1 and -0.5-0.5 map to
+    """
+    if format.sample_type == vs.FLOAT:
+        return (0.0, 1.0), (-0.5, 0.5)
+
+    bits = format.bits_per_sample
+    if is_full_color_range:
+        peak = (1 << bits) - 1
+        return (0, peak), (0, peak)
+
+    shift = bits - 8
+    return (16 << shift, 235 << shift), (16 << shift, 240 << shift)
+
+
+def tweak(
+    video: vs.VideoNode,
+    is_full_color_range: bool,
+    brightness: float,
+    contrast: float,
+    saturation: float,
+):
+    """
+    adjust.Tweak's float brightness, contrast and saturation as one expr in the video's own yuv format. going through
+    YUV444PS meant upsampling chroma to float and back every frame for what's a multiply and add per sample
+
+    brightness is an offset (0 = unchanged) in the same units as Tweak's float path, a fraction of the luma range
+    """
+    (luma_min, luma_max), (chroma_min, chroma_max) = get_ranges(
+        video.format, is_full_color_range
+    )
+    chroma_mid = (
+        (chroma_min + chroma_max + 1) // 2
+        if video.format.sample_type == vs.INTEGER
+        else 0.0
+    )
+
+    luma = ""
+    if brightness != 0 or contrast != 1:
+        offset = luma_min + brightness * (luma_max - luma_min)
+        luma = f"x {luma_min} - {contrast} * {offset} + {luma_min} max {luma_max} min"
+
+    chroma = ""
+    if saturation != 1:
+        chroma = f"x {chroma_mid} - {saturation} * {chroma_mid} + {chroma_min} max {chroma_max} min"
+
+    if not luma and not chroma:
+        return video
+
+    return core.std.Expr(video, [luma, chroma, chroma])
@@ -0,0 +1,155 @@
+import vapoursynth as vs
+from vapoursynth import core
+
+
+def convert(video: vs.VideoNode, target_format: int, is_full_color_range: bool):
+    orig_format = video.format
+    target = core.get_video_format(target_format)
+
+    kwargs = {
+        "format": target_format,
+        "range_in": is_full_color_range,
+        "range": is_full_color_range,
+    }
+
+    if orig_format.color_family == vs.YUV and target.color_family == vs.RGB:
+        kwargs["matrix_in_s"] = "709"
+    elif orig_format.color_family == vs.RGB and target.color_family == vs.YUV:
+        kwargs["matrix_s"] = "709"
+
+    return core.resize.Point(video, **kwargs)
+
+
+def resize(video: vs.VideoNode, width: int, height: int) -> vs.VideoNode:
+    """
+    scales to the output resolution setting. a height of 0 keeps the size, a width of 0 keeps the aspect ratio (even,
+    like ffmpeg's -2, has to match config_blur::get_working_size)
+    """
+    if not height:
+        return video
+
+    if not width:
+        width = round(video.width * height / video.height / 2) * 2
+
+    # subsampled chroma needs sizes it divides into
+    width -= width % (1 << video.format.subsampling_w)
+    height -= height % (1 << video.format.subsampling_h)
+
+    if (width, height) == (video.width, video.height):
+        return video
+
+    return core.resize.Spline36(video, width, height)
+
+
+def get_frame_bytes(format: vs.VideoFormat, width: int, height: int) -> int:
+    total = 0
+    for plane in range(format.num_planes):
+        plane_width = width if plane == 0 else width >> format.subsampling_w
+        plane_height = height if plane == 0 else height >> format.subsampling_h
+        total += plane_width * plane_height * format.bytes_per_sample
+
+    return total
+
+
+# vapoursynth's cache never goes below this, small videos don't need sizing
+MIN_CACHE_BYTES = 1024 * 1024 * 1024
+
+# frames a thread holds on top of its blend window: the two frames either side that interpolation (or filling a
+# duplicate run) works between, the output frame it's making, and the finished one waiting its turn in vspipe's
+# in-order output queue
+EXTRA_FRAMES_PER_THREAD = 2 + 1 + 1
+
+
+def get_thread_working_set(frame_bytes: int, window: int) -> int:
+    """
+    bytes of frames one thread has to hold at once to make an output frame. counted at the biggest frame size the
+    pipeline holds, so it errs high for stages in smaller formats
+    """
+    return frame_bytes * (window + EXTRA_FRAMES_PER_THREAD)
+
+
+def get_cache_size(
+    frame_bytes: int, window: int, threads: int, memory_budget: int
+) -> int:
+    """
+    bytes of frame cache needed to keep every thread's blend window around, within the memory budget. vapoursynth
+    counts frames against its cache limit, not formats, so a 4k RGBS job needs 6x the cache of 8-bit 4:2:0 to hold
+    the same frames
+    """
+    wanted = get_thread_working_set(frame_bytes, window) * max(threads, 1)
+    return min(max(wanted, MIN_CACHE_BYTES), max(memory_budget, MIN_CACHE_BYTES))
+
+
+def get_thread_limit(frame_bytes: int, window: int, memory_budget: int) -> int:
+    """
+    most threads whose working sets fit in the memory budget together. every thread works on its own output frame
+    and holds its whole window of source frames while it does, outside of what the cache limit controls, so at 4k
+    and up in float a few threads can already fill the budget. past that they'd evict each other's frames and make
+    them again, or push the machine into swap
+
+    this is only a safety cap on how many windows are held at once. each thread still holds whole frames, nothing
+    here makes a thread's own working set smaller
+    """
+    per_thread = get_thread_working_set(frame_bytes, window)
+    return max(1, max(memory_budget, MIN_CACHE_BYTES) // max(per_thread, 1))
+
+
+class FormatPlanner:
+    """
+    picks the working format for each stage as the pipeline is built. stages used to convert to their own format and
+    back again, now frames stay in whatever format the last stage left them in and only get converted when a stage
+    can't work in it, straight from one working format to the next. they go back to the output format once at the end
+
+    call prepare before each stage with the formats it can work in (none for any), and finish before output
+    """
+
+    def __init__(self, video: vs.VideoNode, is_full_color_range: bool):
+        self.output_format = video.format
+        self.is_full_color_range = is_full_color_range
+        self.stages: list[tuple[str, str, bool]] = []
+
+        # size of the biggest frames held at any point, for sizing the cache
+        self.max_frame_bytes = get_frame_bytes(video.format, video.width, video.height)
+
+    def prepare(
+        self, video: vs.VideoNode, stage: str, formats: tuple[int, ...] | None = None
+    ) -> vs.VideoNode:
+        converted = False
+
+        if formats is not None:
+            if video.format.id not in formats:
+                video = convert(video, formats[0], self.is_full_color_range)
+                converted = True
+        elif video.format.bits_per_sample < self.output_format.bits_per_sample:
+            # a stage that works in anything shouldn't be stuck at lower precision than the output just because
+            # the last one needed 8-bit
+            video = convert(video, self.output_format.id, self.is_full_color_range)
+            converted = True
+
+        self.stages.append((stage, video.format.name, converted))
+
+        self.hold(video, video.format.id)
+
+        return video
+
+    def hold(self, video: vs.VideoNode, format_id: int):
+        """
+        counts frames in a format a stage converts to internally towards the cache size
+        """
+        self.max_frame_bytes = max(
+            self.max_frame_bytes,
+            get_frame_bytes(core.get_video_format(format_id), video.width, video.height),
+        )
+
+    def finish(self, video: vs.VideoNode) -> vs.VideoNode:
+        if video.format.id == self.output_format.id:
+            return video
+
+        return convert(video, self.output_format.id, self.is_full_color_range)
+
+    def describe(self) -> str:
+        steps = [f"source {self.output_format.name}"]
+        for stage, format_name, converted in self.stages:
+            steps.append(f"{stage} ({'-> ' if converted else ''}{format_name})")
+
+        return " > ".join(steps)
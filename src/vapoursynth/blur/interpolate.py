@@ -3,8 +3,10 @@
 import vapoursynth as vs
 from vapoursynth import core
 
+import bisect
 import json
 import math
+from fractions import Fraction
 
 import blur.utils as u
 
@@ -130,6 +132,126 @@ def interpolate_svp(
     return svp(video, is_full_color_range, super_string, vectors_string, smooth_string)
 
 
+def interpolate_svp_deduplicated(
+    video: vs.VideoNode,
+    is_full_color_range: bool,
+    runs: list[tuple[int, int]],
+    new_fps: int | Fraction,
+    preset=DEFAULT_PRESET,
+    algorithm=DEFAULT_ALGORITHM,
+    blocksize=DEFAULT_BLOCKSIZE,
+    overlap=DEFAULT_OVERLAP,
+    speed=DEFAULT_SPEED,
+    masking=DEFAULT_MASKING,
+    gpu=DEFAULT_GPU,
+):
+    """
+    fills duplicate runs and interpolates to new_fps off one motion search, instead of searching every run for
+    dedupe and then the whole deduplicated clip again. the duplicates are dropped and vectors are found between the
+    good frames that are left. each gap between good frames is then interpolated at its length times the
+    interpolation factor, so a gap of 3 duplicates gets 4x the frames a normal one does. there's one SmoothFps for
+    each gap length, all sharing the same vectors
+    """
+    preset = preset.lower()
+
+    if preset not in LEGACY_PRESETS and preset not in NEW_PRESETS:
+        raise vs.Error(f"interpolate: '{preset}' is not a valid preset")
+
+    filled = sorted({n for last_good, next_good in runs for n in range(last_good + 1, next_good)})
+    filled_set = set(filled)
+    good = [n for n in range(len(video)) if n not in filled_set]
+
+    factor = Fraction(new_fps) / video.fps
+    gaps = {next_good - last_good for last_good, next_good in zip(good, good[1:])} | {1}
+
+    [super_string, vectors_string, smooth_string] = generate_svp_strings(
+        new_fps, preset, algorithm, blocksize, overlap, speed, masking, gpu
+    )
+
+    def process(video):
+        good_clip = core.std.DeleteFrames(video, filled) if filled else video
+
+        super = core.svp1.Super(good_clip, super_string)
+        vectors = core.svp1.Analyse(
+            super["clip"], super["data"], good_clip, vectors_string
+        )
+
+        smooth_json = json.loads(smooth_string)
+        smoothed = {}
+        for gap in gaps:
+            rate = factor * gap
+            smooth_json["rate"] = {
+                "num": rate.numerator,
+                "den": rate.denominator,
+                "abs": False,
+            }
+
+            smoothed[gap] = core.svp2.SmoothFps(
+                good_clip,
+                super["clip"],
+                super["data"],
+                vectors["clip"],
+                vectors["data"],
+                json.dumps(smooth_json),
+            )
+
+        def get_frame(n):
+            source_pos = n / factor
+
+            i = bisect.bisect_right(good, source_pos) - 1
+            last_good = good[i]
+            gap = good[i + 1] - last_good if i + 1 < len(good) else 1
+
+            # good frame i sits at i * gap * factor in the clip for this gap length
+            clip = smoothed[gap]
+            index = round(i * gap * factor + (n - last_good * factor))
+            index = min(max(index, 0), len(clip) - 1)
+
+            # frameeval wants frame n, so the one frame is looped out that far
+            return core.std.AssumeFPS(clip[index] * (n + 1), src=base)
+
+        output_fps = video.fps * factor
+        base = video.std.BlankClip(
+            length=math.floor(len(video) * factor),
+            fpsnum=output_fps.numerator,
+            fpsden=output_fps.denominator,
+        )
+        return base.std.FrameEval(eval=get_frame)
+
+    return u.with_format(video, is_full_color_range, vs.YUV420P8, process)
+
+
+def thin_interpolation(
+    video: vs.VideoNode, factor: Fraction, densities: list[int | None]
+) -> vs.VideoNode:
+    """
+    lowers the interpolation rate between source frames with a density from SourceAnalysis.get_interpolation_densities.
+    output frames there are snapped to a coarser grid of interpolated positions and repeated, the interpolator only
+    makes the frames that are asked for so the rest are never made. the frame count and spacing stay the same so
+    blur weights cover the same time as before
+    """
+    if all(density is None for density in densities):
+        return video
+
+    def get_frame(n):
+        source_pos = Fraction(n) / factor
+        pair = min(math.floor(source_pos), len(densities) - 1)
+
+        density = densities[pair]
+        if density is None:
+            return video
+
+        snapped = pair + Fraction(math.floor((source_pos - pair) * density), density)
+        index = min(round(snapped * factor), len(video) - 1)
+        if index == n:
+            return video
+
+        # frameeval wants frame n, so the one frame is looped out that far
+        return core.std.AssumeFPS(video[index] * (n + 1), src=video)
+
+    return video.std.FrameEval(eval=get_frame)
+
+
 def change_fps(clip, fpsnum, fpsden=1):  # this is just directly from havsfunc
     if not isinstance(clip, vs.VideoNode):
         raise vs.Error("ChangeFPS: This is not a clip")
@@ -200,4 +322,4 @@ def interpolate_rife(
             gpu_id=gpu_index,
         )
 
-    return u.with_format(_video, is_full_color_range, vs.RGBS, process)
+    return u.with_format(_video, is_full_color_range, (vs.RGBS, vs.RGBH), process)
@@ -0,0 +1,193 @@
+import vapoursynth as vs
+from vapoursynth import core
+
+import ctypes
+import os
+import threading
+from collections import OrderedDict
+
+import blur.utils as u
+
+# blur looks for this in vspipe's output to tell a finished live render from a failed one
+END_OF_INPUT_MESSAGE = "live input ended"
+
+# clips need a length up front, this is just an upper bound. the render ends when the input does
+MAX_SECONDS = 24 * 60 * 60
+
+CACHE_BYTES = 512 * 1024 * 1024
+MIN_CACHED_FRAMES = 16
+MAX_CACHED_FRAMES = 240
+
+Y4M_FORMATS = {
+    "420jpeg": vs.YUV420P8,
+    "420paldv": vs.YUV420P8,
+    "420mpeg2": vs.YUV420P8,
+    "420": vs.YUV420P8,
+    "422": vs.YUV422P8,
+    "444": vs.YUV444P8,
+    "420p10": vs.YUV420P10,
+    "422p10": vs.YUV422P10,
+    "444p10": vs.YUV444P10,
+    "420p12": vs.YUV420P12,
+    "422p12": vs.YUV422P12,
+    "444p12": vs.YUV444P12,
+    "420p16": vs.YUV420P16,
+    "422p16": vs.YUV422P16,
+    "444p16": vs.YUV444P16,
+    "mono": vs.GRAY8,
+    "mono16": vs.GRAY16,
+}
+
+
+class Y4MReader:
+    def __init__(self, fd: int):
+        self.fd = fd
+
+        header = self._read_line()
+        if header is None or not header.startswith(b"YUV4MPEG2"):
+            raise u.BlurException("Live input isn't a y4m stream")
+
+        self.width = 0
+        self.height = 0
+        self.format = vs.YUV420P8
+
+        for param in header.split()[1:]:
+            key, value = chr(param[0]), param[1:].decode()
+            match key:
+                case "W":
+                    self.width = int(value)
+                case "H":
+                    self.height = int(value)
+                case "C":
+                    chroma = value.split("XYSCSS")[0]
+                    if chroma not in Y4M_FORMATS:
+                        raise u.BlurException(f"Unsupported live input format {value}")
+                    self.format = Y4M_FORMATS[chroma]
+
+        self.format_info = core.get_video_format(self.format)
+
+        bytes_per_sample = self.format_info.bytes_per_sample
+        self.plane_sizes = []
+        for plane in range(self.format_info.num_planes):
+            width = self.width
+            height = self.height
+            if plane > 0:
+                width >>= self.format_info.subsampling_w
+                height >>= self.format_info.subsampling_h
+            self.plane_sizes.append((width * bytes_per_sample, height))
+
+        self.frame_size = sum(row * rows for row, rows in self.plane_sizes)
+
+    def _read_exact(self, size: int) -> bytes | None:
+        chunks = []
+        remaining = size
+        while remaining > 0:
+            chunk = os.read(self.fd, remaining)
+            if not chunk:
+                return None
+            chunks.append(chunk)
+            remaining -= len(chunk)
+
+        return b"".join(chunks)
+
+    def _read_line(self) -> bytes | None:
+        line = bytearray()
+        while True:
+            char = os.read(self.fd, 1)
+            if not char:
+                return None
+            if char == b"\n":
+                return bytes(line)
+            line += char
+
+    def read_frame(self) -> bytes | None:
+        frame_header = self._read_line()
+        if frame_header is None:
+            return None
+
+        if not frame_header.startswith(b"FRAME"):
+            raise u.BlurException("Live input stream is corrupt")
+
+        return self._read_exact(self.frame_size)
+
+
+def source(fd: int, fps_num: int, fps_den: int, is_full_color_range: bool):
+    """
+    frames from a y4m stream (blur pipes the growing file through ffmpeg into vspipe's stdin) that's still being
+    written. requests block until the frame has arrived, and past the end of the stream they fail with
+    END_OF_INPUT_MESSAGE, which is what ends the render.
+
+    frames are read in order and only the most recent ones are kept, so filters can look back a little (and vspipe
+    can have a few requests in flight) without memory growing with the length of the recording
+    """
+    reader = Y4MReader(fd)
+
+    cache_size = max(
+        MIN_CACHED_FRAMES, min(MAX_CACHED_FRAMES, CACHE_BYTES // reader.frame_size)
+    )
+
+    cache = OrderedDict()
+    lock = threading.Lock()
+    state = {"next": 0, "ended": False}
+
+    def get_frame_data(n: int) -> bytes:
+        with lock:
+            while state["next"] <= n and not state["ended"]:
+                data = reader.read_frame()
+                if data is None:
+                    state["ended"] = True
+                    break
+
+                cache[state["next"]] = data
+                state["next"] += 1
+
+                while len(cache) > cache_size:
+                    cache.popitem(last=False)
+
+            if n in cache:
+                return cache[n]
+
+            if state["ended"] and n >= state["next"]:
+                raise u.BlurException(f"{END_OF_INPUT_MESSAGE} after {state['next']} frames")
+
+            raise u.BlurException(
+                f"Live frame {n} is no longer cached (only the last {cache_size} are kept)"
+            )
+
+    blank = core.std.BlankClip(
+        width=reader.width,
+        height=reader.height,
+        format=reader.format,
+        length=int(MAX_SECONDS * fps_num / fps_den),
+        fpsnum=fps_num,
+        fpsden=fps_den,
+    )
+
+    def fill_frame(n: int, f: vs.VideoFrame) -> vs.VideoFrame:
+        data = get_frame_data(n)
+
+        fout = f.copy()
+
+        # point at the bytes directly rather than slicing copies out of them
+        src = ctypes.cast(ctypes.c_char_p(data), ctypes.c_void_p).value
+        offset = 0
+
+        for plane, (row_size, rows) in enumerate(reader.plane_sizes):
+            dst = fout.get_write_ptr(plane).value
+            stride = fout.get_stride(plane)
+
+            if stride == row_size:
+                ctypes.memmove(dst, src + offset, row_size * rows)
+            else:
+                for row in range(rows):
+                    ctypes.memmove(
+                        dst + row * stride, src + offset + row * row_size, row_size
+                    )
+
+            offset += row_size * rows
+
+        fout.props["_ColorRange"] = 0 if is_full_color_range else 1
+
+        return fout
+
+    return core.std.ModifyFrame(blank, blank, fill_frame)
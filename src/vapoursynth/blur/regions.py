@@ -0,0 +1,91 @@
+import vapoursynth as vs
+from vapoursynth import core
+
+import math
+
+import blur.analysis
+
+# tiles where no pixel ever differs from the first frame by more than 2 levels (8-bit, at the analysis size) are
+# static and get pasted from it. anything more, a fade or a timer ticking over, and the tile is processed
+STATIC_THRESHOLD = 2.5 / 255
+
+# crops are kept to multiples of this so subsampled chroma and interpolation block sizes still fit
+ALIGN = 16
+
+# splitting the frame up isn't worth it for less than this much of it
+MIN_SKIPPED_AREA = 0.05
+
+
+def get_active_area(
+    video: vs.VideoNode, analysis: blur.analysis.SourceAnalysis
+) -> tuple[int, int, int, int] | None:
+    """
+    (x, y, width, height) of the part of the frame that ever changes, from the analysis' change map. letterboxing,
+    pillarboxing and static overlays at the edges fall outside it. None if processing the whole frame is as good
+    """
+    bounds = analysis.get_changing_tiles(STATIC_THRESHOLD)
+    if bounds is None:
+        # nothing moves at all, not worth special casing
+        return None
+
+    left, top, right, bottom = bounds
+    tile_width = video.width / blur.analysis.TILE_COLUMNS
+    tile_height = video.height / blur.analysis.TILE_ROWS
+
+    # out to the alignment, tiles don't land on pixel boundaries. the frame's own right and bottom edges don't have
+    # to be aligned, they already fit the subsampling
+    x = math.floor(left * tile_width / ALIGN) * ALIGN
+    y = math.floor(top * tile_height / ALIGN) * ALIGN
+    width = min(math.ceil(right * tile_width / ALIGN) * ALIGN, video.width) - x
+    height = min(math.ceil(bottom * tile_height / ALIGN) * ALIGN, video.height) - y
+
+    if width * height > video.width * video.height * (1 - MIN_SKIPPED_AREA):
+        return None
+
+    return (x, y, width, height)
+
+
+def crop(video: vs.VideoNode, area: tuple[int, int, int, int]) -> vs.VideoNode:
+    x, y, width, height = area
+    return core.std.CropAbs(video, width, height, x, y)
+
+
+def paste(
+    video: vs.VideoNode,
+    background: vs.VideoNode,
+    area: tuple[int, int, int, int],
+) -> vs.VideoNode:
+    """
+    puts the processed area back into the static frame around it. background is a single frame in the same format
+    """
+    x, y, width, height = area
+    background = core.std.AssumeFPS(background * len(video), src=video)
+
+    row = [video]
+    if x > 0:
+        row.insert(0, core.std.CropAbs(background, x, height, 0, y))
+    if x + width < background.width:
+        row.append(
+            core.std.CropAbs(
+                background, background.width - x - width, height, x + width, y
+            )
+        )
+
+    column = [core.std.StackHorizontal(row) if len(row) > 1 else video]
+    if y > 0:
+        column.insert(0, core.std.CropAbs(background, background.width, y, 0, 0))
+    if y + height < background.height:
+        column.append(
+            core.std.CropAbs(
+                background,
+                background.width,
+                background.height - y - height,
+                0,
+                y + height,
+            )
+        )
+
+    pasted = core.std.StackVertical(column) if len(column) > 1 else column[0]
+
+    # stacking keeps the first clip's props, durations and the like have to come from the processed frames
+    return core.std.CopyFrameProps(pasted, video)
@@ -0,0 +1,65 @@
+import vapoursynth as vs
+from vapoursynth import core
+
+import sys
+import threading
+import time
+from collections import OrderedDict
+
+# enough to cover any lookahead, old entries are dropped as new frames come in
+MAX_TRACKED_FRAMES = 2000
+
+
+class ArrivalTimes:
+    def __init__(self):
+        self.times = OrderedDict()
+        self.lock = threading.Lock()
+
+    def mark(self, n: int):
+        with self.lock:
+            if n in self.times:
+                return
+
+            self.times[n] = time.monotonic()
+
+            while len(self.times) > MAX_TRACKED_FRAMES:
+                self.times.popitem(last=False)
+
+    def get(self, n: int) -> float | None:
+        with self.lock:
+            return self.times.get(n)
+
+
+def track_arrivals(clip: vs.VideoNode) -> tuple[vs.VideoNode, ArrivalTimes]:
+    """
+    records when each source frame is first produced. for live input that's when it arrived, for files it's when it
+    was decoded
+    """
+    arrivals = ArrivalTimes()
+
+    def mark(n: int, f: vs.VideoFrame) -> vs.VideoFrame:
+        arrivals.mark(n)
+        return f
+
+    return core.std.ModifyFrame(clip, clip, mark), arrivals
+
+
+def report_latency(
+    clip: vs.VideoNode, arrivals: ArrivalTimes, source_fps: float
+) -> vs.VideoNode:
+    """
+    prints "Latency: <frame> <ms>" to stderr as each output frame is finished, measured from the arrival of the
+    source frame it's centred on. blur reads these to report percentiles
+    """
+    ratio = source_fps / float(clip.fps)
+
+    def report(n: int, f: vs.VideoFrame) -> vs.VideoFrame:
+        arrival = arrivals.get(int(n * ratio))
+        if arrival is not None:
+            latency_ms = (time.monotonic() - arrival) * 1000
+            sys.stderr.write(f"Latency: {n} {latency_ms:.2f}\n")
+            sys.stderr.flush()
+
+        return f
+
+    return core.std.ModifyFrame(clip, clip, report)
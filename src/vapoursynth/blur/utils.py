@@ -4,6 +4,8 @@ from vapoursynth import core
 from pathlib import Path
 from fractions import Fraction
 
+import blur.formats
+
 
 class BlurException(Exception):
     pass
@@ -54,33 +56,24 @@ def assume_scaled_fps(clip, timescale):
 def with_format(
     video: vs.VideoNode, is_full_color_range: bool, target_format, process_func
 ):
+    """
+    runs process_func in target_format and converts back. a no-op around it when blur.py's format planner already
+    has the video in that format. target_format can be a tuple of formats process_func works in, the first is
+    converted to if the video isn't in any of them
+    """
+    target_formats = (
+        target_format if isinstance(target_format, tuple) else (target_format,)
+    )
+
     orig_format = video.format
-    needs_conversion = orig_format.id != target_format
+    needs_conversion = orig_format.id not in target_formats
 
     if needs_conversion:
-        convert_kwargs = {
-            "format": target_format,
-            "range_in": is_full_color_range,
-            "range": is_full_color_range,
-        }
-
-        if target_format == vs.RGBS and orig_format.color_family == vs.YUV:
-            convert_kwargs["matrix_in_s"] = "709"
-
-        video = core.resize.Point(video, **convert_kwargs)
+        video = blur.formats.convert(video, target_formats[0], is_full_color_range)
 
     video = process_func(video)
 
     if needs_conversion:
-        convert_back_kwargs = {
-            "format": orig_format.id,
-            "range_in": is_full_color_range,
-            "range": is_full_color_range,
-        }
-
-        if target_format == vs.RGBS and orig_format.color_family == vs.YUV:
-            convert_back_kwargs["matrix_s"] = "709"
-
-        video = core.resize.Point(video, **convert_back_kwargs)
+        video = blur.formats.convert(video, orig_format.id, is_full_color_range)
 
     return video
@@ -0,0 +1,113 @@
+#include "common/config_blur.h"
+
+TEST(ConfigBlurTest, ParseSize) {
+	EXPECT_EQ(config_blur::parse_size("1280x720"), std::pair(1280, 720));
+	EXPECT_EQ(config_blur::parse_size("720p"), std::pair(0, 720));
+	EXPECT_EQ(config_blur::parse_size("source"), std::pair(0, 0));
+
+	EXPECT_FALSE(config_blur::parse_size(""));
+	EXPECT_FALSE(config_blur::parse_size("720"));
+	EXPECT_FALSE(config_blur::parse_size("1280x"));
+	EXPECT_FALSE(config_blur::parse_size("hd"));
+}
+
+TEST(ConfigBlurTest, NoRenditions) {
+	BlurSettings settings;
+
+	settings.renditions = "";
+	auto renditions = config_blur::parse_renditions(settings);
+	ASSERT_TRUE(renditions);
+	EXPECT_TRUE(renditions->empty());
+
+	settings.renditions = " , ,";
+	renditions = config_blur::parse_renditions(settings);
+	ASSERT_TRUE(renditions);
+	EXPECT_TRUE(renditions->empty());
+}
+
+TEST(ConfigBlurTest, RenditionsDefaultToOutputSettings) {
+	BlurSettings settings;
+	settings.encode_preset = "HEVC";
+	settings.quality = 18;
+	settings.advanced.video_container = "mkv";
+	settings.renditions = "720p, 1280x720, source";
+
+	auto renditions = config_blur::parse_renditions(settings);
+	ASSERT_TRUE(renditions) << renditions.error();
+	ASSERT_EQ(renditions->size(), 3u);
+
+	const auto& scaled = (*renditions)[0];
+	EXPECT_EQ(scaled.width, 0);
+	EXPECT_EQ(scaled.height, 720);
+	EXPECT_EQ(scaled.encode_preset, "hevc");
+	EXPECT_EQ(scaled.quality, 18);
+	EXPECT_EQ(scaled.container, "mkv");
+
+	EXPECT_EQ((*renditions)[1].width, 1280);
+	EXPECT_EQ((*renditions)[1].height, 720);
+
+	EXPECT_EQ((*renditions)[2].width, 0);
+	EXPECT_EQ((*renditions)[2].height, 0);
+
+	// no preset set at all falls back to h264
+	settings.encode_preset = "";
+	renditions = config_blur::parse_renditions(settings);
+	ASSERT_TRUE(renditions);
+	EXPECT_EQ((*renditions)[0].encode_preset, "h264");
+}
+
+TEST(ConfigBlurTest, RenditionsOverrideOutputSettings) {
+	BlurSettings settings;
+	settings.quality = 18;
+	settings.renditions = "480p AV1 30 webm, 1080p h264 24";
+
+	auto renditions = config_blur::parse_renditions(settings);
+	ASSERT_TRUE(renditions) << renditions.error();
+	ASSERT_EQ(renditions->size(), 2u);
+
+	const auto& small = (*renditions)[0];
+	EXPECT_EQ(small.height, 480);
+	EXPECT_EQ(small.encode_preset, "av1");
+	EXPECT_EQ(small.quality, 30);
+	EXPECT_EQ(small.container, "webm");
+
+	const auto& large = (*renditions)[1];
+	EXPECT_EQ(large.height, 1080);
+	EXPECT_EQ(large.encode_preset, "h264");
+	EXPECT_EQ(large.quality, 24);
+	EXPECT_EQ(large.container, settings.advanced.video_container);
+}
+
+TEST(ConfigBlurTest, InvalidRenditions) {
+	BlurSettings settings;
+
+	settings.renditions = "720p, huge";
+	auto renditions = config_blur::parse_renditions(settings);
+	ASSERT_FALSE(renditions);
+	EXPECT_NE(renditions.error().find("huge"), std::string::npos);
+
+	settings.renditions = "720p h264 best";
+	renditions = config_blur::parse_renditions(settings);
+	ASSERT_FALSE(renditions);
+	EXPECT_NE(renditions.error().find("best"), std::string::npos);
+
+	settings.renditions = "720p h264 20 mp4 extra";
+	renditions = config_blur::parse_renditions(settings);
+	ASSERT_FALSE(renditions);
+	EXPECT_NE(renditions.error().find("too many parts"), std::string::npos);
+}
+
+TEST(ConfigBlurTest, WorkingSize) {
+	BlurSettings settings;
+
+	EXPECT_EQ(config_blur::get_working_size(settings, 1920, 1080), std::pair(1920, 1080));
+
+	settings.output_resolution = "720p";
+	EXPECT_EQ(config_blur::get_working_size(settings, 1920, 1080), std::pair(1280, 720));
+
+	// kept even
+	EXPECT_EQ(config_blur::get_working_size(settings, 1000, 1080), std::pair(666, 720));
+
+	settings.output_resolution = "640x480";
+	EXPECT_EQ(config_blur::get_working_size(settings, 1920, 1080), std::pair(640, 480));
+}
@@ -0,0 +1,203 @@
+#include "common/job_store.h"
+#include "test_dir.h"
+
+namespace {
+	Job make_job(const std::string& input, int priority = 0) {
+		return Job{
+			.input = input,
+			.priority = priority,
+		};
+	}
+}
+
+class JobStoreTest : public TestDirTest {
+protected:
+	std::filesystem::path m_journal_path; // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes)
+
+	void SetUp() override {
+		TestDirTest::SetUp();
+		m_journal_path = m_test_dir / "jobs.jsonl";
+	}
+};
+
+TEST_F(JobStoreTest, TakesHighestPriorityThenOldest) {
+	JobStore store;
+	ASSERT_TRUE(store.open(m_journal_path));
+
+	auto first = store.add(make_job("first.mp4"));
+	auto urgent = store.add(make_job("urgent.mp4", 5));
+	auto second = store.add(make_job("second.mp4"));
+
+	EXPECT_LT(first.id, urgent.id);
+	EXPECT_LT(urgent.id, second.id);
+	EXPECT_EQ(store.get_pending_count(), 3u);
+
+	auto next = store.take_next();
+	ASSERT_TRUE(next);
+	EXPECT_EQ(next->id, urgent.id);
+	EXPECT_EQ(next->state, JobState::RUNNING);
+
+	next = store.take_next();
+	ASSERT_TRUE(next);
+	EXPECT_EQ(next->id, first.id);
+
+	next = store.take_next();
+	ASSERT_TRUE(next);
+	EXPECT_EQ(next->id, second.id);
+
+	EXPECT_FALSE(store.take_next());
+	EXPECT_EQ(store.get_pending_count(), 0u);
+}
+
+TEST_F(JobStoreTest, JobsSurviveReopening) {
+	Job job = make_job("input.mp4", 2);
+	job.output = "output.mp4";
+	job.config = "config.cfg";
+	job.branches = { { .config = "branch.cfg", .output = "branch.mp4" }, { .config = "other.cfg" } };
+
+	uint64_t id = 0;
+	{
+		JobStore store;
+		ASSERT_TRUE(store.open(m_journal_path));
+		id = store.add(job).id;
+	}
+
+	JobStore store;
+	ASSERT_TRUE(store.open(m_journal_path));
+
+	auto reopened = store.get(id);
+	ASSERT_TRUE(reopened);
+	EXPECT_EQ(reopened->input, job.input);
+	EXPECT_EQ(reopened->output, job.output);
+	EXPECT_EQ(reopened->config, job.config);
+	EXPECT_EQ(reopened->priority, job.priority);
+	EXPECT_EQ(reopened->state, JobState::PENDING);
+	EXPECT_NE(reopened->submitted, 0);
+
+	ASSERT_EQ(reopened->branches.size(), 2u);
+	EXPECT_EQ(reopened->branches[0].config, "branch.cfg");
+	EXPECT_EQ(reopened->branches[0].output, std::filesystem::path("branch.mp4"));
+	EXPECT_EQ(reopened->branches[1].config, "other.cfg");
+	EXPECT_FALSE(reopened->branches[1].output);
+}
+
+TEST_F(JobStoreTest, RunningJobsRestartAfterReopening) {
+	uint64_t id = 0;
+	{
+		JobStore store;
+		ASSERT_TRUE(store.open(m_journal_path));
+		id = store.add(make_job("input.mp4")).id;
+
+		auto next = store.take_next();
+		ASSERT_TRUE(next);
+		EXPECT_EQ(next->id, id);
+		EXPECT_EQ(store.get_pending_count(), 0u);
+	}
+
+	// went down mid render, it has to be picked up again
+	JobStore store;
+	ASSERT_TRUE(store.open(m_journal_path));
+
+	EXPECT_EQ(store.get(id)->state, JobState::PENDING);
+	EXPECT_EQ(store.get_pending_count(), 1u);
+
+	auto next = store.take_next();
+	ASSERT_TRUE(next);
+	EXPECT_EQ(next->id, id);
+}
+
+TEST_F(JobStoreTest, FinishedJobsAreDroppedAndIdsNotReused) {
+	uint64_t failed_id = 0;
+	uint64_t pending_id = 0;
+	{
+		JobStore store;
+		ASSERT_TRUE(store.open(m_journal_path));
+
+		failed_id = store.add(make_job("broken.mp4")).id;
+		pending_id = store.add(make_job("waiting.mp4")).id;
+
+		store.set_state(failed_id, JobState::FAILED, "Job failed: no space left on device");
+
+		auto failed = store.get(failed_id);
+		ASSERT_TRUE(failed);
+		EXPECT_EQ(failed->state, JobState::FAILED);
+		EXPECT_EQ(failed->error, "Job failed: no space left on device");
+		EXPECT_EQ(store.get_pending_count(), 1u);
+	}
+
+	JobStore store;
+	ASSERT_TRUE(store.open(m_journal_path));
+
+	EXPECT_FALSE(store.get(failed_id));
+	ASSERT_TRUE(store.get(pending_id));
+	EXPECT_EQ(store.get_jobs().size(), 1u);
+
+	auto job = store.add(make_job("new.mp4"));
+	EXPECT_GT(job.id, pending_id);
+}
+
+TEST_F(JobStoreTest, FinishedJobsOutliveCompaction) {
+	JobStore store;
+	ASSERT_TRUE(store.open(m_journal_path));
+
+	auto done_id = store.add(make_job("done.mp4")).id;
+	store.set_state(done_id, JobState::DONE);
+
+	// enough ops to rewrite the journal a few times
+	for (int i = 0; i < 600; i++) {
+		auto id = store.add(make_job("filler.mp4")).id;
+		store.set_state(id, JobState::RUNNING);
+	}
+
+	auto done = store.get(done_id);
+	ASSERT_TRUE(done);
+	EXPECT_EQ(done->state, JobState::DONE);
+
+	// only a bounded tail is kept
+	for (int i = 0; i < 600; i++) {
+		auto id = store.add(make_job("finished.mp4")).id;
+		store.set_state(id, JobState::FAILED, "Job failed");
+	}
+
+	EXPECT_FALSE(store.get(done_id));
+	EXPECT_EQ(store.get_pending_count(), 0u);
+}
+
+TEST_F(JobStoreTest, JournalIsOpenInOneStoreAtATime) {
+	JobStore first;
+	ASSERT_TRUE(first.open(m_journal_path));
+
+	JobStore second;
+	EXPECT_FALSE(second.open(m_journal_path));
+
+	first.close();
+	EXPECT_TRUE(second.open(m_journal_path));
+}
+
+TEST_F(JobStoreTest, TornJournalLineIsSkipped) {
+	uint64_t id = 0;
+	{
+		JobStore store;
+		ASSERT_TRUE(store.open(m_journal_path));
+		id = store.add(make_job("input.mp4")).id;
+	}
+
+	// crashed halfway through writing the next op
+	{
+		std::ofstream journal(m_journal_path, std::ios::app);
+		journal << R"({"op":"add","job":{"id":)";
+	}
+
+	JobStore store;
+	ASSERT_TRUE(store.open(m_journal_path));
+
+	EXPECT_TRUE(store.get(id));
+	EXPECT_EQ(store.get_jobs().size(), 1u);
+}
+
+TEST_F(JobStoreTest, StateNames) {
+	EXPECT_EQ(JobStore::state_to_string(JobState::PENDING), "pending");
+	EXPECT_EQ(JobStore::state_to_string(JobState::RUNNING), "running");
+	EXPECT_EQ(JobStore::state_to_string(JobState::DONE), "done");
+	EXPECT_EQ(JobStore::state_to_string(JobState::FAILED), "failed");
+}
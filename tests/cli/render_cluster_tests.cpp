@@ -0,0 +1,158 @@
+#include "cli/render_cluster.h"
+
+namespace {
+	std::vector<render_cluster::Keyframe> make_keyframes(int input_frames, int interval, double fps) {
+		std::vector<render_cluster::Keyframe> keyframes;
+		for (int frame = 0; frame < input_frames; frame += interval)
+			keyframes.push_back({ .frame = frame, .time = frame / fps });
+
+		return keyframes;
+	}
+
+	// every output frame has to be rendered by exactly one segment, in order
+	void expect_covers_output(
+		const std::vector<render_cluster::Segment>& segments, int input_frames, int output_frames
+	) {
+		ASSERT_FALSE(segments.empty());
+
+		EXPECT_EQ(segments.front().start, 0);
+		EXPECT_EQ(segments.front().output_start, 0);
+		EXPECT_EQ(segments.back().end, input_frames);
+		EXPECT_EQ(segments.back().output_end, output_frames);
+
+		for (size_t i = 0; i < segments.size(); i++) {
+			const auto& segment = segments[i];
+
+			EXPECT_EQ(segment.index, i);
+			EXPECT_LT(segment.output_start, segment.output_end);
+			EXPECT_LE(segment.chunk_start, segment.start);
+			EXPECT_GE(segment.chunk_end, segment.end);
+			EXPECT_GE(segment.output_skip, 0);
+
+			if (i > 0) {
+				EXPECT_EQ(segment.start, segments[i - 1].end);
+				EXPECT_EQ(segment.output_start, segments[i - 1].output_end);
+			}
+		}
+	}
+}
+
+TEST(RenderClusterTest, FrameGap) {
+	// 144 -> 60 fps makes 5 output frames from every 12 input ones
+	EXPECT_EQ(render_cluster::get_frame_gap(14400, 6000), 12);
+
+	// frame counts are rarely exact, a frame or two off still lines up
+	EXPECT_EQ(render_cluster::get_frame_gap(14403, 6001), 12);
+
+	EXPECT_EQ(render_cluster::get_frame_gap(7200, 7200), 1);
+	EXPECT_EQ(render_cluster::get_frame_gap(3600, 7200), 1);
+	EXPECT_EQ(render_cluster::get_frame_gap(7200, 3600), 2);
+
+	// no whole number of input frames makes a whole number of output frames
+	EXPECT_FALSE(render_cluster::get_frame_gap(10'000'000, 4'142'136));
+
+	EXPECT_FALSE(render_cluster::get_frame_gap(0, 6000));
+	EXPECT_FALSE(render_cluster::get_frame_gap(14400, 0));
+}
+
+TEST(RenderClusterTest, SingleSegmentForShortVideo) {
+	auto keyframes = make_keyframes(600, 120, 60.0);
+
+	auto segments = render_cluster::plan_segments(keyframes, 600, 600, 1800, 60);
+	ASSERT_EQ(segments.size(), 1u);
+
+	const auto& segment = segments[0];
+	EXPECT_EQ(segment.chunk_start, 0);
+	EXPECT_EQ(segment.chunk_end, 600);
+	EXPECT_DOUBLE_EQ(segment.chunk_start_time, 0.0);
+	EXPECT_FALSE(segment.chunk_end_time);
+	EXPECT_EQ(segment.output_end, 600);
+	EXPECT_EQ(segment.output_skip, 0);
+}
+
+TEST(RenderClusterTest, SegmentsCoverOutput) {
+	constexpr int INPUT_FRAMES = 18000;
+	constexpr int TARGET_FRAMES = 1800;
+	constexpr int CONTEXT_FRAMES = 60;
+
+	auto keyframes = make_keyframes(INPUT_FRAMES, 250, 60.0);
+
+	auto segments =
+		render_cluster::plan_segments(keyframes, INPUT_FRAMES, INPUT_FRAMES, TARGET_FRAMES, CONTEXT_FRAMES);
+	EXPECT_GT(segments.size(), 1u);
+	expect_covers_output(segments, INPUT_FRAMES, INPUT_FRAMES);
+
+	for (const auto& segment : segments) {
+		if (segment.index == 0)
+			continue;
+
+		// starts on a keyframe with enough history before it
+		EXPECT_EQ(segment.start % 250, 0);
+		EXPECT_EQ(segment.chunk_start % 250, 0);
+		EXPECT_GE(segment.start - segment.chunk_start, CONTEXT_FRAMES);
+		EXPECT_DOUBLE_EQ(segment.chunk_start_time, segment.chunk_start / 60.0);
+
+		EXPECT_GE(segment.end - segment.start, TARGET_FRAMES);
+		EXPECT_EQ(segment.output_skip, segment.start - segment.chunk_start);
+	}
+
+	// no tiny segment left at the end
+	EXPECT_GE(segments.back().end - segments.back().start, TARGET_FRAMES / 2);
+}
+
+TEST(RenderClusterTest, ChunksStartOnFrameGap) {
+	// 144 -> 60 fps, keyframes every 50 frames so only every 6th one is on the frame gap
+	constexpr int INPUT_FRAMES = 14400;
+	constexpr int OUTPUT_FRAMES = 6000;
+	constexpr int TARGET_FRAMES = 1440;
+	constexpr int CONTEXT_FRAMES = 100;
+
+	auto frame_gap = render_cluster::get_frame_gap(INPUT_FRAMES, OUTPUT_FRAMES);
+	ASSERT_EQ(frame_gap, 12);
+
+	auto keyframes = make_keyframes(INPUT_FRAMES, 50, 144.0);
+
+	auto segments = render_cluster::plan_segments(
+		keyframes, INPUT_FRAMES, OUTPUT_FRAMES, TARGET_FRAMES, CONTEXT_FRAMES, *frame_gap
+	);
+	EXPECT_GT(segments.size(), 1u);
+	expect_covers_output(segments, INPUT_FRAMES, OUTPUT_FRAMES);
+
+	for (const auto& segment : segments) {
+		EXPECT_EQ(segment.chunk_start % *frame_gap, 0) << "segment " << segment.index;
+
+		// the chunk on its own renders exactly the single pass render's frames from chunk_start onwards, so skipping
+		// the context's output frames lands on output_start
+		int chunk_output_start = static_cast<int>(
+			std::lround(segment.chunk_start * (OUTPUT_FRAMES / static_cast<double>(INPUT_FRAMES)))
+		);
+		EXPECT_EQ(chunk_output_start * INPUT_FRAMES, segment.chunk_start * OUTPUT_FRAMES);
+		EXPECT_EQ(chunk_output_start + segment.output_skip, segment.output_start);
+	}
+}
+
+TEST(RenderClusterTest, UnalignedKeyframesFallBackToStart) {
+	// keyframes that never land on the frame gap can't start a chunk. segments close enough to the start of the video
+	// are still fine with a chunk from there, the rest stays in one segment
+	constexpr int INPUT_FRAMES = 14400;
+	constexpr int OUTPUT_FRAMES = 6000;
+
+	std::vector<render_cluster::Keyframe> keyframes = { { .frame = 0, .time = 0.0 } };
+	for (int frame = 145; frame < INPUT_FRAMES; frame += 144)
+		keyframes.push_back({ .frame = frame, .time = frame / 144.0 });
+
+	auto segments = render_cluster::plan_segments(keyframes, INPUT_FRAMES, OUTPUT_FRAMES, 1440, 100, 12);
+	ASSERT_EQ(segments.size(), 2u);
+	expect_covers_output(segments, INPUT_FRAMES, OUTPUT_FRAMES);
+
+	for (const auto& segment : segments) {
+		EXPECT_EQ(segment.chunk_start, 0);
+		EXPECT_EQ(segment.output_skip, segment.output_start);
+	}
+}
+
+TEST(RenderClusterTest, NothingToPlan) {
+	EXPECT_TRUE(render_cluster::plan_segments({}, 600, 600, 1800, 60).empty());
+	EXPECT_TRUE(render_cluster::plan_segments(make_keyframes(600, 120, 60.0), 0, 600, 1800, 60).empty());
+	EXPECT_TRUE(render_cluster::plan_segments(make_keyframes(600, 120, 60.0), 600, 600, 1800, 60, 0).empty());
+}
@@ -0,0 +1,162 @@
+#include "common/render_history.h"
+#include "test_dir.h"
+
+namespace {
+	constexpr int WIDTH = 1920;
+	constexpr int HEIGHT = 1080;
+	constexpr double PIXELS = static_cast<double>(WIDTH) * HEIGHT;
+
+	render_history::Entry make_entry(
+		const BlurSettings& settings,
+		double duration,
+		double startup,
+		double processing,
+		double finishing,
+		int64_t peak_memory
+	) {
+		return render_history::Entry{
+			.width = WIDTH,
+			.height = HEIGHT,
+			.fps = 60.0,
+			.duration = duration,
+			.output_frames = static_cast<int>(duration * 60),
+			.settings_hash = render_history::hash_settings(settings),
+			.pipeline_hash = render_history::hash_pipeline(settings),
+			.timings = { .startup = startup, .processing = processing, .finishing = finishing },
+			.peak_memory = peak_memory,
+		};
+	}
+
+	u::VideoInfo make_video_info(int width, int height, double duration) {
+		u::VideoInfo video_info;
+		video_info.width = width;
+		video_info.height = height;
+		video_info.duration = duration;
+		return video_info;
+	}
+}
+
+// NOLINTBEGIN(cppcoreguidelines-non-private-member-variables-in-classes)
+class RenderHistoryTest : public TestDirTest {
+protected:
+	std::filesystem::path m_settings_path;
+	BlurSettings m_settings;
+
+	void SetUp() override {
+		TestDirTest::SetUp();
+
+		// history lives in the settings folder, point it somewhere disposable
+		m_settings_path = blur.settings_path;
+		blur.settings_path = m_test_dir;
+	}
+
+	void TearDown() override {
+		blur.settings_path = m_settings_path;
+		TestDirTest::TearDown();
+	}
+};
+
+// NOLINTEND(cppcoreguidelines-non-private-member-variables-in-classes)
+
+TEST_F(RenderHistoryTest, NoHistoryNoEstimate) {
+	EXPECT_TRUE(render_history::load().empty());
+	EXPECT_FALSE(render_history::estimate(make_video_info(WIDTH, HEIGHT, 10.0), m_settings));
+}
+
+TEST_F(RenderHistoryTest, RecordedEntriesLoad) {
+	render_history::record(make_entry(m_settings, 10.0, 1.0, 20.0, 2.0, 1'000'000'000));
+	render_history::record(make_entry(m_settings, 5.0, 1.5, 8.0, 1.0, 900'000'000));
+
+	auto entries = render_history::load();
+	ASSERT_EQ(entries.size(), 2u);
+
+	EXPECT_EQ(entries[0].width, WIDTH);
+	EXPECT_DOUBLE_EQ(entries[0].duration, 10.0);
+	EXPECT_DOUBLE_EQ(entries[0].timings.processing, 20.0);
+	EXPECT_EQ(entries[0].peak_memory, 1'000'000'000);
+	EXPECT_EQ(entries[0].settings_hash, render_history::hash_settings(m_settings));
+	EXPECT_DOUBLE_EQ(entries[1].timings.startup, 1.5);
+}
+
+TEST_F(RenderHistoryTest, EstimateUsesMedians) {
+	// one slow outlier in each stage shouldn't drag the estimate
+	render_history::record(make_entry(m_settings, 10.0, 1.0, 10.0, 1.0, 1'000'000'000));
+	render_history::record(make_entry(m_settings, 10.0, 2.0, 20.0, 1.0, 2'000'000'000));
+	render_history::record(make_entry(m_settings, 10.0, 9.0, 90.0, 4.0, 1'500'000'000));
+
+	auto estimate = render_history::estimate(make_video_info(WIDTH, HEIGHT, 20.0), m_settings);
+	ASSERT_TRUE(estimate);
+
+	EXPECT_EQ(estimate->samples, 3u);
+	EXPECT_TRUE(estimate->exact_settings);
+
+	// startup is fixed, processing scales with footage length, so does finishing: 2 + 20 * 2 + 0.1 * 20
+	EXPECT_NEAR(estimate->wall_time, 44.0, 1e-6);
+
+	// memory takes the worst seen rather than the median
+	EXPECT_NEAR(static_cast<double>(estimate->peak_memory), 2'000'000'000, 1.0);
+}
+
+TEST_F(RenderHistoryTest, EstimateScalesWithResolution) {
+	render_history::record(make_entry(m_settings, 10.0, 0.0, 10.0, 0.0, 1'000'000'000));
+
+	auto estimate = render_history::estimate(make_video_info(WIDTH * 2, HEIGHT * 2, 10.0), m_settings);
+	ASSERT_TRUE(estimate);
+
+	EXPECT_NEAR(estimate->wall_time, 40.0, 1e-6);
+	EXPECT_NEAR(static_cast<double>(estimate->peak_memory), 4'000'000'000, 1.0);
+
+	// processed at the output resolution when there is one
+	m_settings.output_resolution = std::format("{}p", HEIGHT / 2);
+
+	estimate = render_history::estimate(make_video_info(WIDTH, HEIGHT, 10.0), m_settings);
+	ASSERT_TRUE(estimate);
+
+	EXPECT_NEAR(estimate->wall_time, 2.5, 1e-6);
+	EXPECT_NEAR(static_cast<double>(estimate->peak_memory), 250'000'000, 1.0);
+}
+
+TEST_F(RenderHistoryTest, EstimateFallsBackToPipeline) {
+	auto entry = make_entry(m_settings, 10.0, 1.0, 10.0, 0.0, 1'000'000'000);
+	entry.settings_hash++; // same stages, some other amount or weighting
+	render_history::record(entry);
+
+	auto estimate = render_history::estimate(make_video_info(WIDTH, HEIGHT, 10.0), m_settings);
+	ASSERT_TRUE(estimate);
+	EXPECT_FALSE(estimate->exact_settings);
+	EXPECT_NEAR(estimate->wall_time, 11.0, 1e-6);
+
+	// exact matches win once there are any
+	render_history::record(make_entry(m_settings, 10.0, 1.0, 30.0, 0.0, 1'000'000'000));
+
+	estimate = render_history::estimate(make_video_info(WIDTH, HEIGHT, 10.0), m_settings);
+	ASSERT_TRUE(estimate);
+	EXPECT_TRUE(estimate->exact_settings);
+	EXPECT_EQ(estimate->samples, 1u);
+	EXPECT_NEAR(estimate->wall_time, 31.0, 1e-6);
+
+	// a different pipeline tells us nothing
+	auto other_settings = m_settings;
+	other_settings.interpolate = !other_settings.interpolate;
+	EXPECT_FALSE(render_history::estimate(make_video_info(WIDTH, HEIGHT, 10.0), other_settings));
+}
+
+TEST_F(RenderHistoryTest, EstimateOnlyUsesRecentRenders) {
+	// old renders on slower hardware
+	for (int i = 0; i < 10; i++)
+		render_history::record(make_entry(m_settings, 10.0, 0.0, 1000.0, 0.0, 1'000'000'000));
+
+	for (size_t i = 0; i < render_history::ESTIMATE_SAMPLES; i++)
+		render_history::record(make_entry(m_settings, 10.0, 0.0, 10.0, 0.0, 1'000'000'000));
+
+	auto estimate = render_history::estimate(make_video_info(WIDTH, HEIGHT, 10.0), m_settings);
+	ASSERT_TRUE(estimate);
+	EXPECT_EQ(estimate->samples, render_history::ESTIMATE_SAMPLES);
+	EXPECT_NEAR(estimate->wall_time, 10.0, 1e-6);
+}
+
+TEST_F(RenderHistoryTest, FormatDuration) {
+	EXPECT_EQ(render_history::format_duration(5.0), "5s");
+	EXPECT_EQ(render_history::format_duration(125.0), "2m 5s");
+	EXPECT_EQ(render_history::format_duration(3720.0), "1h 2m");
+}
@@ -0,0 +1,168 @@
+#include "common/source_analysis.h"
+#include "test_dir.h"
+
+namespace {
+	constexpr size_t FRAME_SIZE =
+		static_cast<size_t>(source_analysis::ANALYSIS_WIDTH) * source_analysis::ANALYSIS_HEIGHT;
+
+	std::vector<uint8_t> random_plane(size_t size, uint32_t seed) {
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> dist(0, 255);
+
+		std::vector<uint8_t> plane(size);
+		for (auto& value : plane)
+			value = static_cast<uint8_t>(dist(rng));
+
+		return plane;
+	}
+
+	float scalar_frame_diff(const uint8_t* a, const uint8_t* b, size_t size) {
+		uint64_t sum = 0;
+		for (size_t i = 0; i < size; i++)
+			sum += std::abs(int(a[i]) - int(b[i]));
+
+		return static_cast<float>(static_cast<double>(sum) / (static_cast<double>(size) * 255.0));
+	}
+
+	void set_pixel(std::vector<uint8_t>& frame, int x, int y, uint8_t value) {
+		frame[(static_cast<size_t>(y) * source_analysis::ANALYSIS_WIDTH) + x] = value;
+	}
+
+	void write_file(const std::filesystem::path& path, const std::string& contents) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << contents;
+	}
+}
+
+TEST(SourceAnalysisTest, FrameDiffMatchesScalar) {
+	// sizes either side of the 16 byte vector width so the tail loop gets exercised too
+	constexpr std::array<size_t, 10> SIZES = { 1, 7, 15, 16, 17, 31, 33, 1000, FRAME_SIZE, FRAME_SIZE + 5 };
+
+	for (size_t size : SIZES) {
+		auto a = random_plane(size, 1);
+		auto b = random_plane(size, 2);
+
+		float diff = source_analysis::get_frame_diff(a.data(), b.data(), size);
+		EXPECT_FLOAT_EQ(diff, scalar_frame_diff(a.data(), b.data(), size)) << "size " << size;
+	}
+}
+
+TEST(SourceAnalysisTest, FrameDiffRange) {
+	std::vector<uint8_t> black(FRAME_SIZE, 0);
+	std::vector<uint8_t> white(FRAME_SIZE, 255);
+
+	EXPECT_FLOAT_EQ(source_analysis::get_frame_diff(black.data(), black.data(), FRAME_SIZE), 0.f);
+	EXPECT_FLOAT_EQ(source_analysis::get_frame_diff(black.data(), white.data(), FRAME_SIZE), 1.f);
+	EXPECT_FLOAT_EQ(source_analysis::get_frame_diff(white.data(), black.data(), FRAME_SIZE), 1.f);
+	EXPECT_FLOAT_EQ(source_analysis::get_frame_diff(black.data(), white.data(), 0), 0.f);
+}
+
+TEST(SourceAnalysisTest, TileDiffsTakeLargestPixel) {
+	constexpr int TILE_SIZE = source_analysis::TILE_SIZE;
+	constexpr int TILE_COLUMNS = source_analysis::TILE_COLUMNS;
+
+	std::vector<uint8_t> reference(FRAME_SIZE, 100);
+	std::vector<float> tile_diffs(static_cast<size_t>(TILE_COLUMNS) * source_analysis::TILE_ROWS, 0.f);
+
+	// one pixel changing is enough to mark its tile, however little it moves the tile's mean
+	auto frame = reference;
+	set_pixel(frame, (3 * TILE_SIZE) + 4, (2 * TILE_SIZE) + 9, 100 + 51);
+	set_pixel(frame, (3 * TILE_SIZE) + 5, (2 * TILE_SIZE) + 1, 100 - 10);
+
+	// last pixel of a tile and first of the next belong to different tiles
+	set_pixel(frame, TILE_SIZE - 1, 0, 100 - 25);
+	set_pixel(frame, TILE_SIZE, 0, 255);
+
+	source_analysis::update_tile_diffs(frame.data(), reference.data(), tile_diffs);
+
+	for (size_t i = 0; i < tile_diffs.size(); i++) {
+		float expected = 0.f;
+		if (i == (2 * TILE_COLUMNS) + 3)
+			expected = 51 / 255.f;
+		else if (i == 0)
+			expected = 25 / 255.f;
+		else if (i == 1)
+			expected = 155 / 255.f;
+
+		EXPECT_FLOAT_EQ(tile_diffs[i], expected) << "tile " << i;
+	}
+}
+
+TEST(SourceAnalysisTest, TileDiffsAccumulate) {
+	std::vector<uint8_t> reference(FRAME_SIZE, 0);
+	std::vector<float> tile_diffs(static_cast<size_t>(source_analysis::TILE_COLUMNS) * source_analysis::TILE_ROWS, 0.f);
+
+	auto frame = reference;
+	set_pixel(frame, 0, 0, 200);
+	source_analysis::update_tile_diffs(frame.data(), reference.data(), tile_diffs);
+
+	// a later, smaller change doesn't lower what's already been seen
+	frame = reference;
+	set_pixel(frame, 1, 1, 20);
+	source_analysis::update_tile_diffs(frame.data(), reference.data(), tile_diffs);
+	EXPECT_FLOAT_EQ(tile_diffs[0], 200 / 255.f);
+
+	// and a frame identical to the reference changes nothing
+	auto before = tile_diffs;
+	source_analysis::update_tile_diffs(reference.data(), reference.data(), tile_diffs);
+	EXPECT_EQ(tile_diffs, before);
+
+	// differences are measured from the reference, not the previous frame
+	frame = reference;
+	set_pixel(frame, 0, 0, 255);
+	source_analysis::update_tile_diffs(frame.data(), reference.data(), tile_diffs);
+	EXPECT_FLOAT_EQ(tile_diffs[0], 1.f);
+}
+
+TEST(SourceAnalysisTest, TileDiffsFromStackedFrame) {
+	// the change map frame sits under the full size one in the same buffer, wider than it when the source is
+	constexpr size_t STRIDE = 1920;
+
+	std::vector<uint8_t> reference(STRIDE * source_analysis::ANALYSIS_HEIGHT, 0);
+	std::vector<float> tile_diffs(static_cast<size_t>(source_analysis::TILE_COLUMNS) * source_analysis::TILE_ROWS, 0.f);
+
+	auto frame = reference;
+	frame[(STRIDE * 15) + 25] = 255; // tile (2, 1)
+	frame[(STRIDE * 15) + source_analysis::ANALYSIS_WIDTH] = 255; // padding, not part of any tile
+
+	source_analysis::update_tile_diffs(frame.data(), reference.data(), tile_diffs, STRIDE);
+
+	for (size_t i = 0; i < tile_diffs.size(); i++)
+		EXPECT_FLOAT_EQ(tile_diffs[i], i == source_analysis::TILE_COLUMNS + 2 ? 1.f : 0.f) << "tile " << i;
+}
+
+class SourceAnalysisFileTest : public TestDirTest {};
+
+TEST_F(SourceAnalysisFileTest, OnlyCurrentVersionIsReused) {
+	auto path = m_test_dir / "analysis.json";
+
+	EXPECT_FALSE(source_analysis::is_current(path));
+
+	write_file(path, nlohmann::json{ { "version", source_analysis::VERSION }, { "frames", 0 } }.dump());
+	EXPECT_TRUE(source_analysis::is_current(path));
+
+	// older analyses are missing data (or measured it differently) and have to be redone
+	write_file(path, nlohmann::json{ { "version", source_analysis::VERSION - 1 }, { "frames", 0 } }.dump());
+	EXPECT_FALSE(source_analysis::is_current(path));
+
+	write_file(path, nlohmann::json{ { "frames", 0 } }.dump());
+	EXPECT_FALSE(source_analysis::is_current(path));
+
+	write_file(path, R"({ "version": )");
+	EXPECT_FALSE(source_analysis::is_current(path));
+}
+
+TEST_F(SourceAnalysisFileTest, SourceHashFollowsContents) {
+	auto source = m_test_dir / "source.bin";
+
+	EXPECT_FALSE(source_analysis::get_source_hash(source));
+
+	write_file(source, std::string(4096, 'a'));
+	auto first_hash = source_analysis::get_source_hash(source);
+	ASSERT_TRUE(first_hash);
+	EXPECT_EQ(source_analysis::get_source_hash(source), first_hash);
+
+	// same size, different contents
+	write_file(source, std::string(4096, 'b'));
+	EXPECT_NE(source_analysis::get_source_hash(source), first_hash);
+}
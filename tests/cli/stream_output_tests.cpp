@@ -0,0 +1,58 @@
+#include "common/stream_output.h"
+
+using stream_output::LatencyTracker;
+
+TEST(LatencyTrackerTest, EmptySummary) {
+	LatencyTracker tracker;
+
+	EXPECT_EQ(tracker.get_summary().frames, 0u);
+	EXPECT_EQ(tracker.get_recent_summary().frames, 0u);
+}
+
+TEST(LatencyTrackerTest, SummaryCoversEveryFrame) {
+	LatencyTracker tracker;
+	for (int i = 1; i <= 100; i++)
+		tracker.add(static_cast<float>(i));
+
+	auto summary = tracker.get_summary();
+	EXPECT_EQ(summary.frames, 100u);
+	EXPECT_FLOAT_EQ(summary.p50, 50.f);
+	EXPECT_FLOAT_EQ(summary.p95, 95.f);
+	EXPECT_FLOAT_EQ(summary.p99, 99.f);
+	EXPECT_FLOAT_EQ(summary.max, 100.f);
+}
+
+TEST(LatencyTrackerTest, RecentSummaryOnlyCoversWindow) {
+	LatencyTracker tracker;
+
+	// a slow start that's long gone by the time of the report
+	for (size_t i = 0; i < LatencyTracker::WINDOW_FRAMES; i++)
+		tracker.add(500.f);
+
+	for (size_t i = 0; i < LatencyTracker::WINDOW_FRAMES; i++)
+		tracker.add(20.f);
+
+	auto recent = tracker.get_recent_summary();
+	EXPECT_EQ(recent.frames, LatencyTracker::WINDOW_FRAMES);
+	EXPECT_FLOAT_EQ(recent.p99, 20.f);
+	EXPECT_FLOAT_EQ(recent.max, 20.f);
+
+	auto total = tracker.get_summary();
+	EXPECT_EQ(total.frames, LatencyTracker::WINDOW_FRAMES * 2);
+	EXPECT_FLOAT_EQ(total.p50, 20.f);
+	EXPECT_FLOAT_EQ(total.p95, 500.f);
+	EXPECT_FLOAT_EQ(total.max, 500.f);
+}
+
+TEST(LatencyTrackerTest, SlowFramesPastHistogram) {
+	LatencyTracker tracker;
+	auto slow = static_cast<float>(LatencyTracker::HISTOGRAM_MS) * 3.f;
+
+	tracker.add(10.f);
+	for (int i = 0; i < 3; i++)
+		tracker.add(slow);
+
+	auto summary = tracker.get_summary();
+	EXPECT_FLOAT_EQ(summary.p50, slow);
+	EXPECT_FLOAT_EQ(summary.max, slow);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// NOLINTBEGIN(cppcoreguidelines-non-private-member-variables-in-classes)
+
+// gives each test its own empty folder under test_outputs, removed once it's done
+class TestDirTest : public ::testing::Test {
+protected:
+	std::filesystem::path m_test_dir;
+
+	void SetUp() override {
+		const auto* test_info = ::testing::UnitTest::GetInstance()->current_test_info();
+
+		m_test_dir = std::filesystem::path(__FILE__).parent_path() / "test_outputs" / test_info->test_suite_name() /
+		             test_info->name();
+		std::filesystem::remove_all(m_test_dir);
+		std::filesystem::create_directories(m_test_dir);
+	}
+
+	void TearDown() override {
+		std::filesystem::remove_all(m_test_dir);
+	}
+};
+
+// NOLINTEND(cppcoreguidelines-non-private-member-variables-in-classes)
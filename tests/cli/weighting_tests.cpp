@@ -0,0 +1,56 @@
+#include "common/weighting.h"
+
+namespace {
+	std::vector<double> normalize_integer_weights(const std::vector<int>& weights) {
+		double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+		std::vector<double> normalized;
+		for (int weight : weights)
+			normalized.push_back(weight / total);
+
+		return normalized;
+	}
+
+	void expect_weights_near(const std::vector<double>& actual, const std::vector<double>& expected) {
+		ASSERT_EQ(actual.size(), expected.size());
+		for (size_t i = 0; i < actual.size(); i++)
+			EXPECT_NEAR(actual[i], expected[i], 1e-9) << "weight " << i;
+	}
+}
+
+// ffmpeg's tmix has to blend the same as blur.py does when vapoursynth is skipped
+TEST(WeightingTest, IntegerWeightsMatchPython) {
+	const std::vector<std::pair<std::string, std::function<weighting::WeightingResult(int)>>> weightings = {
+		{ "equal", weighting::equal },
+		{ "ascending", weighting::ascending },
+		{ "descending", weighting::descending },
+		{ "pyramid", weighting::pyramid },
+	};
+
+	for (const auto& [name, get_weights] : weightings) {
+		for (int frames = 1; frames <= 25; frames++) {
+			SCOPED_TRACE(std::format("{} {}", name, frames));
+
+			auto integer_weights = weighting::get_integer_weights(name, frames);
+			ASSERT_TRUE(integer_weights);
+			EXPECT_TRUE(std::ranges::all_of(*integer_weights, [](int weight) {
+				return weight > 0;
+			}));
+
+			expect_weights_near(normalize_integer_weights(*integer_weights), get_weights(frames).weights);
+		}
+	}
+}
+
+TEST(WeightingTest, EvenPyramid) {
+	// weighting.py: pyramid(4) == [1/6, 1/3, 1/3, 1/6]
+	auto integer_weights = weighting::get_integer_weights("pyramid", 4);
+	ASSERT_TRUE(integer_weights);
+	expect_weights_near(normalize_integer_weights(*integer_weights), { 1 / 6.0, 1 / 3.0, 1 / 3.0, 1 / 6.0 });
+}
+
+TEST(WeightingTest, NoIntegerWeights) {
+	EXPECT_FALSE(weighting::get_integer_weights("gaussian_sym", 5));
+	EXPECT_FALSE(weighting::get_integer_weights("vegas", 5));
+	EXPECT_FALSE(weighting::get_integer_weights("1, 2, 3", 3));
+}